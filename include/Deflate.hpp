@@ -0,0 +1,136 @@
+/***************************************************************************************************
+ * @file  Deflate.hpp
+ * @brief Declaration of the Deflate class
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @class Deflate
+ * @brief A streaming zlib compressor (RFC 1950 and 1951), used to write PNG images a few rows at a time. The data is
+ * given in consecutive parts, each one compressed into blocks of LZ77 matches encoded with the fixed Huffman codes.
+ * Matches can refer to the previous parts, up to 32 KiB back.
+ *
+ * With several threads, each part is split into strips compressed in parallel, pigz style: a strip is primed with the
+ * 32 KiB preceding it and ends on a byte boundary, so the compressed strips are simply concatenated.
+ */
+class Deflate {
+public:
+    static constexpr unsigned int defaultLevel = 6; ///< The compression level used by default, as zlib's.
+
+    /**
+     * @brief Constructor.
+     * @param level The compression level, from 0 (stored without compression, the fastest) to 9 (the smallest). Higher
+     * levels search more previous occurrences of a sequence for the longest match.
+     * @param threadCount The amount of threads compressing the strips of a part, 1 to compress it on the calling
+     * thread only.
+     */
+    explicit Deflate(unsigned int level = defaultLevel, unsigned int threadCount = 1);
+
+    /**
+     * @brief Compresses the next part of the data.
+     * @param data The part of the data.
+     * @param last Whether it is the last part, which ends the stream.
+     * @param output Receives the compressed bytes completed by this part.
+     */
+    void compress(std::span<const unsigned char> data, bool last, std::vector<unsigned char>& output);
+
+private:
+    static constexpr unsigned int windowSize = 32768;     ///< How far back matches can refer to.
+    static constexpr unsigned int minMatch = 3;           ///< The length of the shortest match.
+    static constexpr unsigned int maxMatch = 258;         ///< The length of the longest match.
+    static constexpr unsigned int hashBits = 15;          ///< The size of the hash table of the 3-byte sequences.
+    static constexpr unsigned int maxStoredSize = 65535;  ///< The size of the largest stored block.
+    static constexpr unsigned int minStripSize = 1 << 16; ///< The size of the smallest strip compressed in parallel.
+
+    /**
+     * @brief Compresses the bytes at the end of the history into a block, with the fixed Huffman codes.
+     * @param start The index in the history of the first byte to compress, the bytes before it being the dictionary.
+     * @param last Whether the block ends the stream.
+     * @param output The output.
+     */
+    void compressBlock(uint32_t start, bool last, std::vector<unsigned char>& output);
+
+    /**
+     * @brief Compresses a strip of a part on its own, on the current thread.
+     * @param dictionary The 32 KiB preceding the strip, or less at the beginning of the stream.
+     * @param strip The strip.
+     * @param last Whether the strip ends the stream.
+     * @param output Receives the compressed strip, which ends on a byte boundary.
+     */
+    void compressStrip(std::span<const unsigned char> dictionary, std::span<const unsigned char> strip, bool last,
+                       std::vector<unsigned char>& output) const;
+
+    /**
+     * @brief Writes data in stored blocks, without compression.
+     * @param data The data.
+     * @param last Whether the last block ends the stream.
+     * @param output The output.
+     */
+    void writeStored(std::span<const unsigned char> data, bool last, std::vector<unsigned char>& output);
+
+    /**
+     * @brief Pads the bits written to a byte boundary with an empty stored block, like zlib's Z_SYNC_FLUSH, or with
+     * zeros after the last block.
+     * @param last Whether the last block was written.
+     * @param output The output.
+     */
+    void alignToByte(bool last, std::vector<unsigned char>& output);
+
+    /**
+     * @brief Writes bits to the output, the first one being the least significant.
+     * @param value The bits.
+     * @param count The amount of bits, at most 32.
+     * @param output The output.
+     */
+    void writeBits(uint32_t value, unsigned int count, std::vector<unsigned char>& output);
+
+    /**
+     * @brief Writes a literal or a length symbol with its fixed Huffman code.
+     * @param symbol The symbol, from 0 to 287.
+     * @param output The output.
+     */
+    void writeSymbol(unsigned int symbol, std::vector<unsigned char>& output);
+
+    /**
+     * @brief Writes a match with the fixed Huffman codes.
+     * @param length The length of the match.
+     * @param distance The distance of the match.
+     * @param output The output.
+     */
+    void writeMatch(unsigned int length, unsigned int distance, std::vector<unsigned char>& output);
+
+    /**
+     * @brief Computes the hash of the 3 bytes starting at a position of the history.
+     * @param index The index of the first byte in the history.
+     * @return The hash.
+     */
+    uint32_t hash(uint32_t index) const;
+
+    /**
+     * @brief Inserts in the hash chains the positions before a position of the stream that aren't yet, if their 3
+     * bytes are in the history.
+     * @param position The position in the stream.
+     */
+    void insertUpTo(uint64_t position);
+
+    unsigned int level;          ///< The compression level.
+    unsigned int threadCount;    ///< The amount of threads compressing the strips of a part.
+    unsigned int maxChainLength; ///< The maximum amount of previous occurrences searched for a match.
+
+    std::vector<unsigned char> history; ///< The last 32 KiB of the previous parts, followed by the current part.
+    uint64_t historyStart;              ///< The position in the stream of the first byte of the history.
+    std::vector<int64_t> head;          ///< The last position of each hash, -1 if there is none.
+    std::vector<int64_t> previous;      ///< The previous position with the same hash, indexed modulo the window.
+    uint64_t insertedEnd;               ///< The position in the stream before which every position was inserted.
+
+    uint64_t bitBuffer;     ///< The bits written but not yet output, the oldest one being the least significant.
+    unsigned int bitCount;  ///< The amount of bits in the buffer.
+    uint32_t adlerA;        ///< The first sum of the Adler-32 checksum of the uncompressed data.
+    uint32_t adlerB;        ///< The second sum of the Adler-32 checksum of the uncompressed data.
+    bool started;           ///< Whether the zlib header was written.
+};
@@ -0,0 +1,129 @@
+/***************************************************************************************************
+ * @file  ImageWriter.hpp
+ * @brief Declaration of the ImageWriter class
+ **************************************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Deflate.hpp"
+#include "image.h"
+
+/**
+ * @class ImageWriter
+ * @brief Writes an 8-bit image to a file a few rows at a time, from the top row to the bottom one, so that the whole
+ * image never has to be held in memory. The pixels have 1 (gray), 3 (RGB) or 4 (RGBA) channels.
+ *
+ * PNG images get one IDAT chunk per call to writeRows, whose rows are compressed in parallel strips at the chosen
+ * level. PPM and QOI images are much faster to write, for intermediate outputs: PPM images are uncompressed and lose
+ * their alpha channel, QOI images are losslessly compressed in a single pass.
+ */
+class ImageWriter {
+public:
+    /**
+     * @enum ImageWriter::Format
+     * @brief Enumeration of the file formats an image can be written in.
+     */
+    enum class Format : unsigned char {
+        PNG, ///< Deflate compressed.
+        PPM, ///< Binary portable graymap (P5) or pixmap (P6), uncompressed and without the alpha channel.
+        QOI  ///< The Quite OK Image format, gray images being written as RGB.
+    };
+
+    /**
+     * @brief Constructor. Opens the file and writes the image's header, the format being chosen from the extension.
+     * @param path The path to the file.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @param channels The amount of channels of the pixels: 1, 3 or 4.
+     * @param compressionLevel The compression level of PNG images, from 0 (the fastest) to 9 (the smallest).
+     * @param threadCount The amount of threads compressing the rows of PNG images.
+     */
+    ImageWriter(const std::string& path, unsigned int width, unsigned int height, unsigned int channels = 4,
+                unsigned int compressionLevel = Deflate::defaultLevel,
+                unsigned int threadCount = std::thread::hardware_concurrency());
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    /**
+     * @brief Gets the format of an image file from its extension: ".ppm" and ".pgm" for PPM, ".qoi" for QOI, PNG
+     * otherwise.
+     * @param path The path to the file.
+     * @return The file format.
+     */
+    static Format getFormat(const std::string& path);
+
+    /**
+     * @brief Gets the usual extension of a file format.
+     * @param format The file format.
+     * @return The extension, with its dot.
+     */
+    static const char* getExtension(Format format);
+
+    /**
+     * @brief Writes a whole image, quantised like gkit's write_image: each channel is clamped to [0, 255] after being
+     * multiplied by 255, then truncated.
+     * @param image The image.
+     * @param path The path to the file, whose extension gives the format.
+     * @param flipY Whether the image's first row is the bottom of the file, as with write_image.
+     * @param compressionLevel The compression level of PNG images.
+     */
+    static void write(const Image& image, const std::string& path, bool flipY = true,
+                      unsigned int compressionLevel = Deflate::defaultLevel);
+
+    /**
+     * @brief Writes the next rows of the image.
+     * @param pixels The pixels of the rows, with as many bytes as channels, the top row first.
+     * @param rowCount The amount of rows.
+     */
+    void writeRows(const unsigned char* pixels, unsigned int rowCount);
+
+    /**
+     * @brief Ends the file once every row was written and closes it.
+     */
+    void close();
+
+private:
+    /**
+     * @brief Writes a PNG chunk.
+     * @param type The type of the chunk, 4 characters.
+     * @param data The data of the chunk.
+     */
+    void writeChunk(const char* type, const std::vector<unsigned char>& data);
+
+    /**
+     * @brief Appends a PNG row to the data to compress, with the filter whose output has the lowest sum of absolute
+     * values, the heuristic recommended by the PNG specification.
+     * @param row The pixels of the row.
+     */
+    void filterRow(const unsigned char* row);
+
+    /**
+     * @brief Appends the QOI chunks of a row to the data to write.
+     * @param row The pixels of the row.
+     */
+    void encodeQOIRow(const unsigned char* row);
+
+    std::string path;         ///< The path to the file.
+    std::ofstream file;       ///< The file.
+    unsigned int width;       ///< The image's width.
+    unsigned int height;      ///< The image's height.
+    unsigned int channels;    ///< The amount of channels of the pixels.
+    Format format;            ///< The file format.
+    unsigned int rowsWritten; ///< The amount of rows written.
+
+    Deflate deflate;                        ///< Compresses the rows of a PNG image.
+    std::vector<unsigned char> previousRow; ///< The last row written, which the PNG filters predict from.
+    std::vector<unsigned char> filtered;    ///< The filtered rows waiting to be compressed.
+    std::vector<unsigned char> candidates;  ///< The row filtered with each filter.
+    std::vector<unsigned char> encoded;     ///< The compressed or converted rows waiting to be written.
+
+    std::array<std::array<unsigned char, 4>, 64> qoiIndex; ///< The RGBA pixels seen by the QOI encoder, by hash.
+    std::array<unsigned char, 4> qoiPrevious;              ///< The previous pixel encoded in QOI.
+    unsigned int qoiRun;                                   ///< The amount of repetitions of the previous QOI pixel.
+};
@@ -5,8 +5,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <span>
 #include <vector>
-#include "Object.hpp"
+#include "Primitives.hpp"
+#include "ThreadPool.hpp"
 #include "vec.h"
 
 /**
@@ -16,6 +20,28 @@
  */
 class BVH {
 public:
+    /**
+     * @enum BVH::BuildMethod
+     * @brief Enumeration of the strategies used to split a node in two when building the BVH.
+     */
+    enum class BuildMethod : unsigned char {
+        Midpoint, ///< Splits at the middle of the longest axis, stops at 2 primitives per leaf.
+        SAH,      ///< Splits using a binned Surface Area Heuristic, stops when splitting costs more than a leaf.
+        LBVH,     ///< Sorts the primitives along a Morton curve and builds the radix tree of their codes, in O(n).
+        TRBVH     ///< Builds a LBVH, then restructures its treelets of BVH::treeletSize leaves with the SAH.
+    };
+
+    /**
+     * @enum BVH::Layout
+     * @brief Enumeration of the memory layouts the BVH can be traversed with.
+     */
+    enum class Layout : unsigned char {
+        Binary, ///< Each node has 2 children, tested one at a time.
+        Wide4,  ///< The binary tree collapsed into nodes of up to 4 children, tested together with SIMD instructions.
+        Wide8   ///< The binary tree collapsed into nodes of up to 8 children, tested together with SIMD instructions
+                ///< (a single AVX test with the SYNTHESE_AVX CMake option, two SSE tests otherwise).
+    };
+
     /**
      * @struct BVH::Node
      * @brief A node in the BVH's tree, represents an AABB (Axis-Aligned Bounding Box).
@@ -24,53 +50,309 @@ public:
         Point pmin; ///< The lower bound of the bounding box.
         Point pmax; ///< The higher bound of the bounding box.
         uint left; ///< The index of the left child. The right child isn't necessary since it's always left + 1.
-        uint firstObjectIndex; ///< The index of the first object encompassed by the bounding box.
-        uint objectCount; ///< The amount of objects encompassed by the bounding box.
+        uint firstPrimitiveIndex; ///< The index of the first primitive encompassed by the bounding box.
+        uint primitiveCount; ///< The amount of primitives encompassed by the bounding box.
 
         /**
          * @brief Checks if the node is a leaf.
          * @return Whether the node is a leaf or not.
          */
-        bool isLeaf() const { return objectCount > 0; }
+        bool isLeaf() const { return primitiveCount > 0; }
+
+        /**
+         * @brief Calculates the surface area of the bounding box.
+         * @return The surface area of the bounding box.
+         */
+        float getSurfaceArea() const;
 
         /**
-         * @brief Checks if a ray intersects with a bounding box.
+         * @brief Calculates the distance at which a ray enters the bounding box, within the ray's interval. The near and
+         * far planes of each slab are picked with the ray's signs, so the test only multiplies by the ray's inverse
+         * direction and has no branch.
          * @param ray The ray to check the intersection with.
-         * @return Whether a ray intersects with the bounding box.
+         * @param tMax The distance after which intersections are ignored, in addition to the ray's own tMax.
+         * @return The entry distance, clamped to the ray's tMin if the ray starts inside the bounding box. If the ray
+         * misses the bounding box in its interval, returns infinity.
          */
-        bool intersect(const Ray& ray) const;
+        float intersect(const Ray& ray, float tMax = infinity) const;
     };
 
     /**
-     * Constructor. Initializes all values but doesn't initialize the BVH yet. Call BVH::initialize() once all objects
-     * have been added to the scene.
-     * @param objects A reference to the objects in a scene.
+     * @struct BVH::WideNode
+     * @brief A node with up to Width children obtained by collapsing the binary tree. The bounding boxes of the children
+     * are stored as a structure of arrays so that all of them can be tested against a ray at once.
+     * @tparam Width The maximum amount of children, a multiple of 4.
      */
-    explicit BVH(std::vector<const Object*>& objects);
+    template<uint Width>
+    struct alignas(32) WideNode {
+        float minX[Width]; ///< The lower bounds of the children's bounding boxes on the x axis.
+        float minY[Width]; ///< The lower bounds of the children's bounding boxes on the y axis.
+        float minZ[Width]; ///< The lower bounds of the children's bounding boxes on the z axis.
+        float maxX[Width]; ///< The higher bounds of the children's bounding boxes on the x axis.
+        float maxY[Width]; ///< The higher bounds of the children's bounding boxes on the y axis.
+        float maxZ[Width]; ///< The higher bounds of the children's bounding boxes on the z axis.
+        uint child[Width]; ///< The index of each inner child's node, or of each leaf's first primitive.
+        uint primitiveCount[Width]; ///< The amount of primitives in each leaf, 0 for inner children.
+        uint childCount; ///< The amount of children actually used.
+    };
+
+    /**
+     * Constructor. Initializes all values but doesn't initialize the BVH yet. Call BVH::initialize() once all primitives
+     * have been added to the set.
+     * @param primitives A reference to the primitives the BVH is built over.
+     */
+    explicit BVH(const Primitives& primitives);
 
     /**
      * @brief Initializes the BVH. Creates the root, calculates its bounds and calls the subdivide method on it.
+     * @param threadPool The pool to build the BVH with, nullptr to build it on the calling thread. The subtrees, bounds
+     * and bins of nodes with at least BVH::parallelPrimitiveCount primitives are computed in parallel tasks, so the
+     * primitives must support concurrent calls to their const methods.
+     */
+    void initialize(ThreadPool* threadPool = nullptr);
+
+    /**
+     * @brief Initializes the BVH from a tree built beforehand over the same primitives, e.g. read from a MeshCache,
+     * instead of building it. The wide nodes of the current layout are collapsed from the given binary nodes.
+     * @param nodes The binary nodes of the tree, the root first.
+     * @param primitiveIndices The indices of the primitives, in the order the leaves refer to them.
+     */
+    void load(std::span<const Node> nodes, std::span<const uint> primitiveIndices);
+
+    /**
+     * @brief Recomputes the bounds of the nodes after the primitives moved, keeping the tree and the order of the
+     * primitive indices. The leaves get the bounds of their primitives, then each inner node the union of its children
+     * once both are done, bottom-up. Much faster than building the tree again, but the tree gets worse as the
+     * primitives move away from where it was built. The wide nodes of the current layout are collapsed again.
+     * @param threadPool The pool to refit the BVH with, nullptr to refit it on the calling thread. The leaves are
+     * split in chunks refitted in parallel, so the primitives must support concurrent calls to their const methods.
+     * @throw std::invalid_argument If the amount of primitives changed since the tree was built.
+     */
+    void refit(ThreadPool* threadPool = nullptr);
+
+    /**
+     * @return Whether the BVH was initialized over at least one primitive.
+     */
+    bool isBuilt() const;
+
+    /**
+     * @brief Changes the strategy used to split nodes. Only taken into account on the next call to BVH::initialize().
+     * @param method The build method.
      */
-    void initialize();
+    void setBuildMethod(BuildMethod method);
 
     /**
-     * @brief Recursively calculates the intersection between a ray and the BVH starting at the root.
+     * @return The strategy used to split nodes.
+     */
+    BuildMethod getBuildMethod() const;
+
+    /**
+     * @brief Changes the layout used to traverse the BVH. If the BVH is already built, its nodes are collapsed again
+     * right away.
+     * @param layout The layout.
+     */
+    void setLayout(Layout layout);
+
+    /**
+     * @return The layout used to traverse the BVH.
+     */
+    Layout getLayout() const;
+
+    /**
+     * @return The amount of nodes in the BVH.
+     */
+    uint getNodeCount() const;
+
+    /**
+     * @return The binary nodes of the tree, the root first, whatever the layout.
+     */
+    std::span<const Node> getNodes() const;
+
+    /**
+     * @return The indices of the primitives, in the order the leaves refer to them.
+     */
+    std::span<const uint> getPrimitiveIndices() const;
+
+    /**
+     * @brief Calculates the Surface Area Heuristic cost of the whole tree, i.e. the expected cost of a ray traversing
+     * it. Each node costs BVH::traversalCost and each primitive BVH::intersectionCost, weighted by the probability of a ray
+     * hitting the node knowing it hit the root, which is the ratio of their surface areas.
+     * @return The SAH cost of the tree. Lower is better.
+     */
+    float getSAHCost() const;
+
+    /**
+     * @brief Gets the bounding box of all the primitives of the BVH.
+     * @param pmin Will store the lower bound of the bounding box.
+     * @param pmax Will store the higher bound of the bounding box.
+     * @return Whether the BVH contains any primitive. If not, pmin and pmax are left untouched.
+     */
+    bool getBounds(Point& pmin, Point& pmax) const;
+
+    static constexpr float traversalCost = 1.0f;    ///< The SAH cost of visiting a node.
+    static constexpr float intersectionCost = 1.0f; ///< The SAH cost of intersecting a primitive.
+    static constexpr uint binCount = 16;            ///< The amount of bins per axis used by the SAH builder.
+    static constexpr uint maxDepth = 64;            ///< The maximum depth of the tree, bounds the traversal stack.
+    static constexpr uint maxPacketSize = 64;       ///< The maximum amount of rays traced together as a packet.
+    static constexpr uint minPacketRayCount = 4;    ///< Below this many rays in a node, a packet falls back to single rays.
+    static constexpr uint parallelPrimitiveCount = 4096; ///< Nodes with this many primitives are built in parallel.
+    static constexpr uint parallelChunkSize = 1024;      ///< The minimum amount of primitives per parallel chunk.
+    static constexpr uint wideMortonCount = 1 << 18;     ///< From this many primitives, Morton codes have 63 bits.
+    static constexpr uint maxLeafSize = 8;               ///< The most primitives the linear builders put in a leaf.
+    static constexpr uint treeletSize = 7;               ///< The amount of leaves of the treelets TRBVH restructures.
+
+    /**
+     * @brief Calculates the intersection between a ray and the BVH. Traverses the tree iteratively with an explicit
+     * stack, always visits the nearest child first and skips the nodes the ray enters after the closest hit found so
+     * far.
      * @param ray The ray to check the intersection with.
-     * @return The information on the hit object. If no object is hit, the intersection will be set to infinity.
+     * @return The information on the hit primitive. If no primitive is hit, the intersection will be set to infinity.
      */
     Hit intersect(const Ray& ray) const;
 
+    /**
+     * @brief Calculates the intersection between a ray and the BVH, ignoring everything after a hit that was already
+     * found, e.g. in another BVH.
+     * @param ray The ray to check the intersection with.
+     * @param closest The closest hit found so far. Replaced by any closer hit.
+     */
+    void intersect(const Ray& ray, Hit& closest) const;
+
+    /**
+     * @brief Calculates the intersections between a packet of coherent rays, e.g. neighbouring camera rays, and the
+     * BVH. The rays share a single traversal of the binary tree: every node is tested against all the rays still
+     * inside it with SIMD instructions, and it is visited if any of them hits it. Once fewer than
+     * BVH::minPacketRayCount rays are left in a subtree, it is traversed by each of them on its own.
+     * @param rays The rays.
+     * @param count The amount of rays, at most BVH::maxPacketSize.
+     * @param closest The closest hit found so far by each ray. Replaced by any closer hit.
+     */
+    void intersect(const Ray* rays, uint count, Hit* closest) const;
+
+    /**
+     * @brief Checks if any primitive of the BVH intersects a ray before a certain distance. Stops at the first
+     * intersection found, which makes it cheaper than BVH::intersect when only visibility matters, e.g. for shadow rays.
+     * @param ray The ray to check the intersection with.
+     * @param tMax The distance after which intersections are ignored.
+     * @return Whether a primitive intersects the ray between its origin and tMax.
+     */
+    bool occluded(const Ray& ray, float tMax) const;
+
 private:
     /**
-     * @brief Recursively calculates the intersection between a ray and the BVH starting at a specific node.
+     * @brief Calculates the intersection between a ray and the subtree of a node of the binary tree.
      * @param ray The ray to check the intersection with.
-     * @param nodeIndex The index of the node.
-     * @return The information on the hit object. If no object is hit, the intersection will be set to infinity.
+     * @param nodeIndex The index of the subtree's root.
+     * @param closest The closest hit found so far. Replaced by any closer hit.
      */
-    Hit intersect(const Ray& ray, uint nodeIndex) const;
+    void intersect(const Ray& ray, uint nodeIndex, Hit& closest) const;
 
     /**
-     * @brief Updates the bounds of a given node. Iterates through all the objects encompassed by the node to calculate
+     * @brief Calculates the intersection between a ray and the collapsed BVH.
+     * @tparam Width The maximum amount of children per node.
+     * @param ray The ray to check the intersection with.
+     * @param closest The closest hit found so far. Replaced by any closer hit.
+     * @param wideNodes The collapsed nodes.
+     */
+    template<uint Width>
+    void intersect(const Ray& ray, Hit& closest, const std::vector<WideNode<Width>>& wideNodes) const;
+
+    /**
+     * @brief Checks if any primitive of the collapsed BVH intersects a ray before a certain distance.
+     * @tparam Width The maximum amount of children per node.
+     * @param ray The ray to check the intersection with.
+     * @param tMax The distance after which intersections are ignored.
+     * @param wideNodes The collapsed nodes.
+     * @return Whether a primitive intersects the ray between its origin and tMax.
+     */
+    template<uint Width>
+    bool occluded(const Ray& ray, float tMax, const std::vector<WideNode<Width>>& wideNodes) const;
+
+    /**
+     * @brief Recursively collapses the subtree of a binary node into wide nodes. The children of the wide node are
+     * found by repeatedly replacing the inner child with the biggest surface area by its own two children.
+     * @tparam Width The maximum amount of children per node.
+     * @param nodeIndex The index of the binary node.
+     * @param wideNodes The collapsed nodes the new nodes are added to.
+     * @return The index of the created wide node.
+     */
+    template<uint Width>
+    uint collapse(uint nodeIndex, std::vector<WideNode<Width>>& wideNodes) const;
+
+    /**
+     * @brief Collapses the binary tree into the wide nodes of the current layout, if it isn't binary.
+     */
+    void collapse();
+
+    /**
+     * @brief Calculates how many chunks a range of primitives is split into by BVH::parallelFor.
+     * @param count The size of the range.
+     * @return The amount of chunks, 1 if the range is processed on the calling thread.
+     */
+    uint getChunkCount(uint count) const;
+
+    /**
+     * @brief Splits a range of primitives into chunks processed in parallel on the build's thread pool. The range is
+     * processed as a single chunk on the calling thread if there is no pool or if it is too small.
+     * @param count The size of the range.
+     * @param body Called with the index of each chunk and its first and past-the-end indices in the range.
+     */
+    void parallelFor(uint count, const std::function<void(uint chunk, uint first, uint last)>& body) const;
+
+    /**
+     * @struct BVH::LinearNode
+     * @brief A node of the radix tree built by the linear builders, before the tree is laid out in BVH::nodes. The
+     * inner nodes come first, followed by one leaf per primitive in the order of their Morton codes.
+     */
+    struct LinearNode {
+        Point pmin;          ///< The lower bound of the bounding box.
+        Point pmax;          ///< The higher bound of the bounding box.
+        uint child[2];       ///< The indices of the children, for inner nodes.
+        uint primitiveCount; ///< The amount of primitives in the subtree.
+        float cost;          ///< The SAH cost of the subtree, not divided by the root's surface area.
+        bool collapsed;      ///< Whether the subtree is cheaper as a single leaf, always true for leaves.
+    };
+
+    /**
+     * @brief Builds the tree with a linear builder: the primitives are sorted by the Morton codes of their centroids,
+     * the radix tree of the codes is emitted bottom-up along with its bounds and SAH costs, in a single pass over the
+     * primitives, restructuring the treelets with TRBVH (Karras and Aila, "Fast Parallel Construction of High-Quality
+     * Bounding Volume Hierarchies", 2013), and the subtrees cheaper as leaves are collapsed when the nodes are laid
+     * out.
+     */
+    void buildLinear();
+
+    /**
+     * @brief Sorts the primitive indices by their Morton codes, with a parallel least significant digit radix sort.
+     * @param codes The Morton code of each primitive index, sorted along with them.
+     * @param codeBits The amount of bits of the codes.
+     */
+    void sortMortonCodes(std::vector<uint64_t>& codes, uint codeBits);
+
+    /**
+     * @brief Replaces the treelet of the radix tree rooted at a node by the topology with the lowest SAH cost, found by
+     * dynamic programming over the subsets of its leaves. The treelet grows from the node by repeatedly expanding its
+     * leaf with the biggest surface area, up to BVH::treeletSize leaves. Its inner nodes are reused.
+     * @param nodeIndex The index of the treelet's root, whose subtrees are complete.
+     * @param linearNodes The nodes of the radix tree.
+     */
+    void optimizeTreelet(uint nodeIndex, std::vector<LinearNode>& linearNodes) const;
+
+    /**
+     * @brief Recursively lays out the subtree of a node of the radix tree in BVH::nodes, both children of a node being
+     * next to each other. Collapsed subtrees become leaves, as do the nodes at the maximum depth.
+     * @param linearIndex The index of the node in the radix tree.
+     * @param nodeIndex The index of the node in BVH::nodes.
+     * @param firstPrimitive The index in BVH::primitiveIndices of the first primitive of the subtree.
+     * @param depth The depth of the node, the root being at depth 0.
+     * @param linearNodes The nodes of the radix tree.
+     * @param sortedIndices The indices of the primitives in the order of the leaves of the radix tree.
+     */
+    void layOutLinear(uint linearIndex, uint nodeIndex, uint firstPrimitive, uint depth,
+                      const std::vector<LinearNode>& linearNodes, const std::vector<uint>& sortedIndices);
+
+    /**
+     * @brief Updates the bounds of a given node. Iterates through all the primitives encompassed by the node to calculate
      * its lower and higher bounds.
      * @param nodeIndex The index of the node.
      */
@@ -79,12 +361,39 @@ private:
     /**
      * @brief Recursively subdivides a given node
      * @param nodeIndex The index of the node.
+     * @param depth The depth of the node, the root being at depth 0.
+     */
+    void subdivide(uint nodeIndex, uint depth);
+
+    /**
+     * @brief Finds the split position of a node using the midpoint of the longest axis of its bounding box.
+     * @param node The node to split.
+     * @param axis Will store the axis of the split.
+     * @param position Will store the position of the split along the axis.
+     * @return Whether the node should be split.
+     */
+    bool findMidpointSplit(const Node& node, int& axis, float& position) const;
+
+    /**
+     * @brief Finds the best split position of a node by binning the centroids of its primitives along each axis and
+     * evaluating the Surface Area Heuristic at every bin boundary.
+     * @param node The node to split.
+     * @param axis Will store the axis of the split.
+     * @param position Will store the position of the split along the axis.
+     * @return Whether splitting the node costs less than keeping it as a leaf.
      */
-    void subdivide(uint nodeIndex);
+    bool findSAHSplit(const Node& node, int& axis, float& position) const;
 
-    const std::vector<const Object*>& objects; ///< A reference to the objects in a scene.
-    std::vector<uint> objectIndices;           ///< The indices of the objects. Used to avoid copies of bigger objects.
-    std::vector<Node> nodes;                   ///< The BVH's nodes.
-    uint usedNodes;                            ///< The amount of nodes currently in the BHV.
-    uint rootIndex;                            ///< The index of the root, usually 0.
+    const Primitives& primitives;       ///< A reference to the primitives the BVH is built over.
+    uint primitiveCount;                ///< The amount of primitives when the BVH was initialized.
+    std::vector<uint> primitiveIndices; ///< The indices of the primitives, sorted so that each leaf is a range.
+    std::vector<Node> nodes;            ///< The BVH's nodes.
+    std::atomic<uint> usedNodes;        ///< The amount of nodes currently in the BHV.
+    uint rootIndex;                     ///< The index of the root, usually 0.
+    BuildMethod buildMethod;            ///< The strategy used to split nodes.
+    Layout layout;                      ///< The layout used to traverse the BVH.
+    std::vector<WideNode<4>> nodes4;    ///< The nodes collapsed to 4 children, used by Layout::Wide4.
+    std::vector<WideNode<8>> nodes8;    ///< The nodes collapsed to 8 children, used by Layout::Wide8.
+    std::vector<Point> centroids;       ///< The centroid of each primitive, cached while building.
+    ThreadPool* threadPool;             ///< The pool the BVH is being built with, nullptr outside of a parallel build.
 };
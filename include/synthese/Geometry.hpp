@@ -0,0 +1,209 @@
+/***************************************************************************************************
+ * @file  Geometry.hpp
+ * @brief Declaration of the Geometry class
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "BVH.hpp"
+#include "Hit.hpp"
+#include "MaterialTable.hpp"
+#include "mat4.hpp"
+#include "MeshStore.hpp"
+#include "Object.hpp"
+#include "Primitives.hpp"
+#include "Ray.hpp"
+#include "ThreadPool.hpp"
+#include "vec.h"
+
+/**
+ * @struct Instance
+ * @brief A placement of a mesh of the store in the scene.
+ */
+struct Instance {
+    uint mesh;              ///< The index of the mesh in the store.
+    mat4 transform;         ///< The transform from the mesh's object space to the scene.
+    mat4 inverseTransform;  ///< The transform from the scene to the mesh's object space, applied to the rays.
+    mat4 normalTransform;   ///< The inverse transpose of the transform, applied to the normals.
+    MaterialID material;    ///< The instance's material, or MaterialTable::meshMaterials to use its mesh's ones.
+    Point pmin;             ///< The lower bound of the instance's bounding box in the scene.
+    Point pmax;             ///< The higher bound of the instance's bounding box in the scene.
+};
+
+/**
+ * @class Geometry
+ * @brief The bounded geometry of a scene: its objects and the instances of the meshes of its mesh store, seen as a
+ * single set of primitives by the scene's top level BVH. The first primitives are the objects, followed by the
+ * instances. Rays reaching an instance are transformed into the object space of its mesh and traverse the mesh's own
+ * BVH, so a mesh placed several times is only stored and built once.
+ */
+class Geometry : public Primitives {
+public:
+    /**
+     * @brief Default constructor.
+     */
+    Geometry() = default;
+
+    /**
+     * @brief Destructor. Frees all the objects.
+     */
+    ~Geometry() override;
+
+    Geometry(const Geometry&) = delete;
+    Geometry& operator=(const Geometry&) = delete;
+
+    /**
+     * @brief Add an object to the geometry. The geometry takes ownership of the object.
+     * @param object The object. Its material must be in the geometry's material table.
+     */
+    void add(const Object* object);
+
+    /**
+     * @brief Places a mesh of the store in the geometry.
+     * @param mesh The index of the mesh in the store.
+     * @param transform The transform applied to the mesh. Must be invertible.
+     * @param material The instance's material, or MaterialTable::meshMaterials to use the materials of the mesh's
+     * triangles.
+     * @return The index of the instance.
+     */
+    uint addInstance(uint mesh, const mat4& transform, MaterialID material);
+
+    /**
+     * @brief Moves an instance. Its bounding box is only updated by the next call to Geometry::initialize.
+     * @param instance The index of the instance.
+     * @param transform The new transform applied to the mesh. Must be invertible.
+     */
+    void setInstanceTransform(uint instance, const mat4& transform);
+
+    /**
+     * @brief Builds the BVH of every mesh of the store and computes the bounds of the instances. Must be called before
+     * building or refitting a BVH over the geometry. The BVHs already built with the same method, e.g. loaded from a MeshCache, are
+     * kept.
+     * @param method The strategy used to split the nodes of the meshes' BVHs.
+     * @param layout The layout used to traverse the meshes' BVHs.
+     * @param threadPool The pool the meshes' BVHs are built with, each mesh being its own task. nullptr to build them
+     * on the calling thread.
+     */
+    void initialize(BVH::BuildMethod method, BVH::Layout layout, ThreadPool* threadPool = nullptr);
+
+    /**
+     * @return The geometry's objects.
+     */
+    const std::vector<const Object*>& getObjects() const;
+
+    /**
+     * @return The geometry's mesh instances.
+     */
+    const std::vector<Instance>& getInstances() const;
+
+    /**
+     * @return The store holding the meshes.
+     */
+    MeshStore& getMeshStore();
+
+    /**
+     * @return The materials the objects and the instances refer to.
+     */
+    MaterialTable& getMaterials();
+
+    /**
+     * @return The materials the objects and the instances refer to.
+     */
+    const MaterialTable& getMaterials() const;
+
+    /**
+     * @brief Checks that a material is in the geometry's table.
+     * @param material The ID of the material.
+     * @throw std::out_of_range If the material isn't in the table.
+     */
+    void checkMaterial(MaterialID material) const;
+
+    /**
+     * @return The store holding the meshes.
+     */
+    const MeshStore& getMeshStore() const;
+
+    /**
+     * @brief Evaluates the material of the hit primitive.
+     * @param hit The hit.
+     * @param point The point where the color is evaluated.
+     * @return The color of the primitive at this point.
+     */
+    Color getColor(const Hit& hit, const Point& point) const;
+
+    /**
+     * @brief Computes the normal of the hit object, or of the hit mesh triangle from the hit's barycentric coordinates
+     * in the scene's space. The intersection skips it so that it is only computed for the closest hit.
+     * @param ray The ray that hit the primitive.
+     * @param hit The hit. Left untouched if nothing is hit.
+     */
+    void computeNormal(const Ray& ray, Hit& hit) const;
+
+    /**
+     * @return The amount of primitives: objects and mesh instances.
+     */
+    uint getPrimitiveCount() const override;
+
+    /**
+     * @brief Calculates the centroid (barycenter) of a primitive.
+     * @param primitive The index of the primitive.
+     * @return The centroid of the primitive.
+     */
+    Point getCentroid(uint primitive) const override;
+
+    /**
+     * @brief Compares a primitive to a bounding box. Replaces the values of pmin and pmax's components if they are
+     * respectively lower or higher.
+     * @param primitive The index of the primitive.
+     * @param pmin The bounding box's current lower bound.
+     * @param pmax The bounding box's current higher bound.
+     */
+    void compareBoundingBox(uint primitive, Point& pmin, Point& pmax) const override;
+
+    /**
+     * @brief Calculates the intersection between a ray and some primitives and keeps the closest one.
+     * @param primitives The indices of the primitives.
+     * @param count The amount of primitives.
+     * @param ray The ray to calculate the intersection with.
+     * @param closest The closest hit found so far. Replaced by any closer hit.
+     */
+    void intersect(const uint* primitives, uint count, const Ray& ray, Hit& closest) const override;
+
+    /**
+     * @brief Calculates the intersections between some rays of a packet and some primitives and keeps the closest
+     * one for each ray. The rays reaching an instance are transformed together and stay a packet in the mesh's BVH.
+     * @param primitives The indices of the primitives.
+     * @param count The amount of primitives.
+     * @param rays The rays of the packet.
+     * @param mask The rays to calculate the intersections with, one bit per ray.
+     * @param closest The closest hit found so far by each ray. Replaced by any closer hit.
+     */
+    void intersect(const uint* primitives, uint count, const Ray* rays, uint64_t mask, Hit* closest) const override;
+
+    /**
+     * @brief Checks if any of some primitives intersects a ray before a certain distance.
+     * @param primitives The indices of the primitives.
+     * @param count The amount of primitives.
+     * @param ray The ray to check the intersection with.
+     * @param tMax The distance after which intersections are ignored.
+     * @return Whether a primitive intersects the ray between its origin and tMax.
+     */
+    bool occluded(const uint* primitives, uint count, const Ray& ray, float tMax) const override;
+
+private:
+    /**
+     * @brief Transforms a ray into the object space of an instance. The direction isn't normalized so that distances
+     * along the ray are the same in both spaces.
+     * @param instance The instance.
+     * @param ray The ray in the scene's space.
+     * @return The ray in the instance's object space.
+     */
+    static Ray toObjectSpace(const Instance& instance, const Ray& ray);
+
+    std::vector<const Object*> objects; ///< The objects.
+    std::vector<Instance> instances;    ///< The mesh instances.
+    MeshStore meshStore;                ///< The meshes.
+    MaterialTable materials;            ///< The materials of the objects and the instances.
+};
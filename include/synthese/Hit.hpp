@@ -30,6 +30,10 @@ struct Hit {
     Hit(float intersection, const Vector& normal);
 
     float intersection;   ///< The hit's intersection.
-    Vector normal;        ///< The hit's normal.
-    const Object* object; ///< A pointer to the hit object.
+    Vector normal;        ///< The hit's normal, only computed for the closest hit of a ray.
+    const Object* object; ///< A pointer to the hit object, nullptr for primitives that aren't objects.
+    uint primitive;       ///< The index of the hit object in the geometry, or of the hit triangle in the mesh store.
+    uint instance;        ///< The index of the hit mesh instance in the geometry, -1u if no mesh is hit.
+    float u;              ///< For triangles, the barycentric coordinate of the hit relative to the second vertex.
+    float v;              ///< For triangles, the barycentric coordinate of the hit relative to the third vertex.
 };
@@ -0,0 +1,75 @@
+/***************************************************************************************************
+ * @file  ImageStream.hpp
+ * @brief Declaration of the ImageStream class
+ **************************************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "color.h"
+#include "ImageWriter.hpp"
+
+/**
+ * @class ImageStream
+ * @brief Gathers the tiles rendered by several threads into horizontal bands of an image and hands the completed bands
+ * to an ImageWriter in order, from the top of the file. The bands are quantised to 8 bits as soon as their tiles arrive
+ * and stored in a small ring of slots, so the memory used doesn't depend on the image's height. A thread adding a tile
+ * to a band whose slot is still taken waits for it to be written. The tiles use the coordinates of the renders, row 0
+ * being the bottom of the file.
+ */
+class ImageStream {
+public:
+    /**
+     * @brief Constructor.
+     * @param writer The writer the bands are written with, which must outlive the stream.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @param bandHeight The amount of rows of a band, the tiles must not overlap two bands.
+     * @param slotCount The amount of bands held in memory at once, more than the amount of threads adding tiles so that
+     * they rarely have to wait.
+     */
+    ImageStream(ImageWriter& writer, unsigned int width, unsigned int height, unsigned int bandHeight,
+                unsigned int slotCount);
+
+    /**
+     * @brief Adds a tile to its band. The thread completing the next band to write writes it, and the following
+     * complete bands.
+     * @param firstColumn The column of the tile's first pixel.
+     * @param firstRow The row of the tile's first pixel, counted from the bottom of the image.
+     * @param columns The tile's width.
+     * @param rows The tile's height.
+     * @param pixels The colors of the tile, row by row from the bottom.
+     */
+    void add(unsigned int firstColumn, unsigned int firstRow, unsigned int columns, unsigned int rows,
+             const Color* pixels);
+
+    /**
+     * @brief Closes the writer once every band was written.
+     */
+    void finish();
+
+private:
+    /**
+     * @brief Gets the rows of a band.
+     * @param band The band's index, from the top of the file.
+     * @param top Receives the band's top row, counted from the bottom of the image and excluded.
+     * @return The amount of rows of the band.
+     */
+    unsigned int getBandRows(unsigned int band, unsigned int& top) const;
+
+    ImageWriter& writer;     ///< Writes the completed bands.
+    unsigned int width;      ///< The image's width.
+    unsigned int height;     ///< The image's height.
+    unsigned int bandHeight; ///< The amount of rows of a band, the top band being shorter.
+    unsigned int bandCount;  ///< The amount of bands.
+
+    std::vector<std::vector<unsigned char>> slots; ///< The RGBA rows of the bands in memory, from the top of the file.
+    std::vector<unsigned int> remainingPixels;     ///< The amount of pixels each slot's band still waits for.
+    unsigned int nextBand;                         ///< The next band to write.
+    bool writing;                                  ///< Whether a thread is writing bands.
+
+    std::mutex mutex;                ///< Protects the state of the bands.
+    std::condition_variable written; ///< Notified whenever bands were written.
+};
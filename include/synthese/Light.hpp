@@ -43,22 +43,45 @@ struct Light {
     virtual LightType getType() const = 0;
 
     /**
-     * @brief Calculates the light for an intersection in a scene.
+     * @brief Calculates the light for an intersection in a scene. The shadow ray is only cast if the light can
+     * contribute.
      * @param hit The intersection we calculate the light for.
      * @param point The position of the hit object.
      * @param scene The scene we calculate the light for.
      * @return The color of the light at this intersection.
      */
-    virtual Color calculate(const Hit& hit, const Point& point, const Scene* scene) const = 0;
+    Color calculate(const Hit& hit, const Point& point, const Scene* scene) const;
+
+    /**
+     * @brief Calculates the light for an intersection as if nothing was between them.
+     * @param hit The intersection we calculate the light for.
+     * @param point The position of the hit object.
+     * @param shadowRay Receives the ray from the point towards the light, whose tMax is the distance to the light.
+     * @return The color of the light at this intersection if it isn't in shadow.
+     */
+    virtual Color calculateUnshadowed(const Hit& hit, const Point& point, Ray& shadowRay) const = 0;
+
+    /**
+     * @return The power of the light, roughly how much it can light up a point, used to sample the lights.
+     */
+    virtual float getPower() const = 0;
+
+    /**
+     * @brief Calculates the bounding box of the part of the scene the light can light up.
+     * @param pmin Receives the minimum point of the bounding box.
+     * @param pmax Receives the maximum point of the bounding box.
+     * @return Whether the light is bounded. Lights lighting up the whole scene return false and leave the box as is.
+     */
+    virtual bool getBoundingBox(Point& pmin, Point& pmax) const;
 
     /**
      * @brief Checks if a point is in the shadow cast by the light because of an object.
-     * @param object The object the point belongs to.
      * @param ray The ray with its origin being the point we want to check and pointing towards the light.
+     * @param distance The distance between the point and the light. Objects behind the light don't cast shadows.
      * @param scene The scene we calculate the light for.
-     * @return
+     * @return Whether an object is between the point and the light.
      */
-    static bool isInShadow(const Object* object, const Ray& ray, const Scene* scene);
+    static bool isInShadow(const Ray& ray, float distance, const Scene* scene);
 
     Color color; ///< The light's color.
 };
@@ -81,13 +104,18 @@ struct DirectionalLight : Light {
     LightType getType() const override;
 
     /**
-     * @brief Calculates the light for an intersection in a scene.
+     * @brief Calculates the light for an intersection as if nothing was between them.
      * @param hit The intersection we calculate the light for.
      * @param point The position of the hit object.
-     * @param scene The scene we calculate the light for.
-     * @return The color of the light at this intersection.
+     * @param shadowRay Receives the ray from the point towards the light, with an infinite tMax.
+     * @return The color of the light at this intersection if it isn't in shadow.
+     */
+    Color calculateUnshadowed(const Hit& hit, const Point& point, Ray& shadowRay) const override;
+
+    /**
+     * @return The power of the light's color.
      */
-    Color calculate(const Hit& hit, const Point& point, const Scene* scene) const override;
+    float getPower() const override;
 
     Vector direction; ///< The direction of the light. Goes "towards" the light and not "from" it.
 };
@@ -111,13 +139,26 @@ struct PointLight : Light {
     LightType getType() const override;
 
     /**
-     * @brief Calculates the light for an intersection in a scene.
+     * @brief Calculates the light for an intersection as if nothing was between them.
      * @param hit The intersection we calculate the light for.
      * @param point The position of the hit object.
-     * @param scene The scene we calculate the light for.
-     * @return The color of the light at this intersection.
+     * @param shadowRay Receives the ray from the point towards the light, whose tMax is the distance to the light.
+     * @return The color of the light at this intersection if it isn't in shadow.
+     */
+    Color calculateUnshadowed(const Hit& hit, const Point& point, Ray& shadowRay) const override;
+
+    /**
+     * @return The power of the light's color times its radius, the attenuation at the light's position.
+     */
+    float getPower() const override;
+
+    /**
+     * @brief Calculates the bounding box of the light's sphere, outside of which its windowing term is zero.
+     * @param pmin Receives the minimum point of the bounding box.
+     * @param pmax Receives the maximum point of the bounding box.
+     * @return true.
      */
-    Color calculate(const Hit& hit, const Point& point, const Scene* scene) const override;
+    bool getBoundingBox(Point& pmin, Point& pmax) const override;
 
     Point position; ///< The light's position.
     float radius;   ///< The light's radius.
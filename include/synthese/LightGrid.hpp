@@ -0,0 +1,110 @@
+/***************************************************************************************************
+ * @file  LightGrid.hpp
+ * @brief Declaration of the LightGrid class
+ **************************************************************************************************/
+
+#pragma once
+
+#include <span>
+#include <vector>
+#include "Light.hpp"
+#include "vec.h"
+
+/**
+ * @class LightGrid
+ * @brief A uniform grid over the bounding boxes of the bounded lights of a scene, e.g. the spheres of the point lights,
+ * listing in each cell the lights that can light up a point inside it. Shading a point then only goes through the
+ * lights of its cell instead of every light of the scene. The lights lighting up the whole scene are in every cell,
+ * and in an extra cell for the points outside of the grid. The lists keep the order in which the lights were added, so
+ * the lights are summed in the same order as without the grid.
+ *
+ * Each cell also has an alias table over the power of its lights, so that a light of a cell can be picked at random
+ * in constant time, whatever the amount of lights.
+ */
+class LightGrid {
+public:
+    static constexpr unsigned int cellsPerLight = 8;       ///< The amount of cells aimed for per bounded light.
+    static constexpr unsigned int maxCellCount = 1 << 18;  ///< The maximum amount of cells of the grid.
+    static constexpr unsigned int maxEntryCount = 1 << 22; ///< The amount of lights listed by the cells aimed under.
+
+    /**
+     * @brief Default constructor. Creates an empty grid.
+     */
+    LightGrid();
+
+    /**
+     * @brief Builds the grid over lights, replacing the previous one.
+     * @param lights The lights, whose indices are listed by the cells.
+     */
+    void build(std::span<const Light* const> lights);
+
+    /**
+     * @brief Gets the lights that can light up a point.
+     * @param point The point.
+     * @return The indices of the lights, in the order they were given to build.
+     */
+    std::span<const unsigned int> getLights(const Point& point) const;
+
+    /**
+     * @brief Picks one of the lights that can light up a point, with a probability proportional to its power.
+     * @param point The point.
+     * @param u A random number in [0, 1).
+     * @param probability Receives the probability of picking the light.
+     * @return The index of the light, -1u if none of the lights of the point has any power.
+     */
+    unsigned int sampleLight(const Point& point, float u, float& probability) const;
+
+    /**
+     * @return The amount of bounded lights in the grid.
+     */
+    unsigned int getBoundedLightCount() const;
+
+    /**
+     * @brief Gets the amount of cells of the grid along an axis.
+     * @param axis The axis, 0 for x, 1 for y and 2 for z.
+     * @return The amount of cells, 0 if the grid is empty.
+     */
+    unsigned int getResolution(unsigned int axis) const;
+
+private:
+    /**
+     * @struct LightGrid::AliasEntry
+     * @brief An entry of the alias table of a cell, for one of its lights.
+     */
+    struct AliasEntry {
+        float threshold;    ///< The probability of keeping this entry's light rather than taking its alias.
+        unsigned int alias; ///< The index in the cell of the light taken otherwise.
+        float probability;  ///< The probability of picking this entry's light in the cell.
+    };
+
+    /**
+     * @brief Finds the cell containing a point.
+     * @param point The point.
+     * @return The index of the cell, the extra cell's if the point is outside of the grid.
+     */
+    unsigned int findCell(const Point& point) const;
+
+    /**
+     * @brief Calculates the coordinate of the cell containing a coordinate along an axis of the grid.
+     * @param coordinate The coordinate, inside the grid.
+     * @param axis The axis.
+     * @return The cell's coordinate.
+     */
+    unsigned int getCell(float coordinate, unsigned int axis) const;
+
+    /**
+     * @brief Builds the alias table of every cell, Vose's method.
+     * @param lights The lights.
+     */
+    void buildAliasTables(std::span<const Light* const> lights);
+
+    float pmin[3];              ///< The minimum point of the grid.
+    float pmax[3];              ///< The maximum point of the grid.
+    float inverseCellSize[3];   ///< The inverse of the size of the cells along each axis.
+    unsigned int resolution[3]; ///< The amount of cells along each axis.
+
+    std::vector<unsigned int> cellStarts; ///< The index in cellLights of the first light of each cell, and the end.
+    std::vector<unsigned int> cellLights; ///< The indices of the lights of each cell, one cell after the other.
+    std::vector<AliasEntry> aliases;      ///< The alias table of each cell, an entry for each light of cellLights.
+    unsigned int boundedLightCount;       ///< The amount of bounded lights.
+};
@@ -0,0 +1,136 @@
+/***************************************************************************************************
+ * @file  MaterialTable.hpp
+ * @brief Declaration of the MaterialTable class
+ **************************************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+#include "color.h"
+#include "materials.h"
+#include "vec.h"
+
+using ColorFunc = std::function<Color(const Point&)>;
+using MaterialID = uint16_t;
+
+/**
+ * @class MaterialTable
+ * @brief The materials of a scene, referred to by the objects and the mesh instances with a 16-bit ID. Constant
+ * materials are shared by every primitive of the same color and evaluated inline, only the user procedural materials
+ * go through a ColorFunc.
+ */
+class MaterialTable {
+public:
+    /**
+     * @enum MaterialTable::Type
+     * @brief Enumeration of the ways a material computes its color.
+     */
+    enum class Type : unsigned char {
+        Constant,  ///< The same color everywhere.
+        Checker,   ///< Two colors alternating over the unit squares of the XZ plane.
+        Gradient,  ///< A linear interpolation between two colors along a segment, clamped at its ends.
+        Procedural ///< A user color function.
+    };
+
+    static constexpr MaterialID defaultMaterial = 0;    ///< A constant white material, present in every table.
+    static constexpr MaterialID meshMaterials = 0xFFFF; ///< Makes an instance use its mesh's materials.
+
+    /**
+     * @brief Default constructor. Creates the default material.
+     */
+    MaterialTable();
+
+    /**
+     * @brief Adds a constant material. Colors already in the table reuse their material.
+     * @param color The material's color.
+     * @return The ID of the material.
+     */
+    MaterialID add(const Color& color);
+
+    /**
+     * @brief Adds a procedural material.
+     * @param getColor The material's color function, evaluated in the scene's space.
+     * @return The ID of the material.
+     */
+    MaterialID add(const ColorFunc& getColor);
+
+    /**
+     * @brief Adds a checker material: the color of a point is given by the parity of floor(x) + floor(z).
+     * @param even The color of the squares where the parity is even.
+     * @param odd The color of the other squares.
+     * @return The ID of the material.
+     */
+    MaterialID addChecker(const Color& even, const Color& odd);
+
+    /**
+     * @brief Adds a gradient material: the color of a point is interpolated according to its projection on a segment.
+     * @param start The start of the segment.
+     * @param end The end of the segment.
+     * @param startColor The color at the start of the segment and before it.
+     * @param endColor The color at the end of the segment and after it.
+     * @return The ID of the material.
+     */
+    MaterialID addGradient(const Point& start, const Point& end, const Color& startColor, const Color& endColor);
+
+    /**
+     * @brief Adds a constant material for each material loaded by read_materials, using its diffuse color.
+     * @param materials The loaded materials.
+     * @return The ID of each material, in the same order.
+     */
+    std::vector<MaterialID> add(const Materials& materials);
+
+    /**
+     * @return The amount of materials in the table.
+     */
+    uint getMaterialCount() const;
+
+    /**
+     * @brief Evaluates a material.
+     * @param material The ID of the material.
+     * @param point The point where the color is evaluated, in the scene's space.
+     * @return The color of the material at this point.
+     */
+    Color evaluate(MaterialID material, const Point& point) const {
+        const Entry& entry = entries[material];
+        if(entry.type == Type::Constant) { return entry.color; }
+
+        return evaluatePattern(entry, point);
+    }
+
+private:
+    /**
+     * @struct MaterialTable::Entry
+     * @brief A material of the table.
+     */
+    struct Entry {
+        Type type;        ///< How the material computes its color.
+        Color color;      ///< The constant color, or the first color of a checker or a gradient.
+        Color otherColor; ///< The second color of a checker or a gradient.
+        Point origin;     ///< The start of a gradient's segment.
+        Vector axis;      ///< The segment of a gradient divided by its squared length.
+        uint procedural;  ///< The index of a procedural material's color function.
+    };
+
+    /**
+     * @brief Adds a material to the table.
+     * @param entry The material.
+     * @return The ID of the material.
+     */
+    MaterialID add(const Entry& entry);
+
+    /**
+     * @brief Evaluates a material that isn't constant.
+     * @param entry The material.
+     * @param point The point where the color is evaluated, in the scene's space.
+     * @return The color of the material at this point.
+     */
+    Color evaluatePattern(const Entry& entry, const Point& point) const;
+
+    std::vector<Entry> entries;                           ///< The materials, indexed by their ID.
+    std::vector<ColorFunc> procedurals;                   ///< The color functions of the procedural materials.
+    std::map<std::array<float, 4>, MaterialID> constants; ///< The constant materials, by color.
+};
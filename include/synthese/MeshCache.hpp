@@ -0,0 +1,140 @@
+/***************************************************************************************************
+ * @file  MeshCache.hpp
+ * @brief Declaration of the MeshCache class
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include "BVH.hpp"
+#include "vec.h"
+
+/**
+ * @class MeshCache
+ * @brief A binary cache of a mesh file, stored next to it: the mesh's indexed positions, its normals and its built BVH.
+ * A cache is only valid for the modification time of its mesh file, the build method of its BVH and the version of the
+ * format, and is ignored if any of them changed. Valid caches are memory-mapped and their arrays are read in place, so
+ * loading a mesh neither parses its file nor builds its BVH. The arrays are stored in the machine's native layout.
+ */
+class MeshCache {
+public:
+    static constexpr uint32_t version = 1; ///< The version of the format, to increase whenever the layout changes.
+
+    /**
+     * @brief Default constructor. No cache is mapped.
+     */
+    MeshCache();
+
+    /**
+     * @brief Destructor. Unmaps the cache.
+     */
+    ~MeshCache();
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    /**
+     * @brief Gets the path of the cache of a mesh file.
+     * @param meshPath The path to the mesh.
+     * @param smooth Whether the mesh uses smooth lighting, flat and smooth meshes having separate caches.
+     * @return The path of the cache.
+     */
+    static std::string getPath(const std::string& meshPath, bool smooth);
+
+    /**
+     * @brief Maps the cache of a mesh file, if it exists and is up to date.
+     * @param meshPath The path to the mesh.
+     * @param smooth Whether the mesh uses smooth lighting.
+     * @param method The build method the cached BVH must have been built with.
+     * @return Whether the cache is valid. If not, nothing is mapped.
+     */
+    bool open(const std::string& meshPath, bool smooth, BVH::BuildMethod method);
+
+    /**
+     * @brief Unmaps the cache. The arrays it returned become invalid.
+     */
+    void close();
+
+    /**
+     * @return The mesh's positions, in place in the mapped cache.
+     */
+    std::span<const Point> getPositions() const;
+
+    /**
+     * @return The mesh's position indices, 3 per triangle, in place in the mapped cache.
+     */
+    std::span<const uint> getIndices() const;
+
+    /**
+     * @return The mesh's normals, one per position, or none if the mesh uses flat lighting.
+     */
+    std::span<const Vector> getNormals() const;
+
+    /**
+     * @return The binary nodes of the mesh's BVH, in place in the mapped cache.
+     */
+    std::span<const BVH::Node> getNodes() const;
+
+    /**
+     * @return The primitive indices of the mesh's BVH, in place in the mapped cache.
+     */
+    std::span<const uint> getPrimitiveIndices() const;
+
+    /**
+     * @brief Writes the cache of a mesh file. The cache is written to a temporary file that then replaces the previous
+     * cache, so that a cache is never read while incomplete.
+     * @param meshPath The path to the mesh, whose modification time is stored in the cache.
+     * @param smooth Whether the mesh uses smooth lighting.
+     * @param positions The mesh's positions.
+     * @param indices The mesh's position indices, 3 per triangle.
+     * @param normals The mesh's normals, one per position, or none if the mesh uses flat lighting.
+     * @param bvh The mesh's built BVH.
+     * @return Whether the cache was written.
+     */
+    static bool write(const std::string& meshPath, bool smooth, std::span<const Point> positions,
+                      std::span<const uint> indices, std::span<const Vector> normals, const BVH& bvh);
+
+private:
+    /**
+     * @struct MeshCache::Header
+     * @brief The beginning of a cache file, followed by the arrays in the order of their counts.
+     */
+    struct Header {
+        char magic[8];                ///< Identifies a mesh cache.
+        uint32_t version;             ///< The version of the format.
+        uint32_t nodeSize;            ///< The size of a BVH node, in case it changed without a new version.
+        uint64_t timestamp;           ///< The modification time of the mesh file.
+        uint32_t smooth;              ///< Whether the mesh uses smooth lighting.
+        uint32_t buildMethod;         ///< The build method of the BVH.
+        uint32_t positionCount;       ///< The amount of positions.
+        uint32_t indexCount;          ///< The amount of position indices.
+        uint32_t normalCount;         ///< The amount of normals.
+        uint32_t nodeCount;           ///< The amount of BVH nodes.
+        uint32_t primitiveIndexCount; ///< The amount of BVH primitive indices.
+        uint32_t padding;             ///< Keeps the arrays aligned.
+    };
+
+    static constexpr char magic[8] = "SYNMESH"; ///< The magic number of the cache files.
+
+    /**
+     * @brief Gets the next array of the mapped cache.
+     * @tparam T The type of the array's elements.
+     * @param offset The offset of the array from the beginning of the file, in bytes. Moved to the end of the array.
+     * @param count The amount of elements.
+     * @return The array.
+     */
+    template<typename T>
+    std::span<const T> getArray(size_t& offset, uint32_t count) const;
+
+    const char* data; ///< The mapped file, nullptr if nothing is mapped.
+    size_t size;      ///< The size of the mapped file, in bytes.
+
+    std::span<const Point> positions;       ///< The mesh's positions.
+    std::span<const uint> indices;          ///< The mesh's position indices.
+    std::span<const Vector> normals;        ///< The mesh's normals.
+    std::span<const BVH::Node> nodes;       ///< The binary nodes of the mesh's BVH.
+    std::span<const uint> primitiveIndices; ///< The primitive indices of the mesh's BVH.
+};
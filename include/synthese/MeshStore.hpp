@@ -0,0 +1,242 @@
+/***************************************************************************************************
+ * @file  MeshStore.hpp
+ * @brief Declaration of the MeshStore class
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+#include "BVH.hpp"
+#include "Hit.hpp"
+#include "MaterialTable.hpp"
+#include "Primitives.hpp"
+#include "Ray.hpp"
+#include "vec.h"
+
+class MeshStore; // Forward-Declared to avoid circular dependency.
+
+/**
+ * @struct Mesh
+ * @brief A range of triangles in a MeshStore, in object space. The mesh is a set of primitives on its own, indexed from
+ * 0 to its amount of triangles, with its own BVH so that it can be placed several times in a scene without copying
+ * its triangles or rebuilding its BVH.
+ */
+struct Mesh : Primitives {
+    /**
+     * @brief Constructor. The BVH isn't built yet, call mesh.bvh.initialize() once the store holds the triangles.
+     * @param store The store holding the triangles.
+     * @param firstTriangle The index of the mesh's first triangle in the store.
+     * @param triangleCount The amount of triangles in the mesh.
+     * @param firstVertex The index of the mesh's first vertex in the store.
+     * @param firstNormal The index of the normal of the mesh's first vertex, -1u if the mesh isn't smooth.
+     */
+    Mesh(const MeshStore& store, uint firstTriangle, uint triangleCount, uint firstVertex, uint firstNormal);
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    /**
+     * @return The amount of triangles in the mesh.
+     */
+    uint getPrimitiveCount() const override;
+
+    /**
+     * @brief Calculates the centroid (barycenter) of a triangle of the mesh.
+     * @param primitive The index of the triangle in the mesh.
+     * @return The average of all three of the triangle's points.
+     */
+    Point getCentroid(uint primitive) const override;
+
+    /**
+     * @brief Compares a triangle of the mesh to a bounding box. Replaces the values of pmin and pmax's components if
+     * they are respectively lower or higher.
+     * @param primitive The index of the triangle in the mesh.
+     * @param pmin The bounding box's current lower bound.
+     * @param pmax The bounding box's current higher bound.
+     */
+    void compareBoundingBox(uint primitive, Point& pmin, Point& pmax) const override;
+
+    /**
+     * @brief Calculates the intersection between a ray and some triangles of the mesh and keeps the closest one. Only
+     * the distance, the barycentric coordinates and the index of the triangle in the store are set.
+     * @param primitives The indices of the triangles in the mesh.
+     * @param count The amount of triangles.
+     * @param ray The ray to calculate the intersection with.
+     * @param closest The closest hit found so far. Replaced by any closer hit.
+     */
+    void intersect(const uint* primitives, uint count, const Ray& ray, Hit& closest) const override;
+
+    /**
+     * @brief Calculates the intersections between some rays of a packet and some triangles of the mesh and keeps the
+     * closest one for each ray.
+     * @param primitives The indices of the triangles in the mesh.
+     * @param count The amount of triangles.
+     * @param rays The rays of the packet.
+     * @param mask The rays to calculate the intersections with, one bit per ray.
+     * @param closest The closest hit found so far by each ray. Replaced by any closer hit.
+     */
+    void intersect(const uint* primitives, uint count, const Ray* rays, uint64_t mask, Hit* closest) const override;
+
+    /**
+     * @brief Checks if any of some triangles of the mesh intersects a ray before a certain distance.
+     * @param primitives The indices of the triangles in the mesh.
+     * @param count The amount of triangles.
+     * @param ray The ray to check the intersection with.
+     * @param tMax The distance after which intersections are ignored.
+     * @return Whether a triangle intersects the ray between its origin and tMax.
+     */
+    bool occluded(const uint* primitives, uint count, const Ray& ray, float tMax) const override;
+
+    const MeshStore& store; ///< The store holding the triangles.
+    uint firstTriangle;     ///< The index of the mesh's first triangle in the store.
+    uint triangleCount;     ///< The amount of triangles in the mesh.
+    uint firstVertex;       ///< The index of the mesh's first vertex in the store.
+    uint firstNormal;       ///< The index of the normal of the mesh's first vertex, -1u if the mesh isn't smooth.
+    BVH bvh;                ///< The BVH built over the mesh's triangles.
+};
+
+/**
+ * @class MeshStore
+ * @brief Stores the triangles of all the meshes of a scene in contiguous arrays. Vertex positions and normals are
+ * stored as structures of arrays, and triangles are triplets of indices into them instead of heap allocated Objects.
+ * The first point and the two edges of each triangle are also precomputed, in the same layout, so that the
+ * intersection doesn't gather its vertices through the indices. This trades memory for speed: a triangle costs 50
+ * bytes plus its share of the vertices, 12 for its indices, 2 for its material and 36 for its point and edges. Meshes
+ * are stored in object space, their placement in the scene is left to the instances referring to them.
+ */
+class MeshStore {
+public:
+    /**
+     * @brief Default constructor.
+     */
+    MeshStore() = default;
+
+    MeshStore(const MeshStore&) = delete;
+    MeshStore& operator=(const MeshStore&) = delete;
+
+    /**
+     * @brief Adds a mesh to the store. The arrays are copied, so they can be temporary, e.g. mapped from a MeshCache.
+     * The triangles use MaterialTable::defaultMaterial until MeshStore::setMaterials is called.
+     * @param positions The mesh's positions.
+     * @param indices The mesh's position indices, 3 per triangle.
+     * @param normals The mesh's normals, one per position. If empty, the mesh will use flat lighting.
+     * @return The index of the mesh.
+     */
+    uint add(std::span<const Point> positions, std::span<const uint> indices, std::span<const Vector> normals);
+
+    /**
+     * @brief Sets the material of each triangle of a mesh, used by the instances placed with
+     * MaterialTable::meshMaterials.
+     * @param mesh The index of the mesh.
+     * @param materials The material of each triangle of the mesh.
+     */
+    void setMaterials(uint mesh, std::span<const MaterialID> materials);
+
+    /**
+     * @param triangle The index of the triangle.
+     * @return The triangle's material.
+     */
+    MaterialID getMaterial(uint triangle) const;
+
+    /**
+     * @brief Removes all the meshes.
+     */
+    void clear();
+
+    /**
+     * @return The amount of meshes in the store.
+     */
+    uint getMeshCount() const;
+
+    /**
+     * @return The amount of triangles in the store.
+     */
+    uint getTriangleCount() const;
+
+    /**
+     * @param mesh The index of the mesh.
+     * @return The mesh.
+     */
+    Mesh& getMesh(uint mesh);
+
+    /**
+     * @param mesh The index of the mesh.
+     * @return The mesh.
+     */
+    const Mesh& getMesh(uint mesh) const;
+
+    /**
+     * @brief Finds the mesh a triangle belongs to.
+     * @param triangle The index of the triangle.
+     * @return The mesh containing the triangle.
+     */
+    const Mesh& findMesh(uint triangle) const;
+
+    /**
+     * @brief Calculates the centroid (barycenter) of a triangle.
+     * @param triangle The index of the triangle.
+     * @return The average of all three of the triangle's points.
+     */
+    Point getCentroid(uint triangle) const;
+
+    /**
+     * @brief Compares a triangle to a bounding box. Replaces the values of pmin and pmax's components if they are
+     * respectively lower or higher.
+     * @param triangle The index of the triangle.
+     * @param pmin The bounding box's current lower bound.
+     * @param pmax The bounding box's current higher bound.
+     */
+    void compareBoundingBox(uint triangle, Point& pmin, Point& pmax) const;
+
+    /**
+     * @brief Calculates the intersection between a ray and a triangle. Only the distance and the barycentric
+     * coordinates are computed, the normal is left to getNormal once the closest hit is known.
+     * @param triangle The index of the triangle.
+     * @param ray The ray to calculate the intersection with.
+     * @param t Set to the distance of the intersection along the ray.
+     * @param u Set to the barycentric coordinate of the intersection relative to the triangle's second vertex.
+     * @param v Set to the barycentric coordinate of the intersection relative to the triangle's third vertex.
+     * @return Whether the triangle is hit. If not, t, u and v are left unspecified.
+     */
+    bool intersect(uint triangle, const Ray& ray, float& t, float& u, float& v) const;
+
+    /**
+     * @brief Calculates the normal of a triangle at a point given by its barycentric coordinates. Smooth meshes
+     * interpolate their vertex normals, the other ones use the triangle's normal.
+     * @param triangle The index of the triangle.
+     * @param u The barycentric coordinate of the point relative to the triangle's second vertex.
+     * @param v The barycentric coordinate of the point relative to the triangle's third vertex.
+     * @return The normalized normal, in object space.
+     */
+    Vector getNormal(uint triangle, float u, float v) const;
+
+private:
+    /**
+     * @brief Gets the position of a vertex.
+     * @param vertex The index of the vertex.
+     * @return The vertex's position.
+     */
+    Point getPosition(uint vertex) const;
+
+    std::vector<float> positionsX;             ///< The x coordinate of each vertex.
+    std::vector<float> positionsY;             ///< The y coordinate of each vertex.
+    std::vector<float> positionsZ;             ///< The z coordinate of each vertex.
+    std::vector<float> normalsX;               ///< The x coordinate of each normal of the smooth meshes.
+    std::vector<float> normalsY;               ///< The y coordinate of each normal of the smooth meshes.
+    std::vector<float> normalsZ;               ///< The z coordinate of each normal of the smooth meshes.
+    std::vector<uint> indices;                 ///< The indices of the vertices of each triangle, 3 per triangle.
+    std::vector<MaterialID> materials;         ///< The material of each triangle.
+    std::vector<float> originsX;               ///< The x coordinate of the first point of each triangle.
+    std::vector<float> originsY;               ///< The y coordinate of the first point of each triangle.
+    std::vector<float> originsZ;               ///< The z coordinate of the first point of each triangle.
+    std::vector<float> edges1X;                ///< The x coordinate of the first edge (B - A) of each triangle.
+    std::vector<float> edges1Y;                ///< The y coordinate of the first edge (B - A) of each triangle.
+    std::vector<float> edges1Z;                ///< The z coordinate of the first edge (B - A) of each triangle.
+    std::vector<float> edges2X;                ///< The x coordinate of the second edge (C - A) of each triangle.
+    std::vector<float> edges2Y;                ///< The y coordinate of the second edge (C - A) of each triangle.
+    std::vector<float> edges2Z;                ///< The z coordinate of the second edge (C - A) of each triangle.
+    std::vector<std::unique_ptr<Mesh>> meshes; ///< The meshes, sorted by their first triangle.
+};
@@ -5,15 +5,12 @@
 
 #pragma once
 
-#include <functional>
-#include "color.h"
 #include "Hit.hpp"
+#include "MaterialTable.hpp"
 #include "Ray.hpp"
 #include "vec.h"
 #include "Vertex.hpp"
 
-using ColorFunc = std::function<Color(const Point&)>;
-
 /**
  * @enum ObjectType
  * @brief Enumeration of all Object types.
@@ -32,16 +29,10 @@ enum class ObjectType : unsigned char {
  */
 struct Object {
     /**
-     * @brief Constructor. Creates an object with its color function always returning the same color.
-     * @param color The object's color.
+     * @brief Constructor.
+     * @param material The ID of the object's material in the table of the scene it is added to.
      */
-    explicit Object(const Color& color);
-
-    /**
-     * @brief Constructor. Creates an object with a specific color function.
-     * @param getColor The object's color function.
-     */
-    explicit Object(const ColorFunc& getColor);
+    explicit Object(MaterialID material);
 
     /**
      * @brief Destructor.
@@ -54,11 +45,25 @@ struct Object {
     virtual ObjectType getType() const = 0;
 
     /**
-     * @brief Calculates the intersection between a ray and the object.
+     * @brief Calculates the intersection between a ray and the object, without the attributes of the hit point: they
+     * are only computed for the closest hit, with getNormal.
      * @param ray The ray to calculate the intersection with.
-     * @return The information on the hit object. If no object is hit, the intersection will be set to infinity.
+     * @param t Set to the distance of the intersection along the ray.
+     * @param u Set to the barycentric coordinate of the intersection relative to the second vertex, for triangles.
+     * @param v Set to the barycentric coordinate of the intersection relative to the third vertex, for triangles.
+     * @return Whether the ray hits the object in its interval. If not, t, u and v are left unspecified. The objects
+     * that aren't triangles leave u and v untouched.
      */
-    virtual Hit intersect(const Ray& ray) const = 0;
+    virtual bool intersect(const Ray& ray, float& t, float& u, float& v) const = 0;
+
+    /**
+     * @brief Calculates the object's normal at a hit point.
+     * @param point The hit point.
+     * @param u The barycentric coordinate of the hit relative to the second vertex, for triangles.
+     * @param v The barycentric coordinate of the hit relative to the third vertex, for triangles.
+     * @return The normal, normalized.
+     */
+    virtual Vector getNormal(const Point& point, float u, float v) const = 0;
 
     /**
      * @brief Calculates the centroid (barycenter) of the object.
@@ -74,7 +79,7 @@ struct Object {
      */
     virtual void compareBoundingBox(Point& pmin, Point& pmax) const = 0;
 
-    ColorFunc getColor; ///< The object's color function.
+    MaterialID material; ///< The ID of the object's material.
 };
 
 /**
@@ -83,20 +88,12 @@ struct Object {
  */
 struct Plane : Object {
     /**
-     * @brief Constructor. Creates a plane with a plain color.
-     * @param color The plane's color.
-     * @param point A point on the plane.
-     * @param normal The plane's normal
-     */
-    Plane(const Color& color, const Point& point, const Vector& normal);
-
-    /**
-     * @brief Constructor. Creates a plane with a specific color function.
-     * @param getColor The plane's color function.
+     * @brief Constructor.
+     * @param material The plane's material.
      * @param point A point on the plane.
      * @param normal The plane's normal.
      */
-    Plane(const ColorFunc& getColor, const Point& point, const Vector& normal);
+    Plane(MaterialID material, const Point& point, const Vector& normal);
 
     /**
      * @return The object's type.
@@ -106,9 +103,21 @@ struct Plane : Object {
     /**
      * @brief Calculates the intersection between a ray and the plane.
      * @param ray The ray to calculate the intersection with.
-     * @return The information on the hit object. If no object is hit, the intersection will be set to infinity.
+     * @param t Set to the distance of the intersection along the ray.
+     * @param u Unused.
+     * @param v Unused.
+     * @return Whether the ray hits the plane in its interval.
+     */
+    bool intersect(const Ray& ray, float& t, float& u, float& v) const override;
+
+    /**
+     * @brief Calculates the plane's normal at a hit point.
+     * @param point The hit point.
+     * @param u Unused.
+     * @param v Unused.
+     * @return The plane's normal.
      */
-    Hit intersect(const Ray& ray) const override;
+    Vector getNormal(const Point& point, float u, float v) const override;
 
     /**
      * @brief This function doesn't really make sense for a plane but needs to be implemented since it's a pure virtual
@@ -135,20 +144,12 @@ struct Plane : Object {
  */
 struct Sphere : Object {
     /**
-     * @brief Constructor. Creates a sphere with a plain color.
-     * @param color The sphere's color.
-     * @param center The sphere's center.
-     * @param radius The sphere's radius.
-     */
-    Sphere(const Color& color, const Point& center, float radius);
-
-    /**
-     * @brief Constructor. Creates a sphere with a specific color function.
-     * @param getColor The sphere's color function.
+     * @brief Constructor.
+     * @param material The sphere's material.
      * @param center The sphere's center.
      * @param radius The sphere's radius.
      */
-    Sphere(const ColorFunc& getColor, const Point& center, float radius);
+    Sphere(MaterialID material, const Point& center, float radius);
 
     /**
      * @return The object's type.
@@ -158,9 +159,21 @@ struct Sphere : Object {
     /**
      * @brief Calculates the intersection between a ray and the sphere.
      * @param ray The ray to calculate the intersection with.
-     * @return The information on the hit object. If no object is hit, the intersection will be set to infinity.
+     * @param t Set to the distance of the intersection along the ray.
+     * @param u Unused.
+     * @param v Unused.
+     * @return Whether the ray hits the sphere in its interval.
+     */
+    bool intersect(const Ray& ray, float& t, float& u, float& v) const override;
+
+    /**
+     * @brief Calculates the sphere's normal at a hit point.
+     * @param point The hit point.
+     * @param u Unused.
+     * @param v Unused.
+     * @return The direction from the sphere's center to the point.
      */
-    Hit intersect(const Ray& ray) const override;
+    Vector getNormal(const Point& point, float u, float v) const override;
 
     /**
      * @brief Calculates the centroid (barycenter) of the sphere.
@@ -186,22 +199,13 @@ struct Sphere : Object {
  */
 struct Triangle : Object {
     /**
-     * @brief Constructor. Creates a triangle with a plain color.
-     * @param color The triangle's color.
+     * @brief Constructor.
+     * @param material The triangle's material.
      * @param A The triangle's first point.
      * @param B The triangle's second point.
      * @param C The triangle's third point.
      */
-    Triangle(const Color& color, const Point& A, const Point& B, const Point& C);
-
-    /**
-     * @brief Constructor. Creates a triangle with a specific color function.
-     * @param getColor The triangle's color function.
-     * @param A The triangle's first point.
-     * @param B The triangle's second point.
-     * @param C The triangle's third point.
-     */
-    Triangle(const ColorFunc& getColor, const Point& A, const Point& B, const Point& C);
+    Triangle(MaterialID material, const Point& A, const Point& B, const Point& C);
 
     /**
      * @return The object's type.
@@ -211,9 +215,21 @@ struct Triangle : Object {
     /**
      * @brief Calculates the intersection between a ray and the triangle.
      * @param ray The ray to calculate the intersection with.
-     * @return The information on the hit object. If no object is hit, the intersection will be set to infinity.
+     * @param t Set to the distance of the intersection along the ray.
+     * @param u Set to the barycentric coordinate of the intersection relative to the second vertex.
+     * @param v Set to the barycentric coordinate of the intersection relative to the third vertex.
+     * @return Whether the ray hits the triangle in its interval.
+     */
+    bool intersect(const Ray& ray, float& t, float& u, float& v) const override;
+
+    /**
+     * @brief Calculates the triangle's normal at a hit point.
+     * @param point The hit point.
+     * @param u The barycentric coordinate of the hit relative to the second vertex.
+     * @param v The barycentric coordinate of the hit relative to the third vertex.
+     * @return The triangle's normal.
      */
-    Hit intersect(const Ray& ray) const override;
+    Vector getNormal(const Point& point, float u, float v) const override;
 
     /**
      * @brief Calculates the centroid (barycenter) of the triangle.
@@ -229,9 +245,12 @@ struct Triangle : Object {
      */
     void compareBoundingBox(Point& pmin, Point& pmax) const override;
 
-    Point A; ///< The triangle's first point.
-    Point B; ///< The triangle's second point.
-    Point C; ///< The triangle's third point.
+    Point A;       ///< The triangle's first point.
+    Point B;       ///< The triangle's second point.
+    Point C;       ///< The triangle's third point.
+    Vector edge1;  ///< B - A, precomputed for the intersection.
+    Vector edge2;  ///< C - A, precomputed for the intersection.
+    Vector normal; ///< The triangle's normal, precomputed for the intersection.
 };
 
 /**
@@ -240,14 +259,13 @@ struct Triangle : Object {
  */
 struct MeshTriangle : Object {
     /**
-     * @brief Constructor. Creates a mesh triangle with a plain color.
-     * @param color The triangle's color.
+     * @brief Constructor.
+     * @param material The triangle's material.
      * @param A The triangle's first vertex.
      * @param B The triangle's second vertex.
      * @param C The triangle's third vertex.
      */
-    MeshTriangle(const Color& color, const Vertex& A, const Vertex& B, const Vertex& C);
-    MeshTriangle(const ColorFunc& getColor, const Vertex& A, const Vertex& B, const Vertex& C);
+    MeshTriangle(MaterialID material, const Vertex& A, const Vertex& B, const Vertex& C);
 
     /**
      * @return The object's type.
@@ -257,9 +275,21 @@ struct MeshTriangle : Object {
     /**
      * @brief Calculates the intersection between a ray and the triangle.
      * @param ray The ray to calculate the intersection with.
-     * @return The information on the hit object. If no object is hit, the intersection will be set to infinity.
+     * @param t Set to the distance of the intersection along the ray.
+     * @param u Set to the barycentric coordinate of the intersection relative to the second vertex.
+     * @param v Set to the barycentric coordinate of the intersection relative to the third vertex.
+     * @return Whether the ray hits the triangle in its interval.
+     */
+    bool intersect(const Ray& ray, float& t, float& u, float& v) const override;
+
+    /**
+     * @brief Calculates the triangle's normal at a hit point.
+     * @param point The hit point.
+     * @param u The barycentric coordinate of the hit relative to the second vertex.
+     * @param v The barycentric coordinate of the hit relative to the third vertex.
+     * @return The interpolation of the normals of the vertices.
      */
-    Hit intersect(const Ray& ray) const override;
+    Vector getNormal(const Point& point, float u, float v) const override;
 
     /**
      * @brief Calculates the centroid (barycenter) of the triangle.
@@ -275,7 +305,9 @@ struct MeshTriangle : Object {
      */
     void compareBoundingBox(Point& pmin, Point& pmax) const override;
 
-    Vertex A; ///< The triangle's first vertex.
-    Vertex B; ///< The triangle's second vertex.
-    Vertex C; ///< The triangle's third vertex.
+    Vertex A;     ///< The triangle's first vertex.
+    Vertex B;     ///< The triangle's second vertex.
+    Vertex C;     ///< The triangle's third vertex.
+    Vector edge1; ///< B.position - A.position, precomputed for the intersection.
+    Vector edge2; ///< C.position - A.position, precomputed for the intersection.
 };
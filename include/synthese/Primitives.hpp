@@ -0,0 +1,75 @@
+/***************************************************************************************************
+ * @file  Primitives.hpp
+ * @brief Declaration of the Primitives struct
+ **************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include "Hit.hpp"
+#include "Ray.hpp"
+#include "vec.h"
+
+/**
+ * @struct Primitives
+ * @brief A set of primitives a BVH can be built over. Each primitive is identified by its index in the set. The
+ * intersection methods are called once per leaf, with the indices of all the primitives of the leaf, so that the set
+ * can iterate over its own storage without an indirect call per primitive.
+ */
+struct Primitives {
+    /**
+     * @brief Destructor.
+     */
+    virtual ~Primitives() = default;
+
+    /**
+     * @return The amount of primitives in the set.
+     */
+    virtual uint getPrimitiveCount() const = 0;
+
+    /**
+     * @brief Calculates the centroid (barycenter) of a primitive.
+     * @param primitive The index of the primitive.
+     * @return The centroid of the primitive.
+     */
+    virtual Point getCentroid(uint primitive) const = 0;
+
+    /**
+     * @brief Compares a primitive to a bounding box. Replaces the values of pmin and pmax's components if they are
+     * respectively lower or higher.
+     * @param primitive The index of the primitive.
+     * @param pmin The bounding box's current lower bound.
+     * @param pmax The bounding box's current higher bound.
+     */
+    virtual void compareBoundingBox(uint primitive, Point& pmin, Point& pmax) const = 0;
+
+    /**
+     * @brief Calculates the intersection between a ray and some primitives and keeps the closest one.
+     * @param primitives The indices of the primitives.
+     * @param count The amount of primitives.
+     * @param ray The ray to calculate the intersection with.
+     * @param closest The closest hit found so far. Replaced by any closer hit.
+     */
+    virtual void intersect(const uint* primitives, uint count, const Ray& ray, Hit& closest) const = 0;
+
+    /**
+     * @brief Calculates the intersections between some rays of a packet and some primitives and keeps the closest
+     * one for each ray.
+     * @param primitives The indices of the primitives.
+     * @param count The amount of primitives.
+     * @param rays The rays of the packet.
+     * @param mask The rays to calculate the intersections with, one bit per ray.
+     * @param closest The closest hit found so far by each ray. Replaced by any closer hit.
+     */
+    virtual void intersect(const uint* primitives, uint count, const Ray* rays, uint64_t mask, Hit* closest) const = 0;
+
+    /**
+     * @brief Checks if any of some primitives intersects a ray before a certain distance.
+     * @param primitives The indices of the primitives.
+     * @param count The amount of primitives.
+     * @param ray The ray to check the intersection with.
+     * @param tMax The distance after which intersections are ignored.
+     * @return Whether a primitive intersects the ray between its origin and tMax.
+     */
+    virtual bool occluded(const uint* primitives, uint count, const Ray& ray, float tMax) const = 0;
+};
@@ -10,15 +10,31 @@
 
 /**
  * @struct Ray
- * @brief Represents a ray starting from a certain point pointing towards a certain direction.
+ * @brief Represents a ray starting from a certain point pointing towards a certain direction. Only the intersections in
+ * the ray's interval [tMin, tMax] are considered. The inverse of the direction and its signs are computed once, so that
+ * the bounding box tests of the traversals only multiply.
  */
 struct Ray {
     /**
-     * @brief Constructor. Creates a ray with its origin and direction.
+     * @brief Default constructor. Creates a ray starting from the origin with a null direction.
+     */
+    Ray();
+
+    /**
+     * @brief Constructor. Creates a ray with its origin, direction and interval.
      * @param origin The ray's origin.
      * @param direction The ray's direction.
+     * @param tMin The distance before which intersections are ignored.
+     * @param tMax The distance after which intersections are ignored.
+     */
+    Ray(const Point& origin, const Vector& direction, float tMin = 0.0f, float tMax = infinity);
+
+    /**
+     * @brief Checks whether a distance is in the ray's interval.
+     * @param t The distance.
+     * @return Whether tMin <= t <= tMax.
      */
-    Ray(const Point& origin, const Vector& direction);
+    bool contains(float t) const { return t >= tMin && t <= tMax; }
 
     /**
      * @brief Calculates a point on the half-line starting from the ray's origin and going in the ray's direction at a
@@ -37,6 +53,10 @@ struct Ray {
      */
     Point getEpsilonPoint(const Hit& hit, float epsilon = 10e-3) const;
 
-    Point origin;     ///< The ray's origin.
-    Vector direction; ///< The ray's direction.
+    Point origin;            ///< The ray's origin.
+    Vector direction;        ///< The ray's direction.
+    Vector inverseDirection; ///< The inverse of each component of the direction, finite even for null components.
+    uint sign[3];            ///< For each axis, 1 if the direction is negative along it, 0 otherwise.
+    float tMin;              ///< The distance before which intersections are ignored.
+    float tMax;              ///< The distance after which intersections are ignored.
 };
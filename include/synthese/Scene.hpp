@@ -5,17 +5,29 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "BVH.hpp"
+#include "Geometry.hpp"
 #include "Hit.hpp"
+#include "ImageWriter.hpp"
 #include "image.h"
 #include "Light.hpp"
+#include "LightGrid.hpp"
 #include "mat4.hpp"
 #include "mesh_io.h"
 #include "Object.hpp"
 #include "Ray.hpp"
+#include "Statistics.hpp"
+#include "ThreadPool.hpp"
 #include "vec.h"
 
 /**
@@ -24,11 +36,58 @@
  */
 class Scene {
 public:
+    /**
+     * @enum Scene::Antialiasing
+     * @brief Enumeration of the ways the pixels are sampled.
+     */
+    enum class Antialiasing : unsigned char {
+        Fixed,   ///< Every pixel gets the same amount of samples.
+        Adaptive ///< Every pixel gets a sample at its center, only the ones differing from their neighbours get more.
+    };
+
+    /**
+     * @enum Scene::LightSampling
+     * @brief Enumeration of the ways the lights of a point are gathered.
+     */
+    enum class LightSampling : unsigned char {
+        All,       ///< Every light that can light up the point is computed, with its shadow ray.
+        Stochastic ///< A few lights are picked at random, the picks of the samples of a pixel averaging to all of them.
+    };
+
+    /**
+     * @enum Scene::Pipeline
+     * @brief Enumeration of the ways the samples go through the stages of the render, which give the same image.
+     */
+    enum class Pipeline : unsigned char {
+        PerSample, ///< Each packet of camera rays is traced, shaded and has its shadow rays traced before the next one.
+        Wavefront  ///< The samples of a tile are queued and go through each stage together, one stage after the other.
+    };
+
+    static constexpr unsigned int lightCandidateCount = 8; ///< The amount of lights each stochastic pick chooses among.
+    static constexpr unsigned int wavefrontSize = 4096;    ///< The amount of samples the wavefront pipeline queues.
+
+    /**
+     * @brief Gives the transform of an animated instance at a time, in seconds.
+     */
+    using Animation = std::function<mat4(float)>;
+
+    /**
+     * @struct Scene::RenderStatistics
+     * @brief Measurements of a render.
+     */
+    struct RenderStatistics {
+        float buildDuration;          ///< The time spent building the BVHs, in seconds.
+        float renderDuration;         ///< The time spent computing the image, in seconds.
+        unsigned long cameraRayCount; ///< The amount of camera rays traced.
+        Statistics counters;          ///< The counters of the render threads, zero unless SYNTHESE_STATISTICS is set.
+    };
+
     /**
      * @brief Constructor. Initializes the scene.
      * @param name The scene's name.
+     * @param threadCount The amount of threads building the BVHs and rendering the images.
      */
-    explicit Scene(const std::string& name);
+    explicit Scene(const std::string& name, unsigned int threadCount = std::thread::hardware_concurrency());
 
     /**
      * @brief Destructor. Frees all the lights and objects.
@@ -36,12 +95,41 @@ public:
     ~Scene();
 
     /**
-     * @brief Renders the scene to an image. The image will be stored in "data/synthese/<scene_name>.png".
+     * @brief Renders the scene to an image. The image will be stored in "data/synthese/<scene_name>.png", or with the
+     * extension of the format set by setImageFormat. The tiles are rendered one band of rows at a time, from the top of
+     * the image, and each band is compressed and written as soon as it is complete, so only a few bands are held in
+     * memory.
      * @param width The image's width.
      * @param height The image's height.
      */
     void render(unsigned int width, unsigned int height);
 
+    /**
+     * @brief Renders the scene to an image without saving it.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @return The image.
+     */
+    Image renderImage(unsigned int width, unsigned int height);
+
+    /**
+     * @brief Renders the frames of the scene's animation, the images being stored in
+     * "data/synthese/<scene_name>_<frame>.png" with frames numbered from 0000, or with the extension of the format set
+     * by setImageFormat. Each frame moves the animated instances with Scene::setTime and is rendered like with
+     * Scene::render, the BVHs being refitted instead of built again. The threads and their buffers are kept from one
+     * frame to the next.
+     * @param width The images' width.
+     * @param height The images' height.
+     * @param frameCount The amount of frames.
+     * @param frameRate The amount of frames per second, the first frame being at time 0.
+     */
+    void renderAnimation(unsigned int width, unsigned int height, unsigned int frameCount, float frameRate = 24.0f);
+
+    /**
+     * @return The measurements of the last render.
+     */
+    const RenderStatistics& getRenderStatistics() const;
+
     /**
      * @brief Add a light to the scene.
      * @param light The light.
@@ -50,16 +138,140 @@ public:
 
     /**
      * @brief Add an object to the scene.
-     * @param object The object.
+     * @param object The object. Its material must have been added to the scene.
      */
     void add(const Object* object);
 
     /**
      * @brief Add a plane to the scene.
-     * @param plane The plane.
+     * @param plane The plane. Its material must have been added to the scene.
      */
     void add(const Plane* plane);
 
+    /**
+     * @brief Adds a constant material to the scene. Colors already added reuse their material.
+     * @param color The material's color.
+     * @return The ID of the material, to give to the objects and the instances.
+     */
+    MaterialID addMaterial(const Color& color);
+
+    /**
+     * @brief Adds a procedural material to the scene.
+     * @param getColor The material's color function.
+     * @return The ID of the material, to give to the objects and the instances.
+     */
+    MaterialID addMaterial(const ColorFunc& getColor);
+
+    /**
+     * @brief Adds a checker material to the scene, alternating over the unit squares of the XZ plane.
+     * @param even The color of the squares where floor(x) + floor(z) is even.
+     * @param odd The color of the other squares.
+     * @return The ID of the material, to give to the objects and the instances.
+     */
+    MaterialID addCheckerMaterial(const Color& even, const Color& odd);
+
+    /**
+     * @brief Adds a gradient material to the scene, interpolated along a segment.
+     * @param start The start of the segment.
+     * @param end The end of the segment.
+     * @param startColor The color at the start of the segment.
+     * @param endColor The color at the end of the segment.
+     * @return The ID of the material, to give to the objects and the instances.
+     */
+    MaterialID addGradientMaterial(const Point& start, const Point& end, const Color& startColor,
+                                   const Color& endColor);
+
+    /**
+     * @brief Loads the materials of a mesh file and assigns them to the triangles of a mesh, for the instances placed
+     * with MaterialTable::meshMaterials. Only the diffuse colors are used.
+     * @param mesh The index of the mesh, returned by Scene::addMesh.
+     * @param meshPath The path to the mesh the materials belong to.
+     */
+    void loadMaterials(uint mesh, const std::string& meshPath);
+
+    /**
+     * @brief Loads a mesh without placing it in the scene. A file is only loaded once, later calls with the same path
+     * and smoothness return the same mesh. If mesh caching is enabled, the mesh and its BVH are read from its
+     * MeshCache when it is up to date, otherwise the file is parsed, the BVH is built right away and the cache is
+     * written for the next runs.
+     * @param meshPath The path to the mesh.
+     * @param smooth Whether to use smooth lighting.
+     * @return The index of the mesh, to place it with Scene::addInstance.
+     */
+    uint addMesh(const std::string& meshPath, bool smooth = false);
+
+    /**
+     * @brief Adds a mesh without placing it in the scene.
+     * @param data The mesh's data.
+     * @param smooth Whether to use smooth lighting.
+     * @return The index of the mesh, to place it with Scene::addInstance.
+     */
+    uint addMesh(const MeshIOData& data, bool smooth = false);
+
+    /**
+     * @brief Adds a mesh without placing it in the scene.
+     * @param positions The mesh's positions, 3 per triangle.
+     * @return The index of the mesh, to place it with Scene::addInstance.
+     */
+    uint addMesh(const std::vector<Point>& positions);
+
+    /**
+     * @brief Adds a mesh without placing it in the scene.
+     * @param positions The mesh's positions.
+     * @param indices The mesh's position indices.
+     * @return The index of the mesh, to place it with Scene::addInstance.
+     */
+    uint addMesh(const std::vector<Point>& positions, const std::vector<uint>& indices);
+
+    /**
+     * @brief Places a mesh in the scene. All the instances of a mesh share its triangles and its BVH.
+     * @param mesh The index of the mesh, returned by Scene::addMesh.
+     * @param transform The transform applied to the mesh.
+     * @param material The instance's material, or MaterialTable::meshMaterials to use the ones of the mesh.
+     * @return The index of the instance, to move or animate it.
+     */
+    uint addInstance(uint mesh, const mat4& transform, MaterialID material);
+
+    /**
+     * @brief Places a mesh in the scene. All the instances of a mesh share its triangles and its BVH.
+     * @param mesh The index of the mesh, returned by Scene::addMesh.
+     * @param transform The transform applied to the mesh.
+     * @param getColor The instance's color function.
+     * @return The index of the instance, to move or animate it.
+     */
+    uint addInstance(uint mesh, const mat4& transform, const ColorFunc& getColor);
+
+    /**
+     * @brief Places a mesh in the scene. All the instances of a mesh share its triangles and its BVH.
+     * @param mesh The index of the mesh, returned by Scene::addMesh.
+     * @param transform The transform applied to the mesh.
+     * @param color The instance's color.
+     * @return The index of the instance, to move or animate it.
+     */
+    uint addInstance(uint mesh, const mat4& transform, const Color& color = White());
+
+    /**
+     * @brief Moves an instance placed in the scene. The next render refits the top level BVH to the new bounds of the
+     * instance instead of building it again.
+     * @param instance The index of the instance, returned by Scene::addInstance.
+     * @param transform The new transform applied to the mesh.
+     */
+    void setInstanceTransform(uint instance, const mat4& transform);
+
+    /**
+     * @brief Animates an instance placed in the scene: Scene::setTime gives it the transform of the animation at
+     * that time. Until then, the instance keeps its transform.
+     * @param instance The index of the instance, returned by Scene::addInstance.
+     * @param animation The transform of the instance over time.
+     */
+    void animate(uint instance, const Animation& animation);
+
+    /**
+     * @brief Moves every animated instance to where its animation puts it at a time.
+     * @param time The time, in seconds.
+     */
+    void setTime(float time);
+
     /**
      * @brief Add a mesh to the scene.
      * @param meshPath The path to the mesh.
@@ -143,6 +355,23 @@ public:
      */
     Hit getClosestHit(const Ray& ray) const;
 
+    /**
+     * @brief Calculates the intersections between a packet of coherent rays and the objects in the scene.
+     * @param rays The rays.
+     * @param count The amount of rays, at most BVH::maxPacketSize.
+     * @param closest Will store the information on the object hit by each ray.
+     */
+    void getClosestHits(const Ray* rays, unsigned int count, Hit* closest) const;
+
+    /**
+     * @brief Checks if any object in the scene intersects a ray before a certain distance. Returns as soon as a
+     * blocking object is found.
+     * @param ray The ray to check the intersection with.
+     * @param tMax The distance after which intersections are ignored, e.g. the distance to a light.
+     * @return Whether the ray is blocked before tMax.
+     */
+    bool isOccluded(const Ray& ray, float tMax = infinity) const;
+
     /**
      * @brief Changes the color the sky is at its lowest point.
      * @param r The red channel.
@@ -159,19 +388,301 @@ public:
      */
     void setHighSkyColor(float r, float g, float b);
 
+    /**
+     * @brief Changes the strategy used to build the BVH on the next render.
+     * @param method The build method.
+     */
+    void setBVHBuildMethod(BVH::BuildMethod method);
+
+    /**
+     * @brief Changes the layout used to traverse the BVH on the next render.
+     * @param layout The layout.
+     */
+    void setBVHLayout(BVH::Layout layout);
+
+    /**
+     * @brief Changes the size of the square blocks of pixels whose camera rays are traced together as a packet.
+     * @param size The width of the blocks, from 1 to trace every ray on its own up to 8.
+     */
+    void setRayPacketSize(unsigned int size);
+
+    /**
+     * @brief Changes the size of the square tiles the image is split into. The threads take the tiles one at a time,
+     * in Morton order, until none are left.
+     * @param size The width of the tiles in pixels.
+     */
+    void setTileSize(unsigned int size);
+
+    /**
+     * @brief Changes the way the pixels are sampled on the next render. Fixed by default.
+     * @param mode The antialiasing mode.
+     */
+    void setAntialiasing(Antialiasing mode);
+
+    /**
+     * @brief Changes the amount of samples of the antialiased pixels: every pixel with fixed antialiasing, only the
+     * pixels that differ from their neighbours with adaptive antialiasing. 4 by default, on a rotated grid.
+     * @param count The amount of samples, from 1 to disable antialiasing up to 256.
+     */
+    void setSampleCount(unsigned int count);
+
+    /**
+     * @brief Changes how much a pixel must differ from one of its neighbours to get more samples with adaptive
+     * antialiasing. Pixels differ if they see different primitives, or if the largest difference between their color
+     * channels or 1 minus the cosine of the angle between their normals is above the threshold. 0.05 by default.
+     * @param threshold The threshold, 0 to sample again every pixel touching another primitive.
+     */
+    void setAdaptiveThreshold(float threshold);
+
+    /**
+     * @brief Changes the way the lights of the points seen by the camera are gathered on the next render. With
+     * stochastic sampling, each light picked is chosen among Scene::lightCandidateCount candidates drawn with a
+     * probability proportional to their power, by resampling them with the light they would bring to the point,
+     * which accounts for their distance. Only the chosen light casts a shadow ray, so the cost of a sample doesn't
+     * depend on the amount of lights, and the samples of each pixel converge to the same image as with every light.
+     * All by default.
+     * @param mode The light sampling mode.
+     */
+    void setLightSampling(LightSampling mode);
+
+    /**
+     * @brief Changes the amount of lights picked for each sample with stochastic light sampling. 1 by default.
+     * @param count The amount of lights, from 1 up to 64.
+     */
+    void setLightSampleCount(unsigned int count);
+
+    /**
+     * @brief Changes the way the samples go through the stages of the next render. With the wavefront pipeline, the
+     * camera rays of up to Scene::wavefrontSize samples of a tile are generated, then their closest hits are found a
+     * packet at a time, then their materials are evaluated and their lights gathered, queuing the shadow rays, which
+     * are finally traced sorted by light. Each stage runs through thousands of rays with its own code and data instead
+     * of alternating with the others for every packet. PerSample by default.
+     * @param pipeline The pipeline.
+     */
+    void setPipeline(Pipeline pipeline);
+
+    /**
+     * @brief Enables or disables the information printed while rendering. Enabled by default.
+     * @param enabled Whether to print information.
+     */
+    void setVerbose(bool enabled);
+
+    /**
+     * @brief Enables or disables the use of a MeshCache for the meshes loaded from files afterwards. Enabled by
+     * default.
+     * @param enabled Whether to read and write mesh caches.
+     */
+    void setMeshCaching(bool enabled);
+
+    /**
+     * @brief Changes the file format render writes the images in. PNG by default, PPM and QOI being faster to write.
+     * @param format The file format, which also gives the image's extension.
+     */
+    void setImageFormat(ImageWriter::Format format);
+
+    /**
+     * @brief Changes the compression level of the PNG images written by render. Deflate::defaultLevel by default.
+     * @param level The compression level, from 0 (stored without compression) to 9 (the smallest and slowest).
+     */
+    void setCompressionLevel(unsigned int level);
+
 private:
     /**
-     * @brief Computes an image.
-     * @param image The image to save to.
+     * @struct Scene::Tile
+     * @brief A rectangle of pixels of the image, rendered by a single thread.
+     */
+    struct Tile {
+        unsigned int firstColumn; ///< The column of the tile's first pixel.
+        unsigned int firstRow;    ///< The row of the tile's first pixel.
+        unsigned int columns;     ///< The tile's width, smaller than the tile size on the right of the image.
+        unsigned int rows;        ///< The tile's height, smaller than the tile size at the bottom of the image.
+    };
+
+    /**
+     * @struct Scene::WavefrontQueues
+     * @brief The samples queued by the wavefront pipeline and the shadow rays of their points, one entry per sample or
+     * per shadow ray in each vector.
+     */
+    struct WavefrontQueues {
+        std::vector<unsigned int> pixels;     ///< The index in the image of the pixel of each sample.
+        std::vector<uint32_t> seeds;          ///< The seed of the random numbers of each sample.
+        std::vector<Ray> rays;                ///< The camera ray of each sample.
+        std::vector<unsigned int> packetEnds; ///< The end of each packet of camera rays traced together.
+        std::vector<Hit> hits;                ///< The closest hit of each camera ray.
+        std::vector<Color> colors;            ///< The material of each sample's point, then the color of the sample.
+        std::vector<Color> lightColors;       ///< The light reaching each sample's point.
+
+        std::vector<Ray> shadowRays;               ///< The shadow rays.
+        std::vector<Color> shadowLights;           ///< The light each shadow ray brings if nothing blocks it.
+        std::vector<unsigned int> shadowSamples;   ///< The sample each shadow ray lights up.
+        std::vector<unsigned int> shadowLightIDs;  ///< The light each shadow ray goes to.
+        std::vector<unsigned int> shadowOrder;     ///< The shadow rays sorted by light, in the order they're traced.
+        std::vector<unsigned int> lightOffsets;    ///< The index in shadowOrder of the first ray of each light.
+        std::vector<unsigned char> shadowOccluded; ///< Whether each shadow ray is blocked.
+    };
+
+    /**
+     * @struct Scene::TileBuffers
+     * @brief The buffers a thread renders its tiles with, kept from one render to the next.
+     */
+    struct TileBuffers {
+        std::vector<Color> pixels;         ///< The final color of each pixel of the tile.
+        std::vector<Color> centerColors;   ///< The color seen through the center of the tile's pixels and its border.
+        std::vector<Hit> centerHits;       ///< The hit seen through the center of the tile's pixels and its border.
+        std::vector<unsigned int> refined; ///< The pixels that need more samples.
+        WavefrontQueues wavefront;         ///< The samples queued by the wavefront pipeline.
+    };
+
+    /**
+     * @brief Stores a rendered tile: receives the tile and its colors, row by row.
+     */
+    using TileStore = std::function<void(const Tile&, const Color*)>;
+
+    /**
+     * @brief Stores a sample traced by the wavefront pipeline: receives the index of its pixel in the image, its
+     * closest hit and its color.
+     */
+    using SampleStore = std::function<void(unsigned int, const Hit&, const Color&)>;
+
+    /**
+     * @brief Renders the scene to an image file, one band of rows at a time.
+     * @param path The path to the file, whose extension gives the format.
+     * @param width The image's width.
+     * @param height The image's height.
+     */
+    void renderToFile(const std::string& path, unsigned int width, unsigned int height);
+
+    /**
+     * @brief Builds the BVHs, or refits the top level one if instances only moved since the last render, and renders
+     * the tiles of an image with every thread.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @param byBands Whether to render the tiles one row of tiles at a time from the top, instead of in Morton order.
+     * @param store Stores each rendered tile, called by the render threads.
+     */
+    void renderTiles(unsigned int width, unsigned int height, bool byBands, const TileStore& store);
+
+    /**
+     * @brief Computes the tiles of an image until none are left. Each tile is rendered to a local buffer and then
+     * stored.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @param buffers The thread's buffers.
+     * @param store Stores each rendered tile.
+     */
+    void computeImage(unsigned int width, unsigned int height, TileBuffers& buffers, const TileStore& store);
+
+    /**
+     * @brief Renders a tile with fixed antialiasing.
+     * @param tile The tile.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @param buffers The thread's buffers, the colors are stored in buffers.pixels.
+     */
+    void computeFixedTile(const Tile& tile, unsigned int width, unsigned int height, TileBuffers& buffers);
+
+    /**
+     * @brief Renders a tile with adaptive antialiasing. The centers of the pixels on the tile's border are traced too,
+     * so that the pixels on its edges can be compared to the ones of the neighbouring tiles.
+     * @param tile The tile.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @param buffers The thread's buffers, the colors are stored in buffers.pixels.
+     * @return The amount of camera rays traced.
+     */
+    unsigned int computeAdaptiveTile(const Tile& tile, unsigned int width, unsigned int height, TileBuffers& buffers);
+
+    /**
+     * @brief Traces the camera rays going through the same sample of several pixels, as a packet.
+     * @param pixels The index of each pixel in the image, at most BVH::maxPacketSize.
+     * @param count The amount of pixels.
+     * @param offset The position of the sample relative to the center of the pixels.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @param hits Receives the closest hit of each ray.
+     * @param colors Receives the color seen by each ray.
+     */
+    void samplePixels(const unsigned int* pixels, unsigned int count, const vec2& offset, unsigned int width,
+                      unsigned int height, Hit* hits, Color* colors) const;
+
+    /**
+     * @brief Computes the camera ray going through a sample of a pixel.
+     * @param pixel The index of the pixel in the image.
+     * @param offset The position of the sample relative to the center of the pixel.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @return The camera ray.
+     */
+    Ray getCameraRay(unsigned int pixel, const vec2& offset, unsigned int width, unsigned int height) const;
+
+    /**
+     * @brief Camera ray generation stage of the wavefront pipeline: queues the same sample of several pixels, whose
+     * camera rays will be traced together as a packet.
+     * @param pixels The index of each pixel in the image, at most BVH::maxPacketSize.
+     * @param count The amount of pixels.
+     * @param offset The position of the sample relative to the center of the pixels.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @param queues The queues of the thread.
+     */
+    void queueSamples(const unsigned int* pixels, unsigned int count, const vec2& offset, unsigned int width,
+                      unsigned int height, WavefrontQueues& queues) const;
+
+    /**
+     * @brief Runs the queued samples through the other stages of the wavefront pipeline: the closest hits, the
+     * materials and the gathering of the lights, then the shadow rays. The samples are then stored in the order they
+     * were queued, and the queues are emptied.
+     * @param queues The queues of the thread.
+     * @param store Stores each sample.
+     */
+    void traceWavefront(WavefrontQueues& queues, const SampleStore& store) const;
+
+    /**
+     * @brief Lists the tiles of an image in Morton (Z-curve) order, so that consecutive tiles are close to each other,
+     * or one row of tiles at a time from the top of the image, so that its bands are completed in order.
+     * @param width The image's width.
+     * @param height The image's height.
+     * @param byBands Whether to list the tiles by rows instead of in Morton order.
      */
-    void computeImage(Image& image);
+    void orderTiles(unsigned int width, unsigned int height, bool byBands);
 
     /**
-     * @brief Computes a pixel's color.
-     * @param extremity The point the ray is cast to.
-     * @return The pixel's computed color.
+     * @brief Computes the color seen by a camera ray.
+     * @param ray The camera ray.
+     * @param closest The closest hit of the ray.
+     * @param seed The seed of the random numbers of the ray's sample, used by stochastic light sampling.
+     * @return The computed color.
      */
-    Color computePixel(Point extremity) const;
+    Color computePixel(const Ray& ray, const Hit& closest, uint32_t seed) const;
+
+    /**
+     * @brief Estimates the light reaching a point by picking a few lights, each one among candidates resampled with
+     * the light they would bring if they weren't in shadow.
+     * @param closest The hit.
+     * @param point The point, above the hit's surface.
+     * @param seed The seed of the random numbers.
+     * @return The estimated light.
+     */
+    Color sampleLights(const Hit& closest, const Point& point, uint32_t seed) const;
+
+    /**
+     * @brief Picks one of the lights estimating the light reaching a point, among candidates resampled with the light
+     * they would bring if they weren't in shadow.
+     * @param closest The hit.
+     * @param point The point, above the hit's surface.
+     * @param seed The state of the random numbers, advanced.
+     * @param light Receives the light brought by the picked light if it isn't in shadow, weighted by the estimator.
+     * @param shadowRay Receives the shadow ray going to the picked light.
+     * @return The index of the picked light, -1u if no light reaches the point.
+     */
+    unsigned int pickLight(const Hit& closest, const Point& point, uint32_t& seed, Color& light, Ray& shadowRay) const;
+
+    /**
+     * @brief Completes the closest hit found in the BVH with the planes and computes its normal.
+     * @param ray The ray.
+     * @param closest The closest hit found in the BVH.
+     */
+    void completeHit(const Ray& ray, Hit& closest) const;
 
     /**
      * @brief Prints info on the scene: The amount and type of lights and objects.
@@ -180,15 +691,41 @@ private:
 
     std::string name; ///< The scene's name.
 
-    unsigned int globalRow; ///< The current row being rendered.
+    ThreadPool threadPool; ///< The threads building the BVHs and rendering the image.
+
+    std::atomic<unsigned int> nextTile; ///< The index in tileOrder of the next tile to render.
+    std::vector<unsigned int> tileOrder;  ///< The index of every tile of the image, in the order they are rendered.
+    unsigned int tileSize;                ///< The width of the square tiles the image is split into.
+    unsigned int rayPacketSize;           ///< The width of the square blocks of pixels traced together.
+    std::vector<TileBuffers> tileBuffers; ///< The buffers of each render thread, kept from one render to the next.
+
+    Antialiasing antialiasing;                 ///< The way the pixels are sampled.
+    std::vector<vec2> sampleOffsets;           ///< The position of the samples relative to the pixels' center.
+    float adaptiveThreshold;                   ///< How much pixels must differ to get more samples.
+    LightSampling lightSampling;               ///< The way the lights of a point are gathered.
+    unsigned int lightSampleCount;             ///< The amount of lights picked per sample with stochastic sampling.
+    Pipeline pipeline;                         ///< The way the samples go through the stages of the render.
+    std::atomic<unsigned long> cameraRayCount; ///< The amount of camera rays traced during the last render.
+    RenderStatistics statistics;               ///< The measurements of the last render.
+    std::mutex countersMutex;                  ///< Protects the merge of the threads' counters in the statistics.
+    bool verbose;                              ///< Whether to print information while rendering.
+    ImageWriter::Format imageFormat;           ///< The file format of the images written by render.
+    unsigned int compressionLevel;             ///< The compression level of the PNG images written by render.
 
     Point camera; ///< The camera's position.
 
-    std::vector<const Light*> lights;   ///< The lights lighting up the scene.
-    std::vector<const Object*> objects; ///< The objects inside the scene.
-    std::vector<const Plane*> planes;   ///< The planes inside the scene.
+    std::vector<const Light*> lights; ///< The lights lighting up the scene.
+    LightGrid lightGrid;              ///< The lights that can light up each part of the scene.
+    Geometry geometry;                ///< The objects and mesh instances inside the scene.
+    std::vector<const Plane*> planes; ///< The planes inside the scene.
+
+    std::map<std::pair<std::string, bool>, uint> loadedMeshes; ///< The meshes loaded from files, by path and smoothness.
+    bool meshCaching;                                          ///< Whether to read and write mesh caches.
+    std::vector<std::pair<uint, Animation>> animations;        ///< The animated instances and their animations.
 
-    BVH bvh; ///< The bounding volume hierarchy used to calculate intersections.
+    BVH bvh;          ///< The top level bounding volume hierarchy, built over the objects and the mesh instances.
+    bool bvhOutdated; ///< Whether objects or instances were added, or the build method changed, since it was built.
+    bool bvhMoved;    ///< Whether instances moved since it was built or refitted.
 
     Color lowSkyColor;  ///< The color the sky is at its lowest point.
     Color highSkyColor; ///< The color the sky is at its highest point.
@@ -0,0 +1,67 @@
+/***************************************************************************************************
+ * @file  Statistics.hpp
+ * @brief Declaration of the Statistics struct
+ **************************************************************************************************/
+
+#pragma once
+
+#include <ostream>
+
+/**
+ * @struct Statistics
+ * @brief Counters of the work done by a render, to tell apart a bad BVH, too many lights and expensive color
+ * functions. The counters are only incremented when the project is compiled with SYNTHESE_STATISTICS (the CMake option
+ * of the same name), otherwise SYNTHESE_COUNT compiles to nothing and they stay at zero. Each thread increments its
+ * own counters, which the scene merges at the end of a render.
+ */
+struct Statistics {
+#ifdef SYNTHESE_STATISTICS
+    static constexpr bool enabled = true; ///< Whether the counters are compiled in.
+#else
+    static constexpr bool enabled = false; ///< Whether the counters are compiled in.
+#endif
+
+    /**
+     * @return The counters of the calling thread.
+     */
+    static Statistics& local() {
+        static thread_local Statistics statistics;
+        return statistics;
+    }
+
+    /**
+     * @brief Adds the counters of other statistics to these ones.
+     * @param other The other statistics.
+     */
+    void merge(const Statistics& other);
+
+    /**
+     * @brief Prints the counters, one per line, along with their averages per ray.
+     * @param stream The stream to print to.
+     */
+    void print(std::ostream& stream) const;
+
+    /**
+     * @brief Writes the counters as a JSON object.
+     * @param stream The stream to write to.
+     */
+    void writeJSON(std::ostream& stream) const;
+
+    unsigned long primaryRays{ 0 };           ///< The camera rays traced.
+    unsigned long shadowRays{ 0 };            ///< The rays traced toward the lights.
+    unsigned long nodesVisited{ 0 };          ///< The BVH nodes visited by each ray, in the top level and mesh BVHs.
+    unsigned long primitivesTested{ 0 };      ///< The intersection tests of the planes, objects and triangles.
+    unsigned long intersectionsFound{ 0 };    ///< The tests that found a closer hit, or an occluder for shadow rays.
+    unsigned long proceduralEvaluations{ 0 }; ///< The calls to the color functions of procedural materials.
+};
+
+#ifdef SYNTHESE_STATISTICS
+/**
+ * @brief Increments a counter of the calling thread's statistics.
+ * @param counter The name of the counter.
+ * @param amount The amount to add.
+ */
+#define SYNTHESE_COUNT(counter, amount) (Statistics::local().counter += (amount))
+#else
+#define SYNTHESE_COUNT(counter, amount) static_cast<void>(0)
+#endif
@@ -0,0 +1,103 @@
+/***************************************************************************************************
+ * @file  ThreadPool.hpp
+ * @brief Declaration of the ThreadPool class
+ **************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads running tasks from a shared queue. Tasks are gathered in task groups that can
+ * be waited on. A thread waiting on a group runs queued tasks until the group is done, so tasks can themselves create
+ * and wait on groups, e.g. to split a recursive build, without running out of threads.
+ */
+class ThreadPool {
+public:
+    /**
+     * @class ThreadPool::TaskGroup
+     * @brief Counts the tasks of a group that aren't done yet.
+     */
+    class TaskGroup {
+    public:
+        /**
+         * @brief Default constructor. Creates an empty group.
+         */
+        TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+    private:
+        friend class ThreadPool;
+
+        std::atomic<unsigned int> pendingCount; ///< The amount of tasks of the group that aren't done yet.
+    };
+
+    /**
+     * @brief Constructor. Starts the worker threads.
+     * @param threadCount The amount of worker threads, at least 1.
+     */
+    explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+
+    /**
+     * @brief Destructor. Waits for the queued tasks to be done and stops the worker threads.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @return The amount of worker threads.
+     */
+    unsigned int getThreadCount() const;
+
+    /**
+     * @brief Queues a task.
+     * @param group The group the task is part of.
+     * @param task The task.
+     */
+    void run(TaskGroup& group, std::function<void()> task);
+
+    /**
+     * @brief Waits for all the tasks of a group to be done, running queued tasks in the meantime.
+     * @param group The group.
+     */
+    void wait(TaskGroup& group);
+
+private:
+    /**
+     * @struct ThreadPool::Task
+     * @brief A queued task and the group it is part of.
+     */
+    struct Task {
+        std::function<void()> function; ///< The task.
+        TaskGroup* group;               ///< The group the task is part of.
+    };
+
+    /**
+     * @brief Runs tasks until the pool is stopped.
+     */
+    void work();
+
+    /**
+     * @brief Runs a task and marks it as done in its group.
+     * @param task The task.
+     */
+    void execute(Task& task);
+
+    std::vector<std::thread> threads;  ///< The worker threads.
+    std::deque<Task> tasks;            ///< The queued tasks.
+    std::mutex mutex;                  ///< Guards the queue and the stop flag.
+    std::condition_variable available; ///< Notified when a task is queued or when the pool is stopped.
+    std::condition_variable done;      ///< Notified when a task is done.
+    bool stopping;                     ///< Whether the worker threads should stop once the queue is empty.
+};
@@ -319,3 +319,17 @@ vec3 operator*(const mat4& mat, const vec3& vec);
  * @return The product of the matrix and the vec4.
  */
 vec4 operator*(const mat4& mat, const vec4& vec);
+
+/**
+ * @brief Calculates the transpose of a matrix.
+ * @param mat The matrix.
+ * @return The matrix with its rows and columns swapped.
+ */
+mat4 transpose(const mat4& mat);
+
+/**
+ * @brief Calculates the inverse of a matrix.
+ * @param mat The matrix. Throws a std::runtime_error if it is singular.
+ * @return The matrix M such that mat * M is the identity.
+ */
+mat4 inverse(const mat4& mat);
@@ -0,0 +1,33 @@
+/***************************************************************************************************
+ * @file  scenes.hpp
+ * @brief Declaration of the scenes of the project
+ **************************************************************************************************/
+
+#pragma once
+
+#include <span>
+#include "Scene.hpp"
+
+/**
+ * @struct SceneDefinition
+ * @brief A scene of the project, shared by the executables rendering it.
+ */
+struct SceneDefinition {
+    const char* name;               ///< The scene's name, also the name of its image.
+    void (*populate)(Scene& scene); ///< Adds the scene's sky, lights and objects to an empty scene.
+    unsigned int width;             ///< The width the scene is usually rendered at.
+    unsigned int height;            ///< The height the scene is usually rendered at.
+};
+
+/**
+ * @return The scenes of the project, in the order of their numbers.
+ */
+std::span<const SceneDefinition> getScenes();
+
+/**
+ * @brief Gets a scene of the project by its number.
+ * @param number The scene's number, starting from 1.
+ * @return The scene.
+ * @throw std::out_of_range If there is no scene with this number.
+ */
+const SceneDefinition& getScene(unsigned int number);
@@ -92,4 +92,37 @@ inline float triangle_area(uvec2 a, uvec2 b, uvec2 c) {
 
 inline bool is_in_triangle(uvec2 p, uvec2 a, uvec2 b, uvec2 c) {
     return triangle_area(a, b, c) >= triangle_area(p, b, c) + triangle_area(a, p, c) + triangle_area(a, b, p);
+}
+
+/**
+ * @brief Möller-Trumbore ray/triangle intersection, from the triangle's first point and its two edges starting there.
+ * Both sides of the triangle are hit. Doesn't need any square root.
+ * @param origin The ray's origin.
+ * @param direction The ray's direction.
+ * @param A The triangle's first point.
+ * @param edge1 B - A.
+ * @param edge2 C - A.
+ * @param t Set to the distance of the intersection along the ray.
+ * @param u Set to the barycentric coordinate of the intersection relative to B.
+ * @param v Set to the barycentric coordinate of the intersection relative to C.
+ * @return Whether the ray hits the triangle in front of its origin. If not, t, u and v are left unspecified.
+ */
+inline bool intersectTriangle(const Point& origin, const Vector& direction,
+                              const Point& A, const Vector& edge1, const Vector& edge2,
+                              float& t, float& u, float& v) {
+    const Vector p = cross(direction, edge2);
+    const float determinant = dot(edge1, p);
+    if(determinant == 0.0f) { return false; }
+
+    const float inverseDeterminant = 1.0f / determinant;
+    const Vector s = origin - A;
+    u = dot(s, p) * inverseDeterminant;
+    if(u < 0.0f || u > 1.0f) { return false; }
+
+    const Vector q = cross(s, edge1);
+    v = dot(direction, q) * inverseDeterminant;
+    if(v < 0.0f || u + v > 1.0f) { return false; }
+
+    t = dot(edge2, q) * inverseDeterminant;
+    return t >= 0.0f;
 }
\ No newline at end of file
@@ -1,7 +1,17 @@
-
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
-#include <map>
+#include <charconv>
+#include <string>
+#include <thread>
+#include <algorithm>
+
+#ifndef _MSC_VER
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
 
 #include "mesh_io.h"
 
@@ -9,202 +19,519 @@
 #include "image_io.h"
 
 
-bool read_positions( const char *filename, std::vector<Point>& positions )
+// contenu d'un fichier, projete en memoire avec mmap() ou charge en une seule fois si mmap() n'est pas disponible.
+struct mapped_file
 {
-    positions.clear();
+    const char *data;
+    size_t size;
     
-    FILE *in= fopen(filename, "rt");
-    if(!in)
+    mapped_file( ) : data(nullptr), size(0) {}
+    ~mapped_file( ) { close(); }
+    
+    mapped_file( const mapped_file& ) = delete;
+    mapped_file& operator= ( const mapped_file& ) = delete;
+    
+    bool open( const char *filename )
     {
-        printf("[error] loading mesh '%s'...\n", filename);
-        return false;
+        close();
+        
+    #ifndef _MSC_VER
+        int fd= ::open(filename, O_RDONLY);
+        if(fd < 0)
+            return false;
+        
+        struct stat info;
+        if(fstat(fd, &info) < 0 || !S_ISREG(info.st_mode))
+        {
+            ::close(fd);
+            return false;
+        }
+        
+        size= size_t(info.st_size);
+        if(size > 0)
+        {
+            map= mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(map == MAP_FAILED)
+            {
+                map= nullptr;
+                size= 0;
+                ::close(fd);
+                return false;
+            }
+            
+            madvise(map, size, MADV_SEQUENTIAL);
+            data= (const char *) map;
+        }
+        
+        ::close(fd);    // la projection reste valide
+        return true;
+        
+    #else
+        FILE *in= fopen(filename, "rb");
+        if(!in)
+            return false;
+        
+        fseek(in, 0, SEEK_END);
+        buffer.resize(size_t(ftell(in)));
+        fseek(in, 0, SEEK_SET);
+        size= fread(buffer.data(), 1, buffer.size(), in);
+        fclose(in);
+        
+        data= buffer.data();
+        return true;
+    #endif
     }
     
-    printf("loading mesh '%s'...\n", filename);
+    void close( )
+    {
+    #ifndef _MSC_VER
+        if(map)
+            munmap(map, size);
+        map= nullptr;
+    #else
+        buffer.clear();
+    #endif
+        data= nullptr;
+        size= 0;
+    }
     
-    std::vector<Point> wpositions;
+private:
+#ifndef _MSC_VER
+    void *map= nullptr;
+#else
+    std::vector<char> buffer;
+#endif
+};
+
+
+// changement d'etat lu dans un morceau du fichier : mtllib, usemtl ou o. applique dans l'ordre lors de la fusion des morceaux.
+struct obj_command
+{
+    char type;          // 'm' : mtllib, 'u' : usemtl, 'o' : objet
+    unsigned face;      // nombre de faces du morceau lues avant la commande
+    std::string name;
+};
+
+// resultat de l'analyse d'un morceau du fichier.
+struct obj_chunk
+{
+    std::vector<Point> positions;
+    std::vector<Point> texcoords;
+    std::vector<Vector> normals;
+    
+    // indices des attributs des sommets des faces, -1 si l'attribut n'est pas defini.
+    // les indices relatifs (< 0 dans le fichier) sont d'abord numerotes a partir du debut du morceau puis decales lors de la fusion.
     std::vector<int> wp;
+    std::vector<int> wt;
+    std::vector<int> wn;
+    std::vector<unsigned char> relative;    // 1 : wp est relatif, 2 : wt, 4 : wn
+    std::vector<unsigned> faces;            // indice du premier sommet de chaque face, + 1 sentinelle
+    std::vector<obj_command> commands;
     
-    char line_buffer[1024];
-    bool error= true;
-    for(;;)
+    unsigned triangles= 0;
+    
+    // position des attributs et des triangles du morceau dans le fichier complet
+    unsigned first_position= 0;
+    unsigned first_texcoord= 0;
+    unsigned first_normal= 0;
+    unsigned first_triangle= 0;
+    
+    bool failed= false;
+    std::string error;
+};
+
+// taille minimale d'un morceau analyse par un thread
+static const size_t obj_chunk_size= 256*1024;
+
+// execute f(i) pour chaque morceau i, en parallele.
+template < typename F >
+static void parallel_chunks( const unsigned n, const F& f )
+{
+    std::vector<std::thread> threads;
+    for(unsigned i= 1; i < n; i++)
+        threads.emplace_back([&f, i]( ) { f(i); });
+    
+    if(n > 0)
+        f(0);
+    
+    for(std::thread& thread : threads)
+        thread.join();
+}
+
+static const char *skip_spaces( const char *p, const char *end )
+{
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+// lit un entier apres des espaces eventuels, comme sscanf(" %d").
+static bool parse_int( const char *& p, const char *end, int& value )
+{
+    p= skip_spaces(p, end);
+    if(p < end && *p == '+')
+        p++;
+    
+    auto [next, ec]= std::from_chars(p, end, value);
+    if(ec != std::errc())
+        return false;
+    
+    p= next;
+    return true;
+}
+
+// lit un reel apres des espaces eventuels, comme sscanf(" %f").
+static bool parse_float( const char *& p, const char *end, float& value )
+{
+    p= skip_spaces(p, end);
+    if(p < end && *p == '+')
+        p++;
+    
+    auto [next, ec]= std::from_chars(p, end, value);
+    if(ec == std::errc::result_out_of_range)
+        value= strtof(std::string(p, next).c_str(), nullptr);     // infini ou denormalise, comme scanf
+    else if(ec != std::errc())
+        return false;
+    
+    p= next;
+    return true;
+}
+
+// verifie que la ligne commence par un mot cle suivi d'un espace ou de la fin de la ligne.
+static bool parse_keyword( const char *& p, const char *end, const char *keyword )
+{
+    size_t n= strlen(keyword);
+    if(size_t(end - p) < n || memcmp(p, keyword, n) != 0)
+        return false;
+    if(p + n < end && p[n] != ' ' && p[n] != '\t' && p[n] != '\r')
+        return false;
+    
+    p= p + n;
+    return true;
+}
+
+// analyse les lignes d'un morceau du fichier. ne lit que les positions et les faces si all_attributes est faux.
+static void parse_obj_chunk( const char *begin, const char *end, const bool all_attributes, obj_chunk& chunk )
+{
+    for(const char *line_begin= begin; line_begin < end; )
     {
-        // charge une ligne du fichier
-        if(!fgets(line_buffer, sizeof(line_buffer), in))
-        {
-            error= false;       // fin du fichier, pas d'erreur detectee
-            break;
-        }
-        
-        // force la fin de la ligne, au cas ou
-        line_buffer[sizeof(line_buffer) -1]= 0;
+        const char *eol= (const char *) memchr(line_begin, '\n', end - line_begin);
+        if(!eol)
+            eol= end;
         
         // saute les espaces en debut de ligne
-        char *line= line_buffer;
-        while(*line && isspace(*line))
-            line++;
+        const char *line= skip_spaces(line_begin, eol);
         
-        if(line[0] == 'v')
+        bool error= false;
+        if(line + 1 < eol && line[0] == 'v')
         {
             float x, y, z;
-            if(line[1] == ' ')          // position x y z
+            if(line[1] == ' ' || line[1] == '\t')          // position x y z
             {
-                if(sscanf(line, "v %f %f %f", &x, &y, &z) != 3)
-                    break;
-                wpositions.push_back( Point(x, y, z) );
+                line= line +1;
+                error= !parse_float(line, eol, x) || !parse_float(line, eol, y) || !parse_float(line, eol, z);
+                if(!error)
+                    chunk.positions.push_back( Point(x, y, z) );
+            }
+            else if(all_attributes && line[1] == 'n')     // normal x y z
+            {
+                line= line +2;
+                error= !parse_float(line, eol, x) || !parse_float(line, eol, y) || !parse_float(line, eol, z);
+                if(!error)
+                    chunk.normals.push_back( Vector(x, y, z) );
+            }
+            else if(all_attributes && line[1] == 't')     // texcoord x y
+            {
+                line= line +2;
+                error= !parse_float(line, eol, x) || !parse_float(line, eol, y);
+                if(!error)
+                    chunk.texcoords.push_back( Point(x, y, 0) );
             }
         }
         
-        else if(line[0] == 'f')         // triangle a b c, les sommets sont numerotes a partir de 1 ou de la fin du tableau (< 0)
+        else if(line < eol && line[0] == 'f')         // face a b c ..., les sommets sont numerotes a partir de 1 ou de la fin du tableau (< 0)
         {
-            wp.clear();
+            unsigned first= chunk.wp.size();
+            chunk.faces.push_back(first);
             
-            int next= 0;
-            for(line= line +1; ; line= line + next)
+            // analyse les attributs des sommets : p/t/n ou p//n ou p/t ou p...
+            for(line= line +1; ; )
             {
-                wp.push_back(0); 
+                int p= 0;
+                int t= 0;
+                int n= 0;       // 0: indice invalide
+                if(!parse_int(line, eol, p))
+                    break;      // fin de ligne
                 
-                // analyse les attributs du sommet : p/t/n ou p//n ou p/t ou p...
-                next= 0;
-                int wt= 0;
-                int wn= 0;
-                if(sscanf(line, " %d/%d/%d %n", &wp.back(), &wt, &wn, &next) == 3) 
-                    continue;
-                else if(sscanf(line, " %d/%d %n", &wp.back(), &wt, &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d//%d %n", &wp.back(), &wn, &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d %n", &wp.back(), &next) == 1)
-                    continue;
-                else if(next == 0)      // fin de ligne
-                    break;
+                if(line < eol && *line == '/')
+                {
+                    line++;
+                    if(line < eol && *line == '/')
+                    {
+                        line++;
+                        if(!parse_int(line, eol, n))
+                            break;
+                    }
+                    else
+                    {
+                        if(!parse_int(line, eol, t))
+                            break;
+                        if(line < eol && *line == '/')
+                        {
+                            line++;
+                            if(!parse_int(line, eol, n))
+                                break;
+                        }
+                    }
+                }
+                
+                // les indices relatifs sont numerotes a partir du debut du morceau, la fusion ajoute la position du morceau dans le fichier
+                unsigned char relative= 0;
+                if(p < 0) relative|= 1;
+                if(t < 0) relative|= 2;
+                if(n < 0) relative|= 4;
+                
+                chunk.wp.push_back( (p < 0) ? int(chunk.positions.size()) + p : p -1 );
+                if(all_attributes)
+                {
+                    chunk.wt.push_back( (t < 0) ? int(chunk.texcoords.size()) + t : t -1 );
+                    chunk.wn.push_back( (n < 0) ? int(chunk.normals.size()) + n : n -1 );
+                }
+                chunk.relative.push_back(relative);
             }
             
-            // triangule la face
-            for(unsigned v= 2; v +1 < wp.size(); v++)
+            unsigned count= chunk.wp.size() - first;
+            if(count > 2)
+                chunk.triangles+= count - 2;
+        }
+        
+        else if(all_attributes && line < eol && (line[0] == 'm' || line[0] == 'u' || line[0] == 'o'))
+        {
+            char type= 0;
+            if(parse_keyword(line, eol, "mtllib"))
+                type= 'm';
+            else if(parse_keyword(line, eol, "usemtl"))
+                type= 'u';
+            else if(parse_keyword(line, eol, "o"))
+                type= 'o';
+            
+            if(type)
             {
-                unsigned idv[3]= { 0, v -1, v };
-                for(unsigned i= 0; i < 3; i++)
-                {
-                    unsigned k= idv[i];
-                    int p= (wp[k] < 0) ? int(wpositions.size()) + wp[k] : wp[k] -1;
-                    if(p < 0) break; // error
-                    
-                    // et duplique les positions...
-                    assert(p < int(wpositions.size()));
-                    positions.push_back(wpositions[p]);
-                }
+                // le nom va jusqu'a la fin de la ligne, sauf pour un objet qui n'utilise que le premier mot
+                const char *name= skip_spaces(line, eol);
+                const char *name_end= eol;
+                if(type == 'o')
+                    name_end= std::find_if(name, eol, []( const char c ) { return c == ' ' || c == '\t' || c == '\r'; });
+                while(name_end > name && name_end[-1] == '\r')
+                    name_end--;
+                
+                if(name < name_end)
+                    chunk.commands.push_back({ type, unsigned(chunk.faces.size()), std::string(name, name_end) });
             }
         }
+        
+        if(error)
+        {
+            chunk.failed= true;
+            chunk.error= std::string(line_begin, eol);
+            break;
+        }
+        
+        line_begin= eol +1;
     }
     
-    fclose(in);
-    
-    if(error)
-        printf("[error] loading mesh '%s'...\n%s\n\n", filename, line_buffer);
-    else
-        printf("mesh '%s': %d positions\n", filename, int(positions.size()));
-
-    return !error;
+    chunk.faces.push_back(chunk.wp.size());     // sentinelle, fin de la derniere face
 }
 
-
-bool read_indexed_positions( const char *filename, std::vector<Point>& positions, std::vector<unsigned>& indices )
+/* decoupe le fichier en morceaux analyses en parallele et fusionne les indices des sommets : a la fin, les indices des attributs
+   des faces de chaque morceau sont numerotes dans le fichier complet, et la position des attributs et des triangles de chaque
+   morceau est connue, ce qui permet de construire le resultat en parallele.
+ */
+static bool parse_obj( const mapped_file& file, const bool all_attributes, std::vector<obj_chunk>& chunks, std::string& error )
 {
-    positions.clear();
-    indices.clear();
+    unsigned n= std::max(1u, std::min(std::thread::hardware_concurrency(), unsigned(file.size / obj_chunk_size)));
     
-    FILE *in= fopen(filename, "rt");
-    if(!in)
+    // coupe les morceaux en debut de ligne
+    std::vector<const char *> bounds(n +1);
+    bounds[0]= file.data;
+    bounds[n]= file.data + file.size;
+    for(unsigned i= 1; i < n; i++)
     {
-        printf("[error] loading indexed mesh '%s'...\n", filename);
-        return false;
+        const char *bound= std::max(bounds[i -1], file.data + file.size / n * i);
+        const char *eol= (const char *) memchr(bound, '\n', bounds[n] - bound);
+        bounds[i]= eol ? eol +1 : bounds[n];
     }
     
-    printf("loading indexed mesh '%s'...\n", filename);
-    
-    std::vector<int> wp;
+    chunks.clear();
+    chunks.resize(n);
+    parallel_chunks(n, [&]( const unsigned i ) { parse_obj_chunk(bounds[i], bounds[i +1], all_attributes, chunks[i]); });
     
-    char line_buffer[1024];
-    bool error= true;
-    for(;;)
+    // position des attributs et des triangles de chaque morceau dans le fichier complet
+    unsigned positions= 0;
+    unsigned texcoords= 0;
+    unsigned normals= 0;
+    unsigned triangles= 0;
+    for(obj_chunk& chunk : chunks)
     {
-        // charge une ligne du fichier
-        if(!fgets(line_buffer, sizeof(line_buffer), in))
-        {
-            error= false;       // fin du fichier, pas d'erreur detectee
-            break;
-        }
-        
-        // force la fin de la ligne, au cas ou
-        line_buffer[sizeof(line_buffer) -1]= 0;
-        
-        // saute les espaces en debut de ligne
-        char *line= line_buffer;
-        while(*line && isspace(*line))
-            line++;
-        
-        if(line[0] == 'v')
+        if(chunk.failed)
         {
-            float x, y, z;
-            if(line[1] == ' ')          // position x y z
-            {
-                if(sscanf(line, "v %f %f %f", &x, &y, &z) != 3)
-                    break;
-                positions.push_back( Point(x, y, z) );
-            }
+            error= chunk.error;
+            return false;
         }
         
-        else if(line[0] == 'f')         // triangle a b c, les sommets sont numerotes a partir de 1 ou de la fin du tableau (< 0)
+        chunk.first_position= positions;
+        chunk.first_texcoord= texcoords;
+        chunk.first_normal= normals;
+        chunk.first_triangle= triangles;
+        positions+= chunk.positions.size();
+        texcoords+= chunk.texcoords.size();
+        normals+= chunk.normals.size();
+        triangles+= chunk.triangles;
+    }
+    
+    // decale les indices relatifs et verifie tous les indices
+    parallel_chunks(n, [&]( const unsigned i )
+    {
+        obj_chunk& chunk= chunks[i];
+        for(unsigned k= 0; k < chunk.wp.size(); k++)
         {
-            wp.clear();
+            if(chunk.relative[k] & 1) chunk.wp[k]+= chunk.first_position;
+            bool valid= chunk.wp[k] >= 0 && chunk.wp[k] < int(positions);
             
-            int next= 0;
-            for(line= line +1; ; line= line + next)
+            if(all_attributes)
             {
-                wp.push_back(0); 
-                
-                // analyse les attributs du sommet : p/t/n ou p//n ou p/t ou p...
-                next= 0;
-                int wt= 0;
-                int wn= 0;
-                if(sscanf(line, " %d/%d/%d %n", &wp.back(), &wt, &wn, &next) == 3) 
-                    continue;
-                else if(sscanf(line, " %d/%d %n", &wp.back(), &wt, &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d//%d %n", &wp.back(), &wn, &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d %n", &wp.back(), &next) == 1)
-                    continue;
-                else if(next == 0)      // fin de ligne
-                    break;
+                if(chunk.relative[k] & 2) chunk.wt[k]+= chunk.first_texcoord;
+                if(chunk.relative[k] & 4) chunk.wn[k]+= chunk.first_normal;
+                valid= valid && chunk.wt[k] >= -1 && chunk.wt[k] < int(texcoords)
+                    && chunk.wn[k] >= -1 && chunk.wn[k] < int(normals);
             }
             
-            // triangule la face
-            for(unsigned v= 2; v +1 < wp.size(); v++)
+            if(!valid)
             {
-                unsigned idv[3]= { 0, v -1, v };
-                for(unsigned i= 0; i < 3; i++)
-                {
-                    unsigned k= idv[i];
-                    int p= (wp[k] < 0) ? int(positions.size()) + wp[k] : wp[k] -1;
-                    if(p < 0) break; // error
-                    
-                    assert(p < int(positions.size()));
-                    indices.push_back(p);
-                }
+                chunk.failed= true;
+                chunk.error= "invalid vertex index in face";
+                break;
             }
         }
+    });
+    
+    for(const obj_chunk& chunk : chunks)
+    {
+        if(chunk.failed)
+        {
+            error= chunk.error;
+            return false;
+        }
     }
     
-    fclose(in);
+    return true;
+}
+
+// rassemble les positions de tous les morceaux.
+static void merge_positions( const std::vector<obj_chunk>& chunks, std::vector<Point>& positions )
+{
+    const obj_chunk& last= chunks.back();
+    positions.resize(last.first_position + last.positions.size());
+    parallel_chunks(chunks.size(), [&]( const unsigned i )
+    {
+        std::copy(chunks[i].positions.begin(), chunks[i].positions.end(), positions.begin() + chunks[i].first_position);
+    });
+}
+
+
+bool read_positions( const char *filename, std::vector<Point>& positions )
+{
+    positions.clear();
     
-    if(error)
-        printf("[error] loading indexed mesh '%s'...\n%s\n\n", filename, line_buffer);
-    else
-        printf("indexed mesh '%s': %d positions, %d indices\n", filename, int(positions.size()), int(indices.size()));
+    mapped_file file;
+    if(!file.open(filename))
+    {
+        printf("[error] loading mesh '%s'...\n", filename);
+        return false;
+    }
+    
+    printf("loading mesh '%s'...\n", filename);
+    
+    std::vector<obj_chunk> chunks;
+    std::string error;
+    if(!parse_obj(file, false, chunks, error))
+    {
+        printf("[error] loading mesh '%s'...\n%s\n\n", filename, error.c_str());
+        return false;
+    }
+    
+    std::vector<Point> wpositions;
+    merge_positions(chunks, wpositions);
+    
+    // triangule les faces et duplique les positions...
+    const obj_chunk& last= chunks.back();
+    positions.resize(3 * (last.first_triangle + last.triangles));
+    parallel_chunks(chunks.size(), [&]( const unsigned i )
+    {
+        const obj_chunk& chunk= chunks[i];
+        Point *out= positions.data() + 3 * chunk.first_triangle;
+        for(unsigned f= 0; f +1 < chunk.faces.size(); f++)
+        {
+            unsigned first= chunk.faces[f];
+            for(unsigned v= first +2; v < chunk.faces[f +1]; v++)
+            {
+                *out++= wpositions[chunk.wp[first]];
+                *out++= wpositions[chunk.wp[v -1]];
+                *out++= wpositions[chunk.wp[v]];
+            }
+        }
+    });
+    
+    printf("mesh '%s': %d positions\n", filename, int(positions.size()));
+    return true;
+}
 
-    return !error;
+
+bool read_indexed_positions( const char *filename, std::vector<Point>& positions, std::vector<unsigned>& indices )
+{
+    positions.clear();
+    indices.clear();
+    
+    mapped_file file;
+    if(!file.open(filename))
+    {
+        printf("[error] loading indexed mesh '%s'...\n", filename);
+        return false;
+    }
+    
+    printf("loading indexed mesh '%s'...\n", filename);
+    
+    std::vector<obj_chunk> chunks;
+    std::string error;
+    if(!parse_obj(file, false, chunks, error))
+    {
+        printf("[error] loading indexed mesh '%s'...\n%s\n\n", filename, error.c_str());
+        return false;
+    }
+    
+    merge_positions(chunks, positions);
+    
+    // triangule les faces
+    const obj_chunk& last= chunks.back();
+    indices.resize(3 * (last.first_triangle + last.triangles));
+    parallel_chunks(chunks.size(), [&]( const unsigned i )
+    {
+        const obj_chunk& chunk= chunks[i];
+        unsigned *out= indices.data() + 3 * chunk.first_triangle;
+        for(unsigned f= 0; f +1 < chunk.faces.size(); f++)
+        {
+            unsigned first= chunk.faces[f];
+            for(unsigned v= first +2; v < chunk.faces[f +1]; v++)
+            {
+                *out++= chunk.wp[first];
+                *out++= chunk.wp[v -1];
+                *out++= chunk.wp[v];
+            }
+        }
+    });
+    
+    printf("indexed mesh '%s': %d positions, %d indices\n", filename, int(positions.size()), int(indices.size()));
+    return true;
 }
 
 
@@ -412,14 +739,10 @@ struct vertex
     vertex( ) : material(-1), position(-1), texcoord(-1), normal(-1) {}
     vertex( const int m, const int p, const int t, const int n ) : material(m), position(p), texcoord(t), normal(n) {}
     
-    // comparaison lexicographique de 2 sommets / des indices de leurs attributs
-    bool operator< ( const vertex& b ) const
+    // compare les indices des attributs de 2 sommets
+    bool operator== ( const vertex& b ) const
     {
-        if(material != b.material) return material < b.material;
-        if(position != b.position) return position < b.position;
-        if(texcoord != b.texcoord) return texcoord < b.texcoord;
-        if(normal != b.normal) return normal < b.normal;
-        return false;
+        return material == b.material && position == b.position && texcoord == b.texcoord && normal == b.normal;
     }
 };
 
@@ -504,8 +827,8 @@ std::vector<MeshIOGroup> MeshIOData::groups( const std::vector<int>& properties
 
 bool read_meshio_data( const char *filename, MeshIOData& data )
 {
-    FILE *in= fopen(filename, "rt");
-    if(!in)
+    mapped_file file;
+    if(!file.open(filename))
     {
         printf("[error] loading indexed mesh '%s'...\n", filename);
         return false;
@@ -513,86 +836,69 @@ bool read_meshio_data( const char *filename, MeshIOData& data )
     
     printf("loading indexed mesh '%s'...\n", filename);
     
+    std::vector<obj_chunk> chunks;
+    std::string error;
+    if(!parse_obj(file, true, chunks, error))
+    {
+        printf("[error] loading indexed mesh '%s'...\n%s\n\n", filename, error.c_str());
+        return false;
+    }
+    
     std::vector<Point> wpositions;
     std::vector<Point> wtexcoords;
     std::vector<Vector> wnormals;
+    merge_positions(chunks, wpositions);
+    for(const obj_chunk& chunk : chunks)
+    {
+        wtexcoords.insert(wtexcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+        wnormals.insert(wnormals.end(), chunk.normals.begin(), chunk.normals.end());
+    }
     
-    std::vector<int> wp;
-    std::vector<int> wt;
-    std::vector<int> wn;
+    // les sommets deja crees, chaines par position : la plupart des positions n'ont qu'un seul sommet
+    std::vector<vertex> vertices;
+    std::vector<unsigned> next_vertex;
+    std::vector<unsigned> first_vertex(wpositions.size(), ~0u);
     
-    std::map<vertex, unsigned> remap;
     int material_id= -1;
     int object_id= -1;
     
-    char tmp[1024];
-    char line_buffer[1024];
-    bool error= true;
-    for(;;)
+    // applique les changements d'etat dans l'ordre du fichier
+    auto apply= [&]( const obj_command& command )
     {
-        // charge une ligne du fichier
-        if(!fgets(line_buffer, sizeof(line_buffer), in))
+        if(command.type == 'm')
         {
-            error= false;       // fin du fichier, pas d'erreur detectee
-            break;
+            std::string materials_filename;
+            if(command.name[0] != '/' && command.name[1] != ':')   // windows c:\ pour les chemins complets...
+                materials_filename= normalize_filename(pathname(filename) + command.name);
+            else
+                materials_filename= command.name;
+            
+            // charge les matieres, ou pas...
+            read_materials_mtl( materials_filename.c_str(), data.materials );
         }
+        else if(command.type == 'u')
+            material_id= data.materials.find(command.name.c_str());
         
-        // force la fin de la ligne, au cas ou
-        line_buffer[sizeof(line_buffer) -1]= 0;
-        
-        // saute les espaces en debut de ligne
-        char *line= line_buffer;
-        while(*line && isspace(*line))
-            line++;
-        
-        if(line[0] == 'v')
+        else if(command.type == 'o')
         {
-            float x, y, z;
-            if(line[1] == ' ')          // position x y z
-            {
-                if(sscanf(line, "v %f %f %f", &x, &y, &z) != 3)
-                    break;
-                wpositions.push_back( Point(x, y, z) );
-            }
-            else if(line[1] == 'n')     // normal x y z
-            {
-                if(sscanf(line, "vn %f %f %f", &x, &y, &z) != 3)
-                    break;
-                wnormals.push_back( Vector(x, y, z) );
-            }
-            else if(line[1] == 't')     // texcoord x y
+            object_id= data.find_object(command.name.c_str());
+            if(object_id == -1)
             {
-                if(sscanf(line, "vt %f %f", &x, &y) != 2)
-                    break;
-                wtexcoords.push_back( Point(x, y, 0) );
+                object_id= data.object_names.size();
+                data.object_names.push_back(command.name);
             }
+            
+            printf("object '%s': %d\n", command.name.c_str(), object_id);
         }
-        else if(line[0] == 'f')         // triangle a b c, les sommets sont numerotes a partir de 1 ou de la fin du tableau (< 0)
+    };
+    
+    for(const obj_chunk& chunk : chunks)
+    {
+        unsigned c= 0;
+        for(unsigned f= 0; f +1 < chunk.faces.size(); f++)
         {
-            wp.clear();
-            wt.clear();
-            wn.clear();
-            
-            int next;
-            for(line= line +1; ; line= line + next)
-            {
-                wp.push_back(0); 
-                wt.push_back(0); 
-                wn.push_back(0);         // 0: invalid index
-                
-                // analyse les attributs du sommet : p/t/n ou p//n ou p/t ou p...
-                next= 0;
-                if(sscanf(line, " %d/%d/%d %n", &wp.back(), &wt.back(), &wn.back(), &next) == 3) 
-                    continue;
-                else if(sscanf(line, " %d/%d %n", &wp.back(), &wt.back(), &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d//%d %n", &wp.back(), &wn.back(), &next) == 2)
-                    continue;
-                else if(sscanf(line, " %d %n", &wp.back(), &next) == 1)
-                    continue;
-                else if(next == 0)      // fin de ligne
-                    break;
-            }
+            for(; c < chunk.commands.size() && chunk.commands[c].face == f; c++)
+                apply(chunk.commands[c]);
             
             // force une matiere par defaut, si necessaire
             if(material_id == -1)
@@ -609,101 +915,47 @@ bool read_meshio_data( const char *filename, MeshIOData& data )
             }
             
             // triangule la face
-            for(unsigned v= 2; v +1 < wp.size(); v++)
+            unsigned first= chunk.faces[f];
+            for(unsigned v= first +2; v < chunk.faces[f +1]; v++)
             {
                 data.material_indices.push_back(material_id);
                 data.object_indices.push_back(object_id);
                 
-                unsigned idv[3]= { 0, v -1, v };
+                unsigned idv[3]= { first, v -1, v };
                 for(unsigned i= 0; i < 3; i++)
                 {
                     unsigned k= idv[i];
                     // indices des attributs du sommet
-                    int p= (wp[k] < 0) ? int(wpositions.size()) + wp[k] : wp[k] -1;
-                    int t= (wt[k] < 0) ? int(wtexcoords.size()) + wt[k] : wt[k] -1;
-                    int n= (wn[k] < 0) ? int(wnormals.size())   + wn[k] : wn[k] -1;
+                    vertex key(material_id, chunk.wp[k], chunk.wt[k], chunk.wn[k]);
                     
-                    if(p < 0) break; // error
+                    // recherche / insere le sommet
+                    unsigned id= first_vertex[key.position];
+                    while(id != ~0u && !(vertices[id] == key))
+                        id= next_vertex[id];
                     
-                    // recherche / insere le sommet 
-                    auto found= remap.insert( std::make_pair(vertex(material_id, p, t, n), unsigned(remap.size())) );
-                    if(found.second)
+                    if(id == ~0u)
                     {
                         // pas trouve, copie les nouveaux attributs
-                        if(t != -1) data.texcoords.push_back(wtexcoords[t]);
-                        if(n != -1) data.normals.push_back(wnormals[n]);
-                        data.positions.push_back(wpositions[p]);
+                        id= vertices.size();
+                        vertices.push_back(key);
+                        next_vertex.push_back(first_vertex[key.position]);
+                        first_vertex[key.position]= id;
+                        
+                        if(key.texcoord != -1) data.texcoords.push_back(wtexcoords[key.texcoord]);
+                        if(key.normal != -1) data.normals.push_back(wnormals[key.normal]);
+                        data.positions.push_back(wpositions[key.position]);
                     }
                     
                     // construit l'index buffer
-                    assert(found.first->second < data.positions.size());
-                    data.indices.push_back(found.first->second);
+                    data.indices.push_back(id);
                 }
             }
         }
         
-        else if(line[0] == 'm')
-        {
-            if(sscanf(line, "mtllib %[^\r\n]", tmp) == 1)
-            {
-                std::string materials_filename;
-                if(tmp[0] != '/' && tmp[1] != ':')   // windows c:\ pour les chemins complets...
-                    materials_filename= normalize_filename(pathname(filename) + tmp);
-                else
-                    materials_filename= std::string(tmp);
-                
-                // charge les matieres, ou pas... 
-                read_materials_mtl( materials_filename.c_str(), data.materials );
-            }
-        }
-        
-        else if(line[0] == 'u')
-        {
-           if(sscanf(line, "usemtl %[^\r\n]", tmp) == 1)
-               material_id= data.materials.find(tmp);
-        }
-        
-        else if(line[0] == 'o')
-        {
-            if(sscanf(line, "o %s", tmp) == 1)
-            {
-                object_id= data.find_object(tmp);
-                if(object_id == -1)
-                {
-                    object_id= data.object_names.size();
-                    data.object_names.push_back(tmp);
-                }
-                
-                printf("object '%s': %d\n", tmp, object_id);
-            }
-        }
-    #if 0
-        else if(line[0] == 'g')
-        {
-            // ne lit que le 1er groupe 
-            if(sscanf(line, "g %s", tmp) == 1)
-            {
-                object_id= data.find_object(tmp);
-                if(object_id == -1)
-                {
-                    object_id= data.object_names.size();
-                    data.object_names.push_back(tmp);
-                }
-                
-                printf("object '%s': %d\n", tmp, object_id);
-            }
-        }
-    #endif
+        for(; c < chunk.commands.size(); c++)
+            apply(chunk.commands[c]);
     }
     
-    fclose(in);
-    
-    if(error)
-    {
-        printf("[error] loading indexed mesh '%s'...\n%s\n\n", filename, line_buffer);
-        return false;
-    }
-
     printf("  %d indices, %d positions %d texcoords %d normals\n", 
         int(data.indices.size()), int(data.positions.size()), int(data.texcoords.size()), int(data.normals.size()));
     printf("  %d materials, %d textures\n", data.materials.count(), data.materials.filename_count());
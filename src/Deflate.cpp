@@ -0,0 +1,305 @@
+/***************************************************************************************************
+ * @file  Deflate.cpp
+ * @brief Implementation of the Deflate class
+ **************************************************************************************************/
+
+#include "Deflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <thread>
+
+/// The shortest length of each length code, from symbol 257, followed by the end of the last range.
+static constexpr std::array<uint16_t, 30> lengthBases{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+    259
+};
+
+/// The amount of extra bits of each length code.
+static constexpr std::array<uint8_t, 29> lengthExtraBits{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/// The shortest distance of each distance code.
+static constexpr std::array<uint16_t, 30> distanceBases{
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+
+/// The amount of extra bits of each distance code.
+static constexpr std::array<uint8_t, 30> distanceExtraBits{
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/**
+ * @brief Reverses the order of the lowest bits of a value, Huffman codes being written from their most significant bit.
+ * @param value The value.
+ * @param count The amount of bits.
+ * @return The reversed bits.
+ */
+static constexpr uint32_t reverseBits(uint32_t value, unsigned int count) {
+    uint32_t reversed = 0;
+    for(unsigned int i = 0 ; i < count ; ++i) {
+        reversed = (reversed << 1) | (value & 1);
+        value >>= 1;
+    }
+
+    return reversed;
+}
+
+/**
+ * @struct FixedCode
+ * @brief The fixed Huffman code of a literal or length symbol, reversed to be written least significant bit first.
+ */
+struct FixedCode {
+    uint16_t bits;        ///< The reversed code.
+    unsigned char length; ///< The amount of bits of the code.
+};
+
+/**
+ * @brief Computes the fixed Huffman codes of the literal and length symbols (RFC 1951, section 3.2.6).
+ * @return The code of each symbol.
+ */
+static constexpr std::array<FixedCode, 288> computeFixedCodes() {
+    std::array<FixedCode, 288> codes{};
+    for(unsigned int symbol = 0 ; symbol < 288 ; ++symbol) {
+        uint32_t code;
+        unsigned int length;
+        if(symbol < 144) {
+            code = 0x30 + symbol;
+            length = 8;
+        } else if(symbol < 256) {
+            code = 0x190 + symbol - 144;
+            length = 9;
+        } else if(symbol < 280) {
+            code = symbol - 256;
+            length = 7;
+        } else {
+            code = 0xC0 + symbol - 280;
+            length = 8;
+        }
+
+        codes[symbol] = { static_cast<uint16_t>(reverseBits(code, length)), static_cast<unsigned char>(length) };
+    }
+
+    return codes;
+}
+
+static constexpr std::array<FixedCode, 288> fixedCodes = computeFixedCodes(); ///< The fixed Huffman codes.
+
+Deflate::Deflate(unsigned int level, unsigned int threadCount)
+    : level(std::min(level, 9u)), threadCount(std::max(threadCount, 1u)), maxChainLength(2u << this->level),
+      historyStart(0), insertedEnd(0), bitBuffer(0), bitCount(0), adlerA(1), adlerB(0), started(false) {
+
+    // The hash chains of the parallel strips belong to each strip
+    if(this->level > 0 && this->threadCount == 1) {
+        head.assign(1 << hashBits, -1);
+        previous.assign(windowSize, -1);
+    }
+}
+
+void Deflate::compress(std::span<const unsigned char> data, bool last, std::vector<unsigned char>& output) {
+    if(!started) {
+        // CMF: deflate with a 32 KiB window, FLG: the compression level, the header being a multiple of 31
+        output.push_back(0x78);
+        output.push_back(level <= 1 ? 0x01 : level <= 5 ? 0x5E : level == 6 ? 0x9C : 0xDA);
+        started = true;
+    }
+
+    // Adler-32, reduced modulo 65521 before the sums can overflow
+    for(size_t i = 0 ; i < data.size() ; i += 5552) {
+        const size_t end = std::min(data.size(), i + 5552);
+        for(size_t j = i ; j < end ; ++j) {
+            adlerA += data[j];
+            adlerB += adlerA;
+        }
+        adlerA %= 65521;
+        adlerB %= 65521;
+    }
+
+    if(level == 0) {
+        writeStored(data, last, output);
+    } else if(threadCount == 1) {
+        const uint32_t partStart = history.size();
+        history.insert(history.end(), data.begin(), data.end());
+        compressBlock(partStart, last, output);
+        if(last) { alignToByte(true, output); }
+    } else {
+        // The strips are at least as large as the window, so the dictionary of all but the first one is in the part
+        const size_t stripCount = std::clamp<size_t>(data.size() / minStripSize, 1, threadCount);
+        const size_t stripSize = data.size() / stripCount;
+        std::vector<std::vector<unsigned char>> strips(stripCount);
+
+        const auto compressStrip = [this, data, last, stripCount, stripSize, &strips](size_t strip) {
+            const size_t begin = strip * stripSize;
+            const size_t end = strip + 1 == stripCount ? data.size() : begin + stripSize;
+            const std::span<const unsigned char> dictionary = strip == 0
+                ? std::span<const unsigned char>(history)
+                : data.subspan(begin - windowSize, windowSize);
+
+            this->compressStrip(dictionary, data.subspan(begin, end - begin), last && strip + 1 == stripCount,
+                                strips[strip]);
+        };
+
+        std::vector<std::thread> threads;
+        for(size_t i = 1 ; i < stripCount ; ++i) { threads.emplace_back(compressStrip, i); }
+        compressStrip(0);
+        for(std::thread& thread : threads) { thread.join(); }
+
+        for(const std::vector<unsigned char>& strip : strips) {
+            output.insert(output.end(), strip.begin(), strip.end());
+        }
+        history.insert(history.end(), data.begin(), data.end());
+    }
+
+    if(last) {
+        const uint32_t adler = (adlerB << 16) | adlerA;
+        for(int shift = 24 ; shift >= 0 ; shift -= 8) { output.push_back(adler >> shift); }
+    }
+
+    // Only the window is needed by the next parts
+    if(history.size() > windowSize) {
+        const size_t removed = history.size() - windowSize;
+        history.erase(history.begin(), history.begin() + removed);
+        historyStart += removed;
+    }
+}
+
+void Deflate::compressBlock(uint32_t start, bool last, std::vector<unsigned char>& output) {
+    const uint32_t partEnd = history.size();
+
+    // Block header: BFINAL, then BTYPE = 01 for the fixed Huffman codes
+    writeBits(last ? 1 : 0, 1, output);
+    writeBits(1, 2, output);
+
+    uint32_t index = start;
+    while(index < partEnd) {
+        const uint64_t position = historyStart + index;
+        insertUpTo(position);
+
+        const unsigned int maxLength = std::min(maxMatch, partEnd - index);
+        unsigned int bestLength = 0;
+        unsigned int bestDistance = 0;
+
+        if(maxLength >= minMatch) {
+            int64_t candidate = head[hash(index)];
+            for(unsigned int chain = 0 ; chain < maxChainLength && candidate >= 0 ; ++chain) {
+                if(position - candidate > windowSize) { break; }
+
+                const unsigned char* current = history.data() + index;
+                const unsigned char* match = history.data() + (candidate - historyStart);
+                if(match[bestLength] == current[bestLength]) {
+                    unsigned int length = 0;
+                    while(length < maxLength && match[length] == current[length]) { ++length; }
+
+                    if(length > bestLength) {
+                        bestLength = length;
+                        bestDistance = position - candidate;
+                        if(length == maxLength) { break; }
+                    }
+                }
+
+                // Entries of the chain can have been overwritten by more recent positions, which end it
+                const int64_t next = previous[candidate % windowSize];
+                if(next >= candidate) { break; }
+                candidate = next;
+            }
+        }
+
+        if(bestLength >= minMatch) {
+            writeMatch(bestLength, bestDistance, output);
+            index += bestLength;
+        } else {
+            writeSymbol(history[index], output);
+            ++index;
+        }
+    }
+
+    insertUpTo(historyStart + partEnd);
+    writeSymbol(256, output);
+}
+
+void Deflate::compressStrip(std::span<const unsigned char> dictionary, std::span<const unsigned char> strip, bool last,
+                            std::vector<unsigned char>& output) const {
+    Deflate stripDeflate(level);
+    stripDeflate.history.reserve(dictionary.size() + strip.size());
+    stripDeflate.history.assign(dictionary.begin(), dictionary.end());
+    stripDeflate.history.insert(stripDeflate.history.end(), strip.begin(), strip.end());
+
+    stripDeflate.compressBlock(dictionary.size(), last, output);
+    stripDeflate.alignToByte(last, output);
+}
+
+void Deflate::writeStored(std::span<const unsigned char> data, bool last, std::vector<unsigned char>& output) {
+    size_t offset = 0;
+    do {
+        const size_t size = std::min<size_t>(data.size() - offset, maxStoredSize);
+        const bool lastBlock = last && offset + size == data.size();
+        if(size == 0 && !lastBlock) { return; }
+
+        // Block header: BFINAL, then BTYPE = 00, the block starting on the next byte
+        writeBits(lastBlock ? 1 : 0, 1, output);
+        writeBits(0, 2, output);
+        if(bitCount > 0) { writeBits(0, 8 - bitCount, output); }
+
+        output.push_back(size & 0xFF);
+        output.push_back(size >> 8);
+        output.push_back(~size & 0xFF);
+        output.push_back((~size >> 8) & 0xFF);
+        output.insert(output.end(), data.begin() + offset, data.begin() + offset + size);
+        offset += size;
+    } while(offset < data.size());
+}
+
+void Deflate::alignToByte(bool last, std::vector<unsigned char>& output) {
+    if(!last) {
+        writeBits(0, 3, output);
+        if(bitCount > 0) { writeBits(0, 8 - bitCount, output); }
+
+        output.insert(output.end(), { 0x00, 0x00, 0xFF, 0xFF });
+    } else if(bitCount > 0) {
+        writeBits(0, 8 - bitCount, output);
+    }
+}
+
+void Deflate::writeBits(uint32_t value, unsigned int count, std::vector<unsigned char>& output) {
+    bitBuffer |= static_cast<uint64_t>(value) << bitCount;
+    bitCount += count;
+
+    while(bitCount >= 8) {
+        output.push_back(bitBuffer & 0xFF);
+        bitBuffer >>= 8;
+        bitCount -= 8;
+    }
+}
+
+void Deflate::writeSymbol(unsigned int symbol, std::vector<unsigned char>& output) {
+    writeBits(fixedCodes[symbol].bits, fixedCodes[symbol].length, output);
+}
+
+void Deflate::writeMatch(unsigned int length, unsigned int distance, std::vector<unsigned char>& output) {
+    const unsigned int lengthCode = std::upper_bound(lengthBases.begin(), lengthBases.end(), length)
+                                    - lengthBases.begin() - 1;
+    writeSymbol(257 + lengthCode, output);
+    writeBits(length - lengthBases[lengthCode], lengthExtraBits[lengthCode], output);
+
+    const unsigned int distanceCode = std::upper_bound(distanceBases.begin(), distanceBases.end(), distance)
+                                      - distanceBases.begin() - 1;
+    writeBits(reverseBits(distanceCode, 5), 5, output);
+    writeBits(distance - distanceBases[distanceCode], distanceExtraBits[distanceCode], output);
+}
+
+uint32_t Deflate::hash(uint32_t index) const {
+    const uint32_t bytes = history[index] << 16 | history[index + 1] << 8 | history[index + 2];
+    return (bytes * 2654435761u) >> (32 - hashBits);
+}
+
+void Deflate::insertUpTo(uint64_t position) {
+    const uint64_t end = historyStart + history.size();
+
+    for( ; insertedEnd < position && insertedEnd + minMatch <= end ; ++insertedEnd) {
+        const uint32_t sequenceHash = hash(insertedEnd - historyStart);
+        previous[insertedEnd % windowSize] = head[sequenceHash];
+        head[sequenceHash] = insertedEnd;
+    }
+}
@@ -0,0 +1,301 @@
+/***************************************************************************************************
+ * @file  ImageWriter.cpp
+ * @brief Implementation of the ImageWriter class
+ **************************************************************************************************/
+
+#include "ImageWriter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+/**
+ * @brief Computes the table of the CRC-32 of every byte, used by the PNG chunks.
+ * @return The table.
+ */
+static constexpr std::array<uint32_t, 256> computeCRCTable() {
+    std::array<uint32_t, 256> table{};
+    for(uint32_t i = 0 ; i < 256 ; ++i) {
+        uint32_t crc = i;
+        for(int bit = 0 ; bit < 8 ; ++bit) { crc = crc & 1 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1; }
+        table[i] = crc;
+    }
+
+    return table;
+}
+
+static constexpr std::array<uint32_t, 256> crcTable = computeCRCTable(); ///< The CRC-32 of every byte.
+
+/**
+ * @brief Continues the CRC-32 of some data.
+ * @param crc The CRC of the previous data, complemented.
+ * @param data The data.
+ * @param size The size of the data, in bytes.
+ * @return The CRC of the previous data and this data, complemented.
+ */
+static uint32_t updateCRC(uint32_t crc, const unsigned char* data, size_t size) {
+    for(size_t i = 0 ; i < size ; ++i) { crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8); }
+    return crc;
+}
+
+/**
+ * @brief Writes a 32-bit integer in big-endian order, as PNG files store them.
+ * @param file The file.
+ * @param value The integer.
+ */
+static void writeBigEndian(std::ofstream& file, uint32_t value) {
+    const char bytes[4]{ static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+                         static_cast<char>(value >> 8), static_cast<char>(value) };
+    file.write(bytes, 4);
+}
+
+/**
+ * @brief The Paeth predictor of the PNG filter 4: the neighbour closest to left + up - upLeft.
+ * @param left The byte on the left.
+ * @param up The byte above.
+ * @param upLeft The byte above on the left.
+ * @return The predicted byte.
+ */
+static unsigned char paeth(int left, int up, int upLeft) {
+    const int distanceLeft = std::abs(up - upLeft);
+    const int distanceUp = std::abs(left - upLeft);
+    const int distanceUpLeft = std::abs(left + up - 2 * upLeft);
+
+    if(distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft) { return left; }
+    if(distanceUp <= distanceUpLeft) { return up; }
+    return upLeft;
+}
+
+ImageWriter::ImageWriter(const std::string& path, unsigned int width, unsigned int height, unsigned int channels,
+                         unsigned int compressionLevel, unsigned int threadCount)
+    : path(path), width(width), height(height), channels(channels), format(getFormat(path)), rowsWritten(0),
+      deflate(compressionLevel, threadCount), qoiIndex{}, qoiPrevious{ 0, 0, 0, 255 }, qoiRun(0) {
+
+    if(width == 0 || height == 0) { throw std::invalid_argument("Cannot write an empty image."); }
+    if(channels != 1 && channels != 3 && channels != 4) {
+        throw std::invalid_argument("Images must have 1, 3 or 4 channels.");
+    }
+
+    file.open(path, std::ios::binary);
+    if(!file) { throw std::runtime_error("Couldn't open " + path + '.'); }
+
+    switch(format) {
+        case Format::PPM:
+            file << (channels == 1 ? "P5\n" : "P6\n") << width << ' ' << height << "\n255\n";
+            break;
+        case Format::QOI: {
+            // Magic, size, channels and an sRGB color space
+            file.write("qoif", 4);
+            writeBigEndian(file, width);
+            writeBigEndian(file, height);
+            const char description[2]{ static_cast<char>(channels == 4 ? 4 : 3), 0 };
+            file.write(description, 2);
+            break;
+        }
+        case Format::PNG: {
+            static const unsigned char signature[8]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+            file.write(reinterpret_cast<const char*>(signature), 8);
+
+            // 8 bits per channel, gray, RGB or RGBA, no interlacing
+            const unsigned char colorType = channels == 1 ? 0 : channels == 3 ? 2 : 6;
+            std::vector<unsigned char> header{
+                static_cast<unsigned char>(width >> 24), static_cast<unsigned char>(width >> 16),
+                static_cast<unsigned char>(width >> 8), static_cast<unsigned char>(width),
+                static_cast<unsigned char>(height >> 24), static_cast<unsigned char>(height >> 16),
+                static_cast<unsigned char>(height >> 8), static_cast<unsigned char>(height),
+                8, colorType, 0, 0, 0
+            };
+            writeChunk("IHDR", header);
+
+            previousRow.assign(channels * width, 0);
+            candidates.resize(5 * (channels * width + 1));
+            break;
+        }
+    }
+}
+
+ImageWriter::Format ImageWriter::getFormat(const std::string& path) {
+    if(path.ends_with(".ppm") || path.ends_with(".pgm")) { return Format::PPM; }
+    if(path.ends_with(".qoi")) { return Format::QOI; }
+    return Format::PNG;
+}
+
+const char* ImageWriter::getExtension(Format format) {
+    switch(format) {
+        case Format::PPM: return ".ppm";
+        case Format::QOI: return ".qoi";
+        default: return ".png";
+    }
+}
+
+void ImageWriter::write(const Image& image, const std::string& path, bool flipY, unsigned int compressionLevel) {
+    const unsigned int width = image.width();
+    const unsigned int height = image.height();
+
+    // The whole image is given at once so that it is compressed in as many strips as there are threads
+    std::vector<unsigned char> pixels(4 * image.size());
+    for(unsigned int y = 0 ; y < height ; ++y) {
+        unsigned char* row = pixels.data() + 4 * width * (flipY ? height - 1 - y : y);
+        for(unsigned int x = 0 ; x < width ; ++x) {
+            const Color pixel = image(x, y) * 255.0f;
+            row[4 * x] = std::clamp(pixel.r, 0.0f, 255.0f);
+            row[4 * x + 1] = std::clamp(pixel.g, 0.0f, 255.0f);
+            row[4 * x + 2] = std::clamp(pixel.b, 0.0f, 255.0f);
+            row[4 * x + 3] = std::clamp(pixel.a, 0.0f, 255.0f);
+        }
+    }
+
+    ImageWriter writer(path, width, height, 4, compressionLevel);
+    writer.writeRows(pixels.data(), height);
+    writer.close();
+}
+
+void ImageWriter::writeRows(const unsigned char* pixels, unsigned int rowCount) {
+    if(rowCount > height - rowsWritten) { throw std::out_of_range("Too many rows written to " + path + '.'); }
+
+    const unsigned int rowSize = channels * width;
+    encoded.clear();
+
+    switch(format) {
+        case Format::PPM:
+            if(channels != 4) {
+                file.write(reinterpret_cast<const char*>(pixels), static_cast<std::streamsize>(rowSize) * rowCount);
+                break;
+            }
+
+            encoded.resize(3 * width * rowCount);
+            for(unsigned int i = 0 ; i < width * rowCount ; ++i) {
+                encoded[3 * i] = pixels[4 * i];
+                encoded[3 * i + 1] = pixels[4 * i + 1];
+                encoded[3 * i + 2] = pixels[4 * i + 2];
+            }
+            file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+            break;
+        case Format::QOI:
+            for(unsigned int y = 0 ; y < rowCount ; ++y) { encodeQOIRow(pixels + rowSize * y); }
+            if(rowsWritten + rowCount == height) {
+                if(qoiRun > 0) { encoded.push_back(0xC0 | (qoiRun - 1)); }
+                encoded.insert(encoded.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+            }
+            file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+            break;
+        case Format::PNG:
+            filtered.clear();
+            for(unsigned int y = 0 ; y < rowCount ; ++y) { filterRow(pixels + rowSize * y); }
+
+            deflate.compress(filtered, rowsWritten + rowCount == height, encoded);
+            if(!encoded.empty()) { writeChunk("IDAT", encoded); }
+            break;
+    }
+
+    rowsWritten += rowCount;
+}
+
+void ImageWriter::close() {
+    if(!file.is_open()) { return; }
+
+    if(rowsWritten != height) { throw std::runtime_error("The image " + path + " is incomplete."); }
+    if(format == Format::PNG) { writeChunk("IEND", {}); }
+
+    file.close();
+    if(!file) { throw std::runtime_error("Couldn't write " + path + '.'); }
+}
+
+void ImageWriter::writeChunk(const char* type, const std::vector<unsigned char>& data) {
+    writeBigEndian(file, data.size());
+    file.write(type, 4);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    uint32_t crc = updateCRC(0xFFFFFFFF, reinterpret_cast<const unsigned char*>(type), 4);
+    crc = updateCRC(crc, data.data(), data.size());
+    writeBigEndian(file, crc ^ 0xFFFFFFFF);
+}
+
+void ImageWriter::filterRow(const unsigned char* row) {
+    const unsigned int size = channels * width;
+    const unsigned char* up = previousRow.data();
+
+    // Filters 0 to 4: none, sub, up, average and Paeth, computed in a single pass, the first pixel having zeros on its
+    // left
+    unsigned char* candidate[5];
+    unsigned long sums[5]{};
+    for(unsigned int filter = 0 ; filter < 5 ; ++filter) {
+        candidate[filter] = candidates.data() + filter * (size + 1);
+        candidate[filter][0] = filter;
+    }
+
+    const auto filterByte = [&](unsigned int i, unsigned char left, unsigned char upLeft) {
+        const unsigned char predictions[5]{ 0, left, up[i], static_cast<unsigned char>((left + up[i]) / 2),
+                                            paeth(left, up[i], upLeft) };
+        for(unsigned int filter = 0 ; filter < 5 ; ++filter) {
+            const unsigned char value = row[i] - predictions[filter];
+            candidate[filter][i + 1] = value;
+            sums[filter] += std::abs(static_cast<signed char>(value));
+        }
+    };
+
+    for(unsigned int i = 0 ; i < channels ; ++i) { filterByte(i, 0, 0); }
+    for(unsigned int i = channels ; i < size ; ++i) { filterByte(i, row[i - channels], up[i - channels]); }
+
+    const unsigned int bestFilter = std::min_element(sums, sums + 5) - sums;
+    const unsigned char* best = candidates.data() + bestFilter * (size + 1);
+    filtered.insert(filtered.end(), best, best + size + 1);
+    std::copy(row, row + size, previousRow.begin());
+}
+
+void ImageWriter::encodeQOIRow(const unsigned char* row) {
+    for(unsigned int x = 0 ; x < width ; ++x) {
+        const unsigned char* channel = row + channels * x;
+        const std::array<unsigned char, 4> pixel = channels == 1
+            ? std::array<unsigned char, 4>{ channel[0], channel[0], channel[0], 255 }
+            : std::array<unsigned char, 4>{ channel[0], channel[1], channel[2],
+                                            static_cast<unsigned char>(channels == 4 ? channel[3] : 255) };
+
+        if(pixel == qoiPrevious) {
+            // QOI_OP_RUN, of at most 62 pixels
+            if(++qoiRun == 62) {
+                encoded.push_back(0xC0 | (qoiRun - 1));
+                qoiRun = 0;
+            }
+            continue;
+        }
+
+        if(qoiRun > 0) {
+            encoded.push_back(0xC0 | (qoiRun - 1));
+            qoiRun = 0;
+        }
+
+        const unsigned int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+        if(qoiIndex[hash] == pixel) {
+            // QOI_OP_INDEX
+            encoded.push_back(hash);
+        } else if(pixel[3] == qoiPrevious[3]) {
+            const signed char red = pixel[0] - qoiPrevious[0];
+            const signed char green = pixel[1] - qoiPrevious[1];
+            const signed char blue = pixel[2] - qoiPrevious[2];
+            const signed char redGreen = red - green;
+            const signed char blueGreen = blue - green;
+
+            if(red >= -2 && red <= 1 && green >= -2 && green <= 1 && blue >= -2 && blue <= 1) {
+                // QOI_OP_DIFF
+                encoded.push_back(0x40 | (red + 2) << 4 | (green + 2) << 2 | (blue + 2));
+            } else if(green >= -32 && green <= 31 && redGreen >= -8 && redGreen <= 7 && blueGreen >= -8
+                      && blueGreen <= 7) {
+                // QOI_OP_LUMA
+                encoded.push_back(0x80 | (green + 32));
+                encoded.push_back((redGreen + 8) << 4 | (blueGreen + 8));
+            } else {
+                // QOI_OP_RGB
+                encoded.insert(encoded.end(), { 0xFE, pixel[0], pixel[1], pixel[2] });
+            }
+        } else {
+            // QOI_OP_RGBA
+            encoded.insert(encoded.end(), { 0xFF, pixel[0], pixel[1], pixel[2], pixel[3] });
+        }
+
+        qoiIndex[hash] = pixel;
+        qoiPrevious = pixel;
+    }
+}
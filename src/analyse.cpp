@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include "Array2D.hpp"
 #include "image_io.h"
+#include "ImageWriter.hpp"
 #include "utility.hpp"
 #include "analyse/Hull.hpp"
 #include "analyse/MathematicalMorphology.hpp"
@@ -174,7 +175,7 @@ int main() {
         }
     }
 
-    write_image_png(srgb(labels_img), "data/analyse/labels.png", false);
+    ImageWriter::write(srgb(labels_img), "data/analyse/labels.png", false);
 
     /* ---- Outline of pieces ---- */
     Array2D<bool> outline(width, height, false);
@@ -268,10 +269,10 @@ int main() {
 
         std::string strNum = (num_piece < 10) ? '0' + std::to_string(num_piece) : std::to_string(num_piece);
 
-        write_image_png(srgb(piece), ("data/analyse/pieces/piece-" + strNum + ".png").c_str(), false);
-        write_image_png(srgb(piece_mask), ("data/analyse/piece-masks/piece-mask-" + strNum + ".png").c_str(), false);
-        write_image_png(srgb(piece_outline), ("data/analyse/piece-outlines/piece-outlines-" + strNum + ".png").c_str(), false);
-        write_image_png(srgb(piece_hull), ("data/analyse/piece-hull/piece-hull-" + strNum + ".png").c_str(), false);
+        ImageWriter::write(srgb(piece), "data/analyse/pieces/piece-" + strNum + ".png", false);
+        ImageWriter::write(srgb(piece_mask), "data/analyse/piece-masks/piece-mask-" + strNum + ".png", false);
+        ImageWriter::write(srgb(piece_outline), "data/analyse/piece-outlines/piece-outlines-" + strNum + ".png", false);
+        ImageWriter::write(srgb(piece_hull), "data/analyse/piece-hull/piece-hull-" + strNum + ".png", false);
 
         ++num_piece;
     }
@@ -5,120 +5,1247 @@
 
 #include "synthese/BVH.hpp"
 
-bool BVH::Node::intersect(const Ray& ray) const {
-    float tx1 = (pmin.x - ray.origin.x) / ray.direction.x, tx2 = (pmax.x - ray.origin.x) / ray.direction.x;
-    float ty1 = (pmin.y - ray.origin.y) / ray.direction.y, ty2 = (pmax.y - ray.origin.y) / ray.direction.y;
-    float tz1 = (pmin.z - ray.origin.z) / ray.direction.z, tz2 = (pmax.z - ray.origin.z) / ray.direction.z;
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <stdexcept>
+#include "synthese/Statistics.hpp"
+#include "utility.hpp"
 
-    float tmin = std::min(tx1, tx2), tmax = std::max(tx1, tx2);
-    tmin = std::max(tmin, std::min(ty1, ty2)), tmax = std::min(tmax, std::max(ty1, ty2));
-    tmin = std::max(tmin, std::min(tz1, tz2)), tmax = std::min(tmax, std::max(tz1, tz2));
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
 
-    return tmax >= tmin && tmin < infinity && tmax > 0;
+/**
+ * @brief Tests the bounding boxes of all the children of a wide node against a ray at once, 4 or 8 lanes at a time. The
+ * near and far bounds of each axis are chosen with the ray's signs, so each slab costs a subtraction and a
+ * multiplication per bound.
+ * @tparam Width The maximum amount of children of the node.
+ * @param node The wide node.
+ * @param ray The ray.
+ * @param tMax The distance after which intersections are ignored, in addition to the ray's own tMax.
+ * @param distances Will store the entry distance of each child.
+ * @return A mask with the bit of each child hit in the ray's interval set.
+ */
+template<uint Width>
+static uint intersectChildren(const BVH::WideNode<Width>& node, const Ray& ray, float tMax, float* distances) {
+    const float* nearX = ray.sign[0] ? node.maxX : node.minX;
+    const float* nearY = ray.sign[1] ? node.maxY : node.minY;
+    const float* nearZ = ray.sign[2] ? node.maxZ : node.minZ;
+    const float* farX = ray.sign[0] ? node.minX : node.maxX;
+    const float* farY = ray.sign[1] ? node.minY : node.maxY;
+    const float* farZ = ray.sign[2] ? node.minZ : node.maxZ;
+    const float rayMin = ray.tMin;
+    const float rayMax = std::min(ray.tMax, tMax);
+
+    uint mask = 0;
+
+#if defined(__AVX__)
+    if constexpr(Width % 8 == 0) {
+        const __m256 ox = _mm256_set1_ps(ray.origin.x);
+        const __m256 oy = _mm256_set1_ps(ray.origin.y);
+        const __m256 oz = _mm256_set1_ps(ray.origin.z);
+        const __m256 ix = _mm256_set1_ps(ray.inverseDirection.x);
+        const __m256 iy = _mm256_set1_ps(ray.inverseDirection.y);
+        const __m256 iz = _mm256_set1_ps(ray.inverseDirection.z);
+        const __m256 near = _mm256_set1_ps(rayMin), far = _mm256_set1_ps(rayMax);
+
+        for(uint i = 0 ; i < Width ; i += 8) {
+            __m256 tmin = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nearX + i), ox), ix), near);
+            tmin = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nearY + i), oy), iy), tmin);
+            tmin = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nearZ + i), oz), iz), tmin);
+            __m256 tmax = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(farX + i), ox), ix), far);
+            tmax = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(farY + i), oy), iy), tmax);
+            tmax = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(farZ + i), oz), iz), tmax);
+
+            _mm256_storeu_ps(distances + i, tmin);
+            mask |= _mm256_movemask_ps(_mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ)) << i;
+        }
+
+        return mask & ((1u << node.childCount) - 1);
+    }
+#endif
+
+#if defined(__SSE__)
+    const __m128 ox = _mm_set1_ps(ray.origin.x), oy = _mm_set1_ps(ray.origin.y), oz = _mm_set1_ps(ray.origin.z);
+    const __m128 ix = _mm_set1_ps(ray.inverseDirection.x);
+    const __m128 iy = _mm_set1_ps(ray.inverseDirection.y);
+    const __m128 iz = _mm_set1_ps(ray.inverseDirection.z);
+    const __m128 near = _mm_set1_ps(rayMin), far = _mm_set1_ps(rayMax);
+
+    for(uint i = 0 ; i < Width ; i += 4) {
+        __m128 tmin = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearX + i), ox), ix), near);
+        tmin = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearY + i), oy), iy), tmin);
+        tmin = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearZ + i), oz), iz), tmin);
+        __m128 tmax = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farX + i), ox), ix), far);
+        tmax = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farY + i), oy), iy), tmax);
+        tmax = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farZ + i), oz), iz), tmax);
+
+        _mm_storeu_ps(distances + i, tmin);
+        mask |= _mm_movemask_ps(_mm_cmple_ps(tmin, tmax)) << i;
+    }
+#else
+    for(uint i = 0 ; i < Width ; ++i) {
+        float tmin = std::max(rayMin, (nearX[i] - ray.origin.x) * ray.inverseDirection.x);
+        tmin = std::max(tmin, (nearY[i] - ray.origin.y) * ray.inverseDirection.y);
+        tmin = std::max(tmin, (nearZ[i] - ray.origin.z) * ray.inverseDirection.z);
+        float tmax = std::min(rayMax, (farX[i] - ray.origin.x) * ray.inverseDirection.x);
+        tmax = std::min(tmax, (farY[i] - ray.origin.y) * ray.inverseDirection.y);
+        tmax = std::min(tmax, (farZ[i] - ray.origin.z) * ray.inverseDirection.z);
+
+        distances[i] = tmin;
+        if(tmin <= tmax) { mask |= 1u << i; }
+    }
+#endif
+
+    return mask & ((1u << node.childCount) - 1);
+}
+
+/**
+ * @struct RayPacket
+ * @brief The rays of a packet stored as a structure of arrays, padded to a multiple of 4 rays that never hit anything.
+ */
+struct RayPacket {
+    alignas(16) float originX[BVH::maxPacketSize];           ///< The x coordinate of each ray's origin.
+    alignas(16) float originY[BVH::maxPacketSize];           ///< The y coordinate of each ray's origin.
+    alignas(16) float originZ[BVH::maxPacketSize];           ///< The z coordinate of each ray's origin.
+    alignas(16) float inverseDirectionX[BVH::maxPacketSize]; ///< The inverse of the x coordinate of each direction.
+    alignas(16) float inverseDirectionY[BVH::maxPacketSize]; ///< The inverse of the y coordinate of each direction.
+    alignas(16) float inverseDirectionZ[BVH::maxPacketSize]; ///< The inverse of the z coordinate of each direction.
+    alignas(16) float tMin[BVH::maxPacketSize];              ///< The start of each ray's interval.
+    alignas(16) float tMax[BVH::maxPacketSize];              ///< The distance of each ray's closest hit so far.
+    uint paddedCount;                                         ///< The amount of rays rounded up to a multiple of 4.
+};
+
+/**
+ * @brief Tests the bounding box of a node against some rays of a packet, 4 rays at a time.
+ * @param node The node.
+ * @param packet The packet.
+ * @param mask The rays to test, one bit per ray.
+ * @param nearest Will store the smallest entry distance among the rays that hit the node.
+ * @return A mask with the bit of each tested ray that enters the node before its closest hit set.
+ */
+static uint64_t intersectPacket(const BVH::Node& node, const RayPacket& packet, uint64_t mask, float& nearest) {
+    alignas(16) float distances[BVH::maxPacketSize];
+    uint64_t hitMask = 0;
+
+#if defined(__SSE__)
+    const __m128 minX = _mm_set1_ps(node.pmin.x), minY = _mm_set1_ps(node.pmin.y), minZ = _mm_set1_ps(node.pmin.z);
+    const __m128 maxX = _mm_set1_ps(node.pmax.x), maxY = _mm_set1_ps(node.pmax.y), maxZ = _mm_set1_ps(node.pmax.z);
+    for(uint i = 0 ; i < packet.paddedCount ; i += 4) {
+        if(((mask >> i) & 0xF) == 0) { continue; }
+
+        const __m128 ox = _mm_load_ps(packet.originX + i), ix = _mm_load_ps(packet.inverseDirectionX + i);
+        const __m128 oy = _mm_load_ps(packet.originY + i), iy = _mm_load_ps(packet.inverseDirectionY + i);
+        const __m128 oz = _mm_load_ps(packet.originZ + i), iz = _mm_load_ps(packet.inverseDirectionZ + i);
+
+        __m128 tx1 = _mm_mul_ps(_mm_sub_ps(minX, ox), ix), tx2 = _mm_mul_ps(_mm_sub_ps(maxX, ox), ix);
+        __m128 ty1 = _mm_mul_ps(_mm_sub_ps(minY, oy), iy), ty2 = _mm_mul_ps(_mm_sub_ps(maxY, oy), iy);
+        __m128 tz1 = _mm_mul_ps(_mm_sub_ps(minZ, oz), iz), tz2 = _mm_mul_ps(_mm_sub_ps(maxZ, oz), iz);
+
+        __m128 tmin = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)),
+                                 _mm_max_ps(_mm_min_ps(tz1, tz2), _mm_load_ps(packet.tMin + i)));
+        __m128 tmax = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)),
+                                 _mm_min_ps(_mm_max_ps(tz1, tz2), _mm_load_ps(packet.tMax + i)));
+
+        _mm_store_ps(distances + i, tmin);
+        hitMask |= static_cast<uint64_t>(_mm_movemask_ps(_mm_cmple_ps(tmin, tmax))) << i;
+    }
+#else
+    for(uint i = 0 ; i < packet.paddedCount ; ++i) {
+        const float ox = packet.originX[i], ix = packet.inverseDirectionX[i];
+        const float oy = packet.originY[i], iy = packet.inverseDirectionY[i];
+        const float oz = packet.originZ[i], iz = packet.inverseDirectionZ[i];
+
+        float tx1 = (node.pmin.x - ox) * ix, tx2 = (node.pmax.x - ox) * ix;
+        float ty1 = (node.pmin.y - oy) * iy, ty2 = (node.pmax.y - oy) * iy;
+        float tz1 = (node.pmin.z - oz) * iz, tz2 = (node.pmax.z - oz) * iz;
+
+        float tmin = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)),
+                              std::max(std::min(tz1, tz2), packet.tMin[i]));
+        float tmax = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)),
+                              std::min(std::max(tz1, tz2), packet.tMax[i]));
+
+        distances[i] = tmin;
+        if(tmin <= tmax) { hitMask |= uint64_t(1) << i; }
+    }
+#endif
+
+    hitMask &= mask;
+
+    nearest = infinity;
+    for(uint64_t bits = hitMask ; bits != 0 ; bits &= bits - 1) {
+        nearest = std::min(nearest, distances[std::countr_zero(bits)]);
+    }
+
+    return hitMask;
+}
+
+float BVH::Node::intersect(const Ray& ray, float tMax) const {
+    // The ray's inverse direction is always finite, so none of the distances can be NaN
+    const Point& nearBounds = ray.sign[0] ? pmax : pmin;
+    const Point& farBounds = ray.sign[0] ? pmin : pmax;
+    float tmin = std::max(ray.tMin, (nearBounds.x - ray.origin.x) * ray.inverseDirection.x);
+    float tmax = std::min(std::min(ray.tMax, tMax), (farBounds.x - ray.origin.x) * ray.inverseDirection.x);
+    tmin = std::max(tmin, ((ray.sign[1] ? pmax : pmin).y - ray.origin.y) * ray.inverseDirection.y);
+    tmax = std::min(tmax, ((ray.sign[1] ? pmin : pmax).y - ray.origin.y) * ray.inverseDirection.y);
+    tmin = std::max(tmin, ((ray.sign[2] ? pmax : pmin).z - ray.origin.z) * ray.inverseDirection.z);
+    tmax = std::min(tmax, ((ray.sign[2] ? pmin : pmax).z - ray.origin.z) * ray.inverseDirection.z);
+
+    return tmin <= tmax ? tmin : infinity;
+}
+
+/**
+ * @brief Calculates the surface area of a bounding box.
+ * @param pmin The lower bound of the bounding box.
+ * @param pmax The higher bound of the bounding box.
+ * @return The surface area.
+ */
+static float getBoxArea(const Point& pmin, const Point& pmax) {
+    Vector extent = pmax - pmin;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+float BVH::Node::getSurfaceArea() const {
+    return getBoxArea(pmin, pmax);
 }
 
-BVH::BVH(std::vector<const Object*>& objects): objects(objects), usedNodes(1), rootIndex(0) { }
+BVH::BVH(const Primitives& primitives)
+    : primitives(primitives), primitiveCount(0), usedNodes(1), rootIndex(0),
+      buildMethod(BuildMethod::SAH), layout(Layout::Binary), threadPool(nullptr) { }
 
-void BVH::initialize() {
-    objectIndices.clear();
+void BVH::initialize(ThreadPool* threadPool) {
+    primitiveIndices.clear();
     nodes.clear();
+    nodes4.clear();
+    nodes8.clear();
+    centroids.clear();
     usedNodes = 1;
     rootIndex = 0;
 
-    if(objects.empty()) { return; }
+    primitiveCount = primitives.getPrimitiveCount();
+    if(primitiveCount == 0) { return; }
+
+    this->threadPool = threadPool;
+
+    primitiveIndices.resize(primitiveCount);
+    centroids.resize(primitiveCount);
+    parallelFor(primitiveCount, [this](uint, uint first, uint last) {
+        for(uint i = first ; i < last ; ++i) {
+            primitiveIndices[i] = i;
+            centroids[i] = primitives.getCentroid(i);
+        }
+    });
+
+    nodes.resize(primitiveCount * 2 - 1);
+
+    if(buildMethod == BuildMethod::LBVH || buildMethod == BuildMethod::TRBVH) {
+        buildLinear();
+    } else {
+        Node& root = nodes[rootIndex];
+        root.left = 0;
+        root.firstPrimitiveIndex = 0;
+        root.primitiveCount = primitiveCount;
+        updateBounds(rootIndex);
+        subdivide(rootIndex, 0);
+    }
+
+    nodes.resize(usedNodes);
+    centroids.clear();
+    this->threadPool = nullptr;
+
+    collapse();
+}
+
+void BVH::load(std::span<const Node> nodes, std::span<const uint> primitiveIndices) {
+    primitiveCount = primitives.getPrimitiveCount();
+    if(primitiveIndices.size() != primitiveCount || nodes.empty() != (primitiveCount == 0)) {
+        throw std::invalid_argument("The BVH doesn't match its primitives.");
+    }
+
+    this->nodes.assign(nodes.begin(), nodes.end());
+    this->primitiveIndices.assign(primitiveIndices.begin(), primitiveIndices.end());
+    usedNodes = nodes.size();
+    rootIndex = 0;
+
+    collapse();
+}
+
+void BVH::refit(ThreadPool* threadPool) {
+    if(primitives.getPrimitiveCount() != primitiveCount) {
+        throw std::invalid_argument("The BVH doesn't match its primitives.");
+    }
+    if(nodes.empty()) { return; }
+
+    this->threadPool = threadPool;
+
+    const uint nodeCount = nodes.size();
+    std::vector<uint> parents(nodeCount);
+    parents[rootIndex] = -1u;
+    parallelFor(nodeCount, [this, &parents](uint, uint first, uint last) {
+        for(uint i = first ; i < last ; ++i) {
+            if(!nodes[i].isLeaf()) { parents[nodes[i].left] = parents[nodes[i].left + 1] = i; }
+        }
+    });
+
+    // The first child to reach an inner node stops, the second one goes on with its parent once both are refitted
+    std::vector<uint> visits(nodeCount, 0);
+    parallelFor(nodeCount, [this, &parents, &visits](uint, uint first, uint last) {
+        for(uint i = first ; i < last ; ++i) {
+            Node& leaf = nodes[i];
+            if(!leaf.isLeaf()) { continue; }
+
+            leaf.pmin = Point(infinity, infinity, infinity);
+            leaf.pmax = Point(-infinity, -infinity, -infinity);
+            for(uint j = 0 ; j < leaf.primitiveCount ; ++j) {
+                primitives.compareBoundingBox(primitiveIndices[leaf.firstPrimitiveIndex + j], leaf.pmin, leaf.pmax);
+            }
+
+            for(uint index = parents[i] ; index != -1u ; index = parents[index]) {
+                if(std::atomic_ref<uint>(visits[index]).fetch_add(1, std::memory_order_acq_rel) == 0) { break; }
+
+                Node& node = nodes[index];
+                node.pmin = min3(nodes[node.left].pmin, nodes[node.left + 1].pmin);
+                node.pmax = max3(nodes[node.left].pmax, nodes[node.left + 1].pmax);
+            }
+        }
+    });
+
+    this->threadPool = nullptr;
+
+    collapse();
+}
+
+bool BVH::isBuilt() const {
+    return !nodes.empty();
+}
+
+void BVH::setBuildMethod(BuildMethod method) {
+    buildMethod = method;
+}
+
+BVH::BuildMethod BVH::getBuildMethod() const {
+    return buildMethod;
+}
+
+void BVH::setLayout(Layout layout) {
+    if(layout == this->layout) { return; }
+
+    this->layout = layout;
+    collapse();
+}
+
+BVH::Layout BVH::getLayout() const {
+    return layout;
+}
+
+uint BVH::getNodeCount() const {
+    if(primitiveCount == 0) { return 0; }
+
+    switch(layout) {
+        case Layout::Wide4: return nodes4.size();
+        case Layout::Wide8: return nodes8.size();
+        default: return usedNodes;
+    }
+}
+
+std::span<const BVH::Node> BVH::getNodes() const {
+    return nodes;
+}
+
+std::span<const uint> BVH::getPrimitiveIndices() const {
+    return primitiveIndices;
+}
+
+float BVH::getSAHCost() const {
+    if(nodes.empty()) { return 0.0f; }
 
-    for(uint i = 0 ; i < objects.size() ; ++i) { objectIndices.push_back(i); }
+    float rootArea = nodes[rootIndex].getSurfaceArea();
+    if(rootArea <= 0.0f) { return 0.0f; }
 
-    nodes.reserve(objects.size() * 2 - 1);
+    float cost = 0.0f;
+    for(uint i = 0 ; i < usedNodes ; ++i) {
+        const Node& node = nodes[i];
+        float probability = node.getSurfaceArea() / rootArea;
+        cost += probability * (node.isLeaf() ? intersectionCost * node.primitiveCount : traversalCost);
+    }
+
+    return cost;
+}
+
+bool BVH::getBounds(Point& pmin, Point& pmax) const {
+    if(nodes.empty()) { return false; }
+
+    pmin = nodes[rootIndex].pmin;
+    pmax = nodes[rootIndex].pmax;
 
-    Node& root = nodes[rootIndex];
-    root.left = 0;
-    root.firstObjectIndex = 0;
-    root.objectCount = objects.size();
-    updateBounds(rootIndex);
-    subdivide(rootIndex);
+    return true;
 }
 
 Hit BVH::intersect(const Ray& ray) const {
-    if(objects.empty()) { return Hit(); }
+    Hit closest;
+    intersect(ray, closest);
 
-    return intersect(ray, rootIndex);
+    return closest;
 }
 
-Hit BVH::intersect(const Ray& ray, uint nodeIndex) const {
-    const Node& node = nodes[nodeIndex];
-    if(!node.intersect(ray)) { return Hit(); }
+void BVH::intersect(const Ray& ray, Hit& closest) const {
+    if(layout == Layout::Wide4 && !nodes4.empty()) {
+        intersect(ray, closest, nodes4);
+    } else if(layout == Layout::Wide8 && !nodes8.empty()) {
+        intersect(ray, closest, nodes8);
+    } else if(primitiveCount > 0 && nodes[rootIndex].intersect(ray, closest.intersection) < closest.intersection) {
+        intersect(ray, rootIndex, closest);
+    }
+}
+
+void BVH::intersect(const Ray* rays, uint count, Hit* closest) const {
+    if(primitiveCount == 0) { return; }
+
+    if(count < minPacketRayCount) {
+        for(uint i = 0 ; i < count ; ++i) { intersect(rays[i], closest[i]); }
+        return;
+    }
+
+    RayPacket packet;
+    packet.paddedCount = (count + 3) & ~3u;
+    for(uint i = 0 ; i < packet.paddedCount ; ++i) {
+        const Ray& ray = rays[std::min(i, count - 1)];
+        packet.originX[i] = ray.origin.x;
+        packet.originY[i] = ray.origin.y;
+        packet.originZ[i] = ray.origin.z;
+        packet.inverseDirectionX[i] = ray.inverseDirection.x;
+        packet.inverseDirectionY[i] = ray.inverseDirection.y;
+        packet.inverseDirectionZ[i] = ray.inverseDirection.z;
+        packet.tMin[i] = ray.tMin;
+        packet.tMax[i] = i < count ? std::min(closest[i].intersection, ray.tMax) : -infinity;
+    }
+
+    // Every entry is a node that still needs to be visited, the rays that hit it and the nearest of their distances
+    struct StackEntry {
+        uint nodeIndex;
+        uint64_t mask;
+        float distance;
+    } stack[maxDepth];
+    uint stackSize = 0;
 
-    if(node.isLeaf()) {
-        Hit closest;
+    float distance;
+    uint64_t mask = intersectPacket(nodes[rootIndex], packet, count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1,
+                                    distance);
+    uint nodeIndex = rootIndex;
+    while(mask != 0) {
+        const Node& node = nodes[nodeIndex];
+
+        if(static_cast<uint>(std::popcount(mask)) < minPacketRayCount) {
+            for(; mask != 0 ; mask &= mask - 1) {
+                uint i = std::countr_zero(mask);
+                intersect(rays[i], nodeIndex, closest[i]);
+                packet.tMax[i] = closest[i].intersection;
+            }
+        } else if(node.isLeaf()) {
+            SYNTHESE_COUNT(nodesVisited, std::popcount(mask));
+            primitives.intersect(&primitiveIndices[node.firstPrimitiveIndex], node.primitiveCount, rays, mask, closest);
+            for(; mask != 0 ; mask &= mask - 1) {
+                uint i = std::countr_zero(mask);
+                packet.tMax[i] = closest[i].intersection;
+            }
+        } else {
+            SYNTHESE_COUNT(nodesVisited, std::popcount(mask));
 
-        for(uint i = 0 ; i < node.objectCount ; i++) {
-            const Object* object = objects.at(objectIndices.at(node.firstObjectIndex + i));
-            Hit hit = object->intersect(ray);
+            uint nearIndex = node.left;
+            uint farIndex = node.left + 1;
+            float nearDistance, farDistance;
+            uint64_t nearMask = intersectPacket(nodes[nearIndex], packet, mask, nearDistance);
+            uint64_t farMask = intersectPacket(nodes[farIndex], packet, mask, farDistance);
 
-            if(hit.intersection != infinity && (closest.object == nullptr || hit.intersection < closest.intersection)) {
-                closest.intersection = hit.intersection;
-                closest.normal = hit.normal;
-                closest.object = object;
+            if(farDistance < nearDistance) {
+                std::swap(nearIndex, farIndex);
+                std::swap(nearMask, farMask);
+                std::swap(nearDistance, farDistance);
             }
+
+            if(farMask != 0) { stack[stackSize++] = { farIndex, farMask, farDistance }; }
+            nodeIndex = nearIndex;
+            mask = nearMask;
+            if(mask != 0) { continue; }
         }
 
-        return closest;
-    } else {
-        Hit hit1 = intersect(ray, node.left);
-        Hit hit2 = intersect(ray, node.left + 1);
+        // Pops the next node, dropping the rays whose closest hit was found before they enter it
+        while(mask == 0 && stackSize > 0) {
+            const StackEntry& entry = stack[--stackSize];
+            nodeIndex = entry.nodeIndex;
+            mask = entry.mask;
+            for(uint64_t bits = mask ; bits != 0 ; bits &= bits - 1) {
+                uint i = std::countr_zero(bits);
+                if(entry.distance >= packet.tMax[i]) { mask &= ~(uint64_t(1) << i); }
+            }
+        }
+    }
+}
+
+void BVH::intersect(const Ray& ray, uint nodeIndex, Hit& closest) const {
+    // Every entry is a node that still needs to be visited and the distance at which the ray enters it
+    struct StackEntry {
+        uint nodeIndex;
+        float distance;
+    } stack[maxDepth];
+    uint stackSize = 0;
+
+    const Node* node = &nodes[nodeIndex];
+    while(true) {
+        SYNTHESE_COUNT(nodesVisited, 1);
+
+        if(node->isLeaf()) {
+            primitives.intersect(&primitiveIndices[node->firstPrimitiveIndex], node->primitiveCount, ray, closest);
+        } else {
+            uint nearIndex = node->left;
+            uint farIndex = node->left + 1;
+            float nearDistance = nodes[nearIndex].intersect(ray, closest.intersection);
+            float farDistance = nodes[farIndex].intersect(ray, closest.intersection);
+
+            if(farDistance < nearDistance) {
+                std::swap(nearIndex, farIndex);
+                std::swap(nearDistance, farDistance);
+            }
+
+            if(nearDistance < closest.intersection) {
+                if(farDistance < closest.intersection) { stack[stackSize++] = { farIndex, farDistance }; }
 
-        return hit1.intersection < hit2.intersection ? hit1 : hit2;
+                node = &nodes[nearIndex];
+                continue;
+            }
+        }
+
+        // Pops the next node, skipping the ones that are entered after the closest hit found since they were pushed
+        do {
+            if(stackSize == 0) { return; }
+            --stackSize;
+        } while(stack[stackSize].distance >= closest.intersection);
+
+        node = &nodes[stack[stackSize].nodeIndex];
     }
 }
 
-void BVH::updateBounds(uint nodeIndex) {
-    Node& node = nodes[nodeIndex];
-    node.pmin.x = node.pmin.y = node.pmin.z = infinity;
-    node.pmax.x = node.pmax.y = node.pmax.z = -infinity;
-    for(uint i = 0 ; i < node.objectCount ; ++i) {
-        objects.at(objectIndices.at(node.firstObjectIndex + i))->compareBoundingBox(node.pmin, node.pmax);
+bool BVH::occluded(const Ray& ray, float tMax) const {
+    if(layout == Layout::Wide4 && !nodes4.empty()) { return occluded(ray, tMax, nodes4); }
+    if(layout == Layout::Wide8 && !nodes8.empty()) { return occluded(ray, tMax, nodes8); }
+
+    if(primitiveCount == 0 || nodes[rootIndex].intersect(ray, tMax) == infinity) { return false; }
+
+    uint stack[maxDepth];
+    uint stackSize = 0;
+
+    const Node* node = &nodes[rootIndex];
+    while(true) {
+        SYNTHESE_COUNT(nodesVisited, 1);
+
+        if(node->isLeaf()) {
+            if(primitives.occluded(&primitiveIndices[node->firstPrimitiveIndex], node->primitiveCount, ray, tMax)) {
+                return true;
+            }
+        } else {
+            bool hitLeft = nodes[node->left].intersect(ray, tMax) != infinity;
+            bool hitRight = nodes[node->left + 1].intersect(ray, tMax) != infinity;
+
+            if(hitLeft || hitRight) {
+                if(hitLeft && hitRight) { stack[stackSize++] = node->left + 1; }
+
+                node = &nodes[hitLeft ? node->left : node->left + 1];
+                continue;
+            }
+        }
+
+        if(stackSize == 0) { return false; }
+        node = &nodes[stack[--stackSize]];
+    }
+}
+
+template<uint Width>
+void BVH::intersect(const Ray& ray, Hit& closest, const std::vector<WideNode<Width>>& wideNodes) const {
+    struct StackEntry {
+        uint nodeIndex;
+        float distance;
+    } stack[maxDepth * (Width - 1) + 1];
+    uint stackSize = 0;
+
+    alignas(32) float distances[Width];
+
+    stack[stackSize++] = { 0, ray.tMin };
+    while(stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        if(entry.distance >= closest.intersection) { continue; }
+
+        SYNTHESE_COUNT(nodesVisited, 1);
+        const WideNode<Width>& node = wideNodes[entry.nodeIndex];
+        uint mask = intersectChildren(node, ray, closest.intersection, distances);
+
+        // Leaves are intersected right away, inner children are pushed from the farthest to the nearest
+        StackEntry inner[Width];
+        uint innerCount = 0;
+        for(; mask != 0 ; mask &= mask - 1) {
+            uint i = std::countr_zero(mask);
+
+            if(node.primitiveCount[i] == 0) {
+                uint j = innerCount++;
+                for(; j > 0 && inner[j - 1].distance < distances[i] ; --j) { inner[j] = inner[j - 1]; }
+                inner[j] = { node.child[i], distances[i] };
+            } else if(distances[i] < closest.intersection) {
+                primitives.intersect(&primitiveIndices[node.child[i]], node.primitiveCount[i], ray, closest);
+            }
+        }
+
+        for(uint i = 0 ; i < innerCount ; ++i) { stack[stackSize++] = inner[i]; }
+    }
+}
+
+template<uint Width>
+bool BVH::occluded(const Ray& ray, float tMax, const std::vector<WideNode<Width>>& wideNodes) const {
+    uint stack[maxDepth * (Width - 1) + 1];
+    uint stackSize = 0;
+
+    alignas(32) float distances[Width];
+
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        SYNTHESE_COUNT(nodesVisited, 1);
+        const WideNode<Width>& node = wideNodes[stack[--stackSize]];
+        uint mask = intersectChildren(node, ray, tMax, distances);
+
+        for(; mask != 0 ; mask &= mask - 1) {
+            uint i = std::countr_zero(mask);
+
+            if(node.primitiveCount[i] == 0) {
+                stack[stackSize++] = node.child[i];
+            } else if(primitives.occluded(&primitiveIndices[node.child[i]], node.primitiveCount[i], ray, tMax)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+template<uint Width>
+uint BVH::collapse(uint nodeIndex, std::vector<WideNode<Width>>& wideNodes) const {
+    uint children[Width]{ nodeIndex };
+    uint childCount = 1;
+
+    while(childCount < Width) {
+        int biggest = -1;
+        float biggestArea = -1.0f;
+        for(uint i = 0 ; i < childCount ; ++i) {
+            const Node& child = nodes[children[i]];
+            if(!child.isLeaf() && child.getSurfaceArea() > biggestArea) {
+                biggest = i;
+                biggestArea = child.getSurfaceArea();
+            }
+        }
+
+        if(biggest == -1) { break; }
+
+        uint left = nodes[children[biggest]].left;
+        children[biggest] = left;
+        children[childCount++] = left + 1;
+    }
+
+    uint wideIndex = wideNodes.size();
+    wideNodes.emplace_back();
+    wideNodes[wideIndex].childCount = childCount;
+
+    for(uint i = 0 ; i < Width ; ++i) {
+        WideNode<Width>& wideNode = wideNodes[wideIndex];
+
+        if(i >= childCount) {
+            wideNode.minX[i] = wideNode.minY[i] = wideNode.minZ[i] = infinity;
+            wideNode.maxX[i] = wideNode.maxY[i] = wideNode.maxZ[i] = -infinity;
+            wideNode.child[i] = wideNode.primitiveCount[i] = 0;
+            continue;
+        }
+
+        const Node& child = nodes[children[i]];
+        wideNode.minX[i] = child.pmin.x;
+        wideNode.minY[i] = child.pmin.y;
+        wideNode.minZ[i] = child.pmin.z;
+        wideNode.maxX[i] = child.pmax.x;
+        wideNode.maxY[i] = child.pmax.y;
+        wideNode.maxZ[i] = child.pmax.z;
+        wideNode.primitiveCount[i] = child.primitiveCount;
+
+        if(child.isLeaf()) {
+            wideNode.child[i] = child.firstPrimitiveIndex;
+        } else {
+            uint childIndex = collapse(children[i], wideNodes); // Can reallocate wideNodes
+            wideNodes[wideIndex].child[i] = childIndex;
+        }
+    }
+
+    return wideIndex;
+}
+
+uint BVH::getChunkCount(uint count) const {
+    if(threadPool == nullptr || count < parallelPrimitiveCount) { return 1; }
+
+    return std::clamp(count / parallelChunkSize, 1u, threadPool->getThreadCount());
+}
+
+void BVH::parallelFor(uint count, const std::function<void(uint chunk, uint first, uint last)>& body) const {
+    const uint chunkCount = getChunkCount(count);
+    if(chunkCount == 1) {
+        body(0, 0, count);
+        return;
+    }
+
+    auto getBound = [count, chunkCount](uint chunk) {
+        return static_cast<uint>(static_cast<uint64_t>(count) * chunk / chunkCount);
+    };
+
+    // The calling thread processes the first chunk itself instead of idling until the others are done
+    ThreadPool::TaskGroup group;
+    for(uint chunk = 1 ; chunk < chunkCount ; ++chunk) {
+        threadPool->run(group, [&body, &getBound, chunk] { body(chunk, getBound(chunk), getBound(chunk + 1)); });
+    }
+    body(0, 0, getBound(1));
+    threadPool->wait(group);
+}
+
+void BVH::collapse() {
+    nodes4.clear();
+    nodes8.clear();
+    if(nodes.empty()) { return; }
+
+    if(layout == Layout::Wide4) {
+        collapse(rootIndex, nodes4);
+    } else if(layout == Layout::Wide8) {
+        collapse(rootIndex, nodes8);
     }
 }
 
-void BVH::subdivide(uint nodeIndex) {
+void BVH::updateBounds(uint nodeIndex) {
     Node& node = nodes[nodeIndex];
-    if(node.objectCount <= 2) { return; }
+    const uint chunkCount = getChunkCount(node.primitiveCount);
+    std::vector<Point> chunkMin(chunkCount, Point(infinity, infinity, infinity));
+    std::vector<Point> chunkMax(chunkCount, Point(-infinity, -infinity, -infinity));
 
-    Vector extent = node.pmax - node.pmin;
+    parallelFor(node.primitiveCount, [this, &node, &chunkMin, &chunkMax](uint chunk, uint first, uint last) {
+        for(uint i = first ; i < last ; ++i) {
+            uint primitive = primitiveIndices[node.firstPrimitiveIndex + i];
+            primitives.compareBoundingBox(primitive, chunkMin[chunk], chunkMax[chunk]);
+        }
+    });
 
-    int axis = 0;
-    if(extent.y > extent(axis)) { axis = 1; }
-    if(extent.z > extent(axis)) { axis = 2; }
+    node.pmin = chunkMin[0];
+    node.pmax = chunkMax[0];
+    for(uint chunk = 1 ; chunk < chunkCount ; ++chunk) {
+        node.pmin = min3(node.pmin, chunkMin[chunk]);
+        node.pmax = max3(node.pmax, chunkMax[chunk]);
+    }
+}
 
-    float bboxCenter = node.pmin(axis) + extent(axis) * 0.5f;
+void BVH::subdivide(uint nodeIndex, uint depth) {
+    Node& node = nodes[nodeIndex];
+    if(depth + 1 >= maxDepth) { return; }
 
-    int i = node.firstObjectIndex;
-    int j = i + node.objectCount - 1;
+    int axis;
+    float position;
+    bool split = buildMethod == BuildMethod::SAH
+                 ? findSAHSplit(node, axis, position)
+                 : findMidpointSplit(node, axis, position);
+    if(!split) { return; }
+
+    int i = node.firstPrimitiveIndex;
+    int j = i + node.primitiveCount - 1;
     while(i <= j) {
-        if(objects.at(objectIndices.at(i))->getCentroid()(axis) < bboxCenter) {
+        if(centroids[primitiveIndices[i]](axis) < position) {
             ++i;
         } else {
-            std::swap(objectIndices[i], objectIndices[j--]);
+            std::swap(primitiveIndices[i], primitiveIndices[j--]);
         }
     }
 
-    int leftCount = i - node.firstObjectIndex;
-    if(leftCount == 0 || leftCount == node.objectCount) { return; }
+    uint leftCount = i - node.firstPrimitiveIndex;
+    if(leftCount == 0 || leftCount == node.primitiveCount) { return; }
 
-    int leftIndex = usedNodes++;
-    int rightIndex = usedNodes++;
+    // Both children are allocated at once so that they stay next to each other when subtrees are built in parallel
+    const uint leftIndex = usedNodes.fetch_add(2);
+    const uint rightIndex = leftIndex + 1;
+    const uint count = node.primitiveCount;
 
-    nodes[leftIndex].firstObjectIndex = node.firstObjectIndex;
-    nodes[leftIndex].objectCount = leftCount;
-    nodes[rightIndex].firstObjectIndex = i;
-    nodes[rightIndex].objectCount = node.objectCount - leftCount;
+    nodes[leftIndex].firstPrimitiveIndex = node.firstPrimitiveIndex;
+    nodes[leftIndex].primitiveCount = leftCount;
+    nodes[rightIndex].firstPrimitiveIndex = i;
+    nodes[rightIndex].primitiveCount = node.primitiveCount - leftCount;
     node.left = leftIndex;
-    node.objectCount = 0; // Shows this node isn't a leaf anymore
+    node.primitiveCount = 0; // Shows this node isn't a leaf anymore
 
     updateBounds(leftIndex);
     updateBounds(rightIndex);
 
-    subdivide(leftIndex);
-    subdivide(rightIndex);
+    if(threadPool != nullptr && count >= parallelPrimitiveCount) {
+        ThreadPool::TaskGroup group;
+        threadPool->run(group, [this, leftIndex, depth] { subdivide(leftIndex, depth + 1); });
+        subdivide(rightIndex, depth + 1);
+        threadPool->wait(group);
+    } else {
+        subdivide(leftIndex, depth + 1);
+        subdivide(rightIndex, depth + 1);
+    }
+}
+
+bool BVH::findMidpointSplit(const Node& node, int& axis, float& position) const {
+    if(node.primitiveCount <= 2) { return false; }
+
+    Vector extent = node.pmax - node.pmin;
+
+    axis = 0;
+    if(extent.y > extent(axis)) { axis = 1; }
+    if(extent.z > extent(axis)) { axis = 2; }
+
+    position = node.pmin(axis) + extent(axis) * 0.5f;
+
+    return true;
+}
+
+bool BVH::findSAHSplit(const Node& node, int& axis, float& position) const {
+    struct Bin {
+        Point pmin{ infinity, infinity, infinity };
+        Point pmax{ -infinity, -infinity, -infinity };
+        uint primitiveCount = 0;
+    };
+
+    if(node.primitiveCount <= 1) { return false; }
+
+    // The bins are laid out over the bounds of the centroids rather than the node's bounds
+    const uint chunkCount = getChunkCount(node.primitiveCount);
+    std::vector<Point> chunkMin(chunkCount, Point(infinity, infinity, infinity));
+    std::vector<Point> chunkMax(chunkCount, Point(-infinity, -infinity, -infinity));
+    parallelFor(node.primitiveCount, [this, &node, &chunkMin, &chunkMax](uint chunk, uint first, uint last) {
+        for(uint i = first ; i < last ; ++i) {
+            const Point& centroid = centroids[primitiveIndices[node.firstPrimitiveIndex + i]];
+            chunkMin[chunk] = min3(chunkMin[chunk], centroid);
+            chunkMax[chunk] = max3(chunkMax[chunk], centroid);
+        }
+    });
+
+    Point centroidMin = chunkMin[0];
+    Point centroidMax = chunkMax[0];
+    for(uint chunk = 1 ; chunk < chunkCount ; ++chunk) {
+        centroidMin = min3(centroidMin, chunkMin[chunk]);
+        centroidMax = max3(centroidMax, chunkMax[chunk]);
+    }
+
+    // Each primitive's bounding box is computed once and added to its bin on all three axes. Every chunk fills its own
+    // bins, which are merged afterwards.
+    float scale[3];
+    for(int a = 0 ; a < 3 ; ++a) {
+        scale[a] = centroidMin(a) < centroidMax(a) ? binCount / (centroidMax(a) - centroidMin(a)) : 0.0f;
+    }
+
+    std::vector<Bin> chunkBins(chunkCount * 3 * binCount);
+    parallelFor(node.primitiveCount, [&](uint chunk, uint first, uint last) {
+        Bin* bins = &chunkBins[chunk * 3 * binCount];
+
+        for(uint i = first ; i < last ; ++i) {
+            uint primitive = primitiveIndices[node.firstPrimitiveIndex + i];
+            Point pmin(infinity, infinity, infinity);
+            Point pmax(-infinity, -infinity, -infinity);
+            primitives.compareBoundingBox(primitive, pmin, pmax);
+
+            for(int a = 0 ; a < 3 ; ++a) {
+                uint binIndex = std::min(binCount - 1,
+                                         static_cast<uint>((centroids[primitive](a) - centroidMin(a)) * scale[a]));
+
+                Bin& bin = bins[a * binCount + binIndex];
+                bin.primitiveCount++;
+                bin.pmin = min3(bin.pmin, pmin);
+                bin.pmax = max3(bin.pmax, pmax);
+            }
+        }
+    });
+
+    for(uint chunk = 1 ; chunk < chunkCount ; ++chunk) {
+        for(uint i = 0 ; i < 3 * binCount ; ++i) {
+            Bin& bin = chunkBins[i];
+            const Bin& other = chunkBins[chunk * 3 * binCount + i];
+            bin.primitiveCount += other.primitiveCount;
+            bin.pmin = min3(bin.pmin, other.pmin);
+            bin.pmax = max3(bin.pmax, other.pmax);
+        }
+    }
+
+    float bestCost = infinity;
+    for(int a = 0 ; a < 3 ; ++a) {
+        float boundsMin = centroidMin(a);
+        float boundsMax = centroidMax(a);
+        if(boundsMin == boundsMax) { continue; }
+
+        const Bin* bins = &chunkBins[a * binCount];
+
+        // Sweeps the bins from both sides to get the area and primitive count on each side of every plane
+        float leftArea[binCount - 1], rightArea[binCount - 1];
+        uint leftCount[binCount - 1], rightCount[binCount - 1];
+        Node left{ bins[0].pmin, bins[0].pmax, 0, 0, 0 };
+        Node right{ bins[binCount - 1].pmin, bins[binCount - 1].pmax, 0, 0, 0 };
+        uint leftSum = 0, rightSum = 0;
+        for(uint i = 0 ; i < binCount - 1 ; ++i) {
+            leftSum += bins[i].primitiveCount;
+            left.pmin = min3(left.pmin, bins[i].pmin);
+            left.pmax = max3(left.pmax, bins[i].pmax);
+            leftCount[i] = leftSum;
+            leftArea[i] = leftSum > 0 ? left.getSurfaceArea() : 0.0f;
+
+            const Bin& bin = bins[binCount - 1 - i];
+            rightSum += bin.primitiveCount;
+            right.pmin = min3(right.pmin, bin.pmin);
+            right.pmax = max3(right.pmax, bin.pmax);
+            rightCount[binCount - 2 - i] = rightSum;
+            rightArea[binCount - 2 - i] = rightSum > 0 ? right.getSurfaceArea() : 0.0f;
+        }
+
+        float binWidth = (boundsMax - boundsMin) / binCount;
+        for(uint i = 0 ; i < binCount - 1 ; ++i) {
+            if(leftCount[i] == 0 || rightCount[i] == 0) { continue; }
+
+            float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if(cost < bestCost) {
+                bestCost = cost;
+                axis = a;
+                position = boundsMin + binWidth * (i + 1);
+            }
+        }
+    }
+
+    if(bestCost == infinity) { return false; }
+
+    // Only splits if a node and its two children are expected to be cheaper than the leaf
+    float area = node.getSurfaceArea();
+    float leafCost = intersectionCost * node.primitiveCount;
+    float splitCost = area > 0.0f ? traversalCost + intersectionCost * bestCost / area : infinity;
+
+    return splitCost < leafCost;
+}
+
+/**
+ * @brief Spreads the lower bits of an integer three bits apart, to interleave the coordinates of a Morton code.
+ * @param x The integer, of at most 21 bits.
+ * @return The spread bits.
+ */
+static uint64_t spreadBits(uint64_t x) {
+    x &= 0x1FFFFF;
+    x = (x | x << 32) & 0x1F00000000FFFF;
+    x = (x | x << 16) & 0x1F0000FF0000FF;
+    x = (x | x << 8) & 0x100F00F00F00F00F;
+    x = (x | x << 4) & 0x10C30C30C30C30C3;
+    x = (x | x << 2) & 0x1249249249249249;
+    return x;
+}
+
+/**
+ * @brief Tells whether the sorted Morton codes split less between two consecutive primitives than between two others,
+ * i.e. whether they differ by a lower bit. Equal codes are told apart by the positions of the primitives, so that runs
+ * of them are split in balanced halves.
+ * @param codes The sorted Morton codes.
+ * @param i The position of the first primitive of the first pair.
+ * @param j The position of the first primitive of the second pair.
+ * @return Whether the first pair splits less.
+ */
+static bool isSplitLower(const std::vector<uint64_t>& codes, uint i, uint j) {
+    const uint64_t first = codes[i] ^ codes[i + 1];
+    const uint64_t second = codes[j] ^ codes[j + 1];
+    if(first != second) { return first < second; }
+
+    return (i ^ (i + 1)) < (j ^ (j + 1));
+}
+
+void BVH::buildLinear() {
+    // The Morton codes quantise the centroids over their bounding box
+    const uint chunkCount = getChunkCount(primitiveCount);
+    std::vector<Point> chunkMin(chunkCount, Point(infinity, infinity, infinity));
+    std::vector<Point> chunkMax(chunkCount, Point(-infinity, -infinity, -infinity));
+    parallelFor(primitiveCount, [this, &chunkMin, &chunkMax](uint chunk, uint first, uint last) {
+        for(uint i = first ; i < last ; ++i) {
+            chunkMin[chunk] = min3(chunkMin[chunk], centroids[i]);
+            chunkMax[chunk] = max3(chunkMax[chunk], centroids[i]);
+        }
+    });
+
+    Point centroidMin = chunkMin[0];
+    Point centroidMax = chunkMax[0];
+    for(uint chunk = 1 ; chunk < chunkCount ; ++chunk) {
+        centroidMin = min3(centroidMin, chunkMin[chunk]);
+        centroidMax = max3(centroidMax, chunkMax[chunk]);
+    }
+
+    // Large sets of primitives get 21 bits per axis instead of 10 so that fewer of them share a code
+    const uint axisBits = primitiveCount >= wideMortonCount ? 21 : 10;
+    const float cellCount = static_cast<float>((1u << axisBits) - 1);
+    float scale[3];
+    for(int a = 0 ; a < 3 ; ++a) {
+        scale[a] = centroidMin(a) < centroidMax(a) ? cellCount / (centroidMax(a) - centroidMin(a)) : 0.0f;
+    }
+
+    std::vector<uint64_t> codes(primitiveCount);
+    parallelFor(primitiveCount, [&](uint, uint first, uint last) {
+        for(uint i = first ; i < last ; ++i) {
+            uint64_t code = 0;
+            for(int a = 0 ; a < 3 ; ++a) {
+                const float cell = std::clamp((centroids[i](a) - centroidMin(a)) * scale[a], 0.0f, cellCount);
+                code |= spreadBits(static_cast<uint64_t>(cell)) << (2 - a);
+            }
+            codes[i] = code;
+        }
+    });
+
+    sortMortonCodes(codes, 3 * axisBits);
+
+    // The hierarchy is emitted bottom-up (Apetrei, "Fast and Simple Agglomerative LBVH Construction", 2014): a node
+    // joins the range of primitives next to it whose codes split the least from its own, inner node i joining the
+    // ranges ending at primitive i and starting at primitive i + 1. The first child to reach an inner node stops, the
+    // second one completes it and goes on with its parent
+    const uint firstLeaf = primitiveCount - 1;
+    std::vector<LinearNode> linearNodes(firstLeaf + primitiveCount);
+    std::vector<uint> otherBounds(firstLeaf, -1u);
+    uint linearRoot = firstLeaf;
+
+    parallelFor(primitiveCount, [&](uint, uint first, uint last) {
+        for(uint i = first ; i < last ; ++i) {
+            uint index = firstLeaf + i;
+            LinearNode& leaf = linearNodes[index];
+            leaf.pmin = Point(infinity, infinity, infinity);
+            leaf.pmax = Point(-infinity, -infinity, -infinity);
+            primitives.compareBoundingBox(primitiveIndices[i], leaf.pmin, leaf.pmax);
+            leaf.primitiveCount = 1;
+            leaf.cost = intersectionCost * getBoxArea(leaf.pmin, leaf.pmax);
+            leaf.collapsed = true;
+
+            uint rangeFirst = i;
+            uint rangeLast = i;
+            while(rangeFirst > 0 || rangeLast < firstLeaf) {
+                const bool joinsNext = rangeFirst == 0
+                                       || (rangeLast < firstLeaf && isSplitLower(codes, rangeLast, rangeFirst - 1));
+                const uint parent = joinsNext ? rangeLast : rangeFirst - 1;
+                linearNodes[parent].child[joinsNext ? 0 : 1] = index;
+
+                const uint bound = joinsNext ? rangeFirst : rangeLast;
+                const uint otherBound = std::atomic_ref<uint>(otherBounds[parent]).exchange(bound,
+                                                                                         std::memory_order_acq_rel);
+                if(otherBound == -1u) { break; }
+                (joinsNext ? rangeLast : rangeFirst) = otherBound;
+                index = parent;
+
+                LinearNode& node = linearNodes[index];
+                const LinearNode& left = linearNodes[node.child[0]];
+                const LinearNode& right = linearNodes[node.child[1]];
+                node.pmin = min3(left.pmin, right.pmin);
+                node.pmax = max3(left.pmax, right.pmax);
+                node.primitiveCount = rangeLast - rangeFirst + 1;
+
+                const float area = getBoxArea(node.pmin, node.pmax);
+                const float leafCost = intersectionCost * area * node.primitiveCount;
+                node.cost = traversalCost * area + left.cost + right.cost;
+                node.collapsed = node.primitiveCount <= maxLeafSize && leafCost <= node.cost;
+                if(node.collapsed) { node.cost = leafCost; }
+
+                if(buildMethod == BuildMethod::TRBVH && node.primitiveCount >= treeletSize) {
+                    optimizeTreelet(index, linearNodes);
+                }
+            }
+
+            if(rangeFirst == 0 && rangeLast == firstLeaf) { linearRoot = index; }
+        }
+    });
+
+    // The primitives are reordered as the leaves are laid out, since restructuring the treelets mixes their ranges
+    const std::vector<uint> sortedIndices = primitiveIndices;
+    layOutLinear(linearRoot, rootIndex, 0, 0, linearNodes, sortedIndices);
+}
+
+void BVH::sortMortonCodes(std::vector<uint64_t>& codes, uint codeBits) {
+    static constexpr uint digitBits = 11;
+    static constexpr uint digitCount = 1 << digitBits;
+
+    // Each chunk counts its digits, then moves its primitives after the ones of the same digit in the chunks before it,
+    // which keeps the sort stable
+    const uint chunkCount = getChunkCount(primitiveCount);
+    std::vector<uint> offsets(chunkCount * digitCount);
+    std::vector<uint64_t> sortedCodes(primitiveCount);
+    std::vector<uint> sortedIndices(primitiveCount);
+
+    for(uint shift = 0 ; shift < codeBits ; shift += digitBits) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        parallelFor(primitiveCount, [&codes, &offsets, shift](uint chunk, uint first, uint last) {
+            uint* counts = &offsets[chunk * digitCount];
+            for(uint i = first ; i < last ; ++i) { ++counts[(codes[i] >> shift) & (digitCount - 1)]; }
+        });
+
+        uint sum = 0;
+        for(uint digit = 0 ; digit < digitCount ; ++digit) {
+            for(uint chunk = 0 ; chunk < chunkCount ; ++chunk) {
+                const uint count = offsets[chunk * digitCount + digit];
+                offsets[chunk * digitCount + digit] = sum;
+                sum += count;
+            }
+        }
+
+        parallelFor(primitiveCount, [&](uint chunk, uint first, uint last) {
+            uint* next = &offsets[chunk * digitCount];
+            for(uint i = first ; i < last ; ++i) {
+                const uint position = next[(codes[i] >> shift) & (digitCount - 1)]++;
+                sortedCodes[position] = codes[i];
+                sortedIndices[position] = primitiveIndices[i];
+            }
+        });
+
+        codes.swap(sortedCodes);
+        primitiveIndices.swap(sortedIndices);
+    }
+}
+
+void BVH::optimizeTreelet(uint nodeIndex, std::vector<LinearNode>& linearNodes) const {
+    static constexpr uint subsetCount = 1 << treeletSize;
+
+    // Only the inner nodes of the radix tree can be expanded, the biggest first
+    const uint firstLeaf = primitiveCount - 1;
+    uint leaves[treeletSize]{ linearNodes[nodeIndex].child[0], linearNodes[nodeIndex].child[1] };
+    uint inners[treeletSize - 1]{ nodeIndex };
+    uint leafCount = 2;
+    uint innerCount = 1;
+
+    while(leafCount < treeletSize) {
+        int biggest = -1;
+        float biggestArea = -1.0f;
+        for(uint i = 0 ; i < leafCount ; ++i) {
+            const LinearNode& leaf = linearNodes[leaves[i]];
+            const float area = getBoxArea(leaf.pmin, leaf.pmax);
+            if(leaves[i] < firstLeaf && area > biggestArea) {
+                biggest = i;
+                biggestArea = area;
+            }
+        }
+
+        if(biggest == -1) { break; }
+
+        const LinearNode& expanded = linearNodes[leaves[biggest]];
+        inners[innerCount++] = leaves[biggest];
+        leaves[biggest] = expanded.child[0];
+        leaves[leafCount++] = expanded.child[1];
+    }
+
+    if(leafCount <= 2) { return; }
+
+    // The bounds of a subset of the treelet's leaves are the ones of the subset without its lowest leaf, grown by it.
+    // Its cost is the cheapest of its splits in two subsets, or of a leaf
+    const uint fullSet = (1u << leafCount) - 1;
+    Point subsetMin[subsetCount], subsetMax[subsetCount];
+    uint counts[subsetCount], partitions[subsetCount];
+    float costs[subsetCount];
+    bool collapsed[subsetCount];
+
+    for(uint subset = 1 ; subset <= fullSet ; ++subset) {
+        const uint lowest = std::countr_zero(subset);
+        const uint rest = subset & (subset - 1);
+        const LinearNode& leaf = linearNodes[leaves[lowest]];
+
+        if(rest == 0) {
+            subsetMin[subset] = leaf.pmin;
+            subsetMax[subset] = leaf.pmax;
+            counts[subset] = leaf.primitiveCount;
+            costs[subset] = leaf.cost;
+            continue;
+        }
+
+        subsetMin[subset] = min3(subsetMin[rest], leaf.pmin);
+        subsetMax[subset] = max3(subsetMax[rest], leaf.pmax);
+        counts[subset] = counts[rest] + leaf.primitiveCount;
+
+        // Each split is only tried once, with the lowest leaf on its left along with any strict subset of the others
+        float bestCost = infinity;
+        for(uint others = (rest - 1) & rest ; ; others = (others - 1) & rest) {
+            const uint part = (subset ^ rest) | others;
+            const float cost = costs[part] + costs[subset ^ part];
+            if(cost < bestCost) {
+                bestCost = cost;
+                partitions[subset] = part;
+            }
+
+            if(others == 0) { break; }
+        }
+
+        const float area = getBoxArea(subsetMin[subset], subsetMax[subset]);
+        const float leafCost = intersectionCost * area * counts[subset];
+        costs[subset] = traversalCost * area + bestCost;
+        collapsed[subset] = counts[subset] <= maxLeafSize && leafCost <= costs[subset];
+        if(collapsed[subset]) { costs[subset] = leafCost; }
+    }
+
+    if(!(costs[fullSet] < linearNodes[nodeIndex].cost)) { return; }
+
+    // The inner nodes are reused in the order they were expanded, starting with the treelet's root
+    uint nextInner = 0;
+    const auto rebuild = [&](const auto& rebuild, uint subset) -> uint {
+        if(std::has_single_bit(subset)) { return leaves[std::countr_zero(subset)]; }
+
+        const uint index = inners[nextInner++];
+        const uint left = rebuild(rebuild, partitions[subset]);
+        const uint right = rebuild(rebuild, subset ^ partitions[subset]);
+
+        LinearNode& node = linearNodes[index];
+        node.pmin = subsetMin[subset];
+        node.pmax = subsetMax[subset];
+        node.child[0] = left;
+        node.child[1] = right;
+        node.primitiveCount = counts[subset];
+        node.cost = costs[subset];
+        node.collapsed = collapsed[subset];
+
+        return index;
+    };
+    rebuild(rebuild, fullSet);
+}
+
+void BVH::layOutLinear(uint linearIndex, uint nodeIndex, uint firstPrimitive, uint depth,
+                       const std::vector<LinearNode>& linearNodes, const std::vector<uint>& sortedIndices) {
+    const uint firstLeaf = primitiveCount - 1;
+    const LinearNode& linearNode = linearNodes[linearIndex];
+    Node& node = nodes[nodeIndex];
+    node.pmin = linearNode.pmin;
+    node.pmax = linearNode.pmax;
+    node.firstPrimitiveIndex = firstPrimitive;
+
+    if(linearNode.collapsed || depth + 1 >= maxDepth) {
+        // The leaves of the subtree from left to right, the radix tree can be deeper than the BVH
+        node.left = 0;
+        node.primitiveCount = linearNode.primitiveCount;
+
+        uint next = firstPrimitive;
+        const auto gather = [&](const auto& gather, uint index) -> void {
+            if(index >= firstLeaf) {
+                primitiveIndices[next++] = sortedIndices[index - firstLeaf];
+            } else {
+                gather(gather, linearNodes[index].child[0]);
+                gather(gather, linearNodes[index].child[1]);
+            }
+        };
+        gather(gather, linearIndex);
+
+        return;
+    }
+
+    const uint leftIndex = usedNodes.fetch_add(2);
+    const uint left = linearNode.child[0];
+    const uint right = linearNode.child[1];
+    const uint rightFirst = firstPrimitive + linearNodes[left].primitiveCount;
+    node.left = leftIndex;
+    node.primitiveCount = 0;
+
+    if(threadPool != nullptr && linearNode.primitiveCount >= parallelPrimitiveCount) {
+        ThreadPool::TaskGroup group;
+        threadPool->run(group, [&, left, leftIndex, firstPrimitive, depth] {
+            layOutLinear(left, leftIndex, firstPrimitive, depth + 1, linearNodes, sortedIndices);
+        });
+        layOutLinear(right, leftIndex + 1, rightFirst, depth + 1, linearNodes, sortedIndices);
+        threadPool->wait(group);
+    } else {
+        layOutLinear(left, leftIndex, firstPrimitive, depth + 1, linearNodes, sortedIndices);
+        layOutLinear(right, leftIndex + 1, rightFirst, depth + 1, linearNodes, sortedIndices);
+    }
 }
@@ -0,0 +1,247 @@
+/***************************************************************************************************
+ * @file  Geometry.cpp
+ * @brief Implementation of the Geometry class
+ **************************************************************************************************/
+
+#include "synthese/Geometry.hpp"
+
+#include <bit>
+#include <stdexcept>
+#include "synthese/Statistics.hpp"
+#include "utility.hpp"
+
+Geometry::~Geometry() {
+    for(const Object* object : objects) { delete object; }
+}
+
+void Geometry::add(const Object* object) {
+    checkMaterial(object->material);
+    objects.push_back(object);
+}
+
+uint Geometry::addInstance(uint mesh, const mat4& transform, MaterialID material) {
+    if(mesh >= meshStore.getMeshCount()) { throw std::out_of_range("Mesh index out of range."); }
+    if(material != MaterialTable::meshMaterials) { checkMaterial(material); }
+
+    mat4 inverseTransform = inverse(transform);
+    instances.push_back({ mesh, transform, inverseTransform, transpose(inverseTransform), material, Point(), Point() });
+
+    return instances.size() - 1;
+}
+
+void Geometry::setInstanceTransform(uint instance, const mat4& transform) {
+    if(instance >= instances.size()) { throw std::out_of_range("Instance index out of range."); }
+
+    Instance& moved = instances[instance];
+    moved.transform = transform;
+    moved.inverseTransform = inverse(transform);
+    moved.normalTransform = transpose(moved.inverseTransform);
+}
+
+void Geometry::initialize(BVH::BuildMethod method, BVH::Layout layout, ThreadPool* threadPool) {
+    ThreadPool::TaskGroup group;
+    for(uint i = 0 ; i < meshStore.getMeshCount() ; ++i) {
+        BVH& bvh = meshStore.getMesh(i).bvh;
+        bvh.setLayout(layout);
+
+        // Meshes don't change once stored, so their BVHs are only built again for another method
+        if(bvh.isBuilt() && bvh.getBuildMethod() == method) { continue; }
+
+        bvh.setBuildMethod(method);
+        if(threadPool == nullptr) {
+            bvh.initialize();
+        } else {
+            threadPool->run(group, [&bvh, threadPool] { bvh.initialize(threadPool); });
+        }
+    }
+    if(threadPool != nullptr) { threadPool->wait(group); }
+
+    for(Instance& instance : instances) {
+        Point pmin, pmax;
+        if(!meshStore.getMesh(instance.mesh).bvh.getBounds(pmin, pmax)) {
+            instance.pmin = instance.pmax = instance.transform * Point(); // An empty mesh, bounded by its origin
+            continue;
+        }
+
+        // The bounding box of the 8 transformed corners of the mesh's bounding box
+        instance.pmin = Point(infinity, infinity, infinity);
+        instance.pmax = Point(-infinity, -infinity, -infinity);
+        for(uint corner = 0 ; corner < 8 ; ++corner) {
+            Point point = instance.transform * Point(corner & 1 ? pmax.x : pmin.x,
+                                                     corner & 2 ? pmax.y : pmin.y,
+                                                     corner & 4 ? pmax.z : pmin.z);
+            instance.pmin = min3(instance.pmin, point);
+            instance.pmax = max3(instance.pmax, point);
+        }
+    }
+}
+
+const std::vector<const Object*>& Geometry::getObjects() const {
+    return objects;
+}
+
+const std::vector<Instance>& Geometry::getInstances() const {
+    return instances;
+}
+
+MeshStore& Geometry::getMeshStore() {
+    return meshStore;
+}
+
+const MeshStore& Geometry::getMeshStore() const {
+    return meshStore;
+}
+
+MaterialTable& Geometry::getMaterials() {
+    return materials;
+}
+
+const MaterialTable& Geometry::getMaterials() const {
+    return materials;
+}
+
+void Geometry::checkMaterial(MaterialID material) const {
+    if(material >= materials.getMaterialCount()) { throw std::out_of_range("Material ID out of range."); }
+}
+
+Color Geometry::getColor(const Hit& hit, const Point& point) const {
+    if(hit.object != nullptr) { return materials.evaluate(hit.object->material, point); }
+
+    MaterialID material = instances[hit.instance].material;
+    if(material == MaterialTable::meshMaterials) { material = meshStore.getMaterial(hit.primitive); }
+
+    return materials.evaluate(material, point);
+}
+
+void Geometry::computeNormal(const Ray& ray, Hit& hit) const {
+    if(hit.object != nullptr) {
+        hit.normal = hit.object->getNormal(ray.getPoint(hit.intersection), hit.u, hit.v);
+        return;
+    }
+    if(hit.instance == -1u) { return; }
+
+    const Instance& instance = instances[hit.instance];
+    hit.normal = normalize(instance.normalTransform * meshStore.getNormal(hit.primitive, hit.u, hit.v));
+}
+
+uint Geometry::getPrimitiveCount() const {
+    return objects.size() + instances.size();
+}
+
+Point Geometry::getCentroid(uint primitive) const {
+    if(primitive < objects.size()) { return objects[primitive]->getCentroid(); }
+
+    const Instance& instance = instances[primitive - objects.size()];
+    return center(instance.pmin, instance.pmax);
+}
+
+void Geometry::compareBoundingBox(uint primitive, Point& pmin, Point& pmax) const {
+    if(primitive < objects.size()) {
+        objects[primitive]->compareBoundingBox(pmin, pmax);
+    } else {
+        const Instance& instance = instances[primitive - objects.size()];
+        pmin = min3(pmin, instance.pmin);
+        pmax = max3(pmax, instance.pmax);
+    }
+}
+
+void Geometry::intersect(const uint* primitives, uint count, const Ray& ray, Hit& closest) const {
+    const uint objectCount = objects.size();
+
+    for(uint i = 0 ; i < count ; ++i) {
+        const uint primitive = primitives[i];
+
+        if(primitive < objectCount) {
+            float t, u = 0.0f, v = 0.0f;
+            SYNTHESE_COUNT(primitivesTested, 1);
+
+            if(objects[primitive]->intersect(ray, t, u, v) && t < closest.intersection) {
+                SYNTHESE_COUNT(intersectionsFound, 1);
+                closest.intersection = t;
+                closest.u = u;
+                closest.v = v;
+                closest.object = objects[primitive];
+                closest.instance = -1u;
+                closest.primitive = primitive;
+            }
+        } else {
+            const Instance& instance = instances[primitive - objectCount];
+            const float previous = closest.intersection;
+
+            meshStore.getMesh(instance.mesh).bvh.intersect(toObjectSpace(instance, ray), closest);
+            if(closest.intersection < previous) { closest.instance = primitive - objectCount; }
+        }
+    }
+}
+
+void Geometry::intersect(const uint* primitives, uint count, const Ray* rays, uint64_t mask, Hit* closest) const {
+    const uint objectCount = objects.size();
+
+    for(uint i = 0 ; i < count ; ++i) {
+        const uint primitive = primitives[i];
+
+        if(primitive < objectCount) {
+            for(uint64_t bits = mask ; bits != 0 ; bits &= bits - 1) {
+                intersect(&primitive, 1, rays[std::countr_zero(bits)], closest[std::countr_zero(bits)]);
+            }
+            continue;
+        }
+
+        // Packs the rays in the instance's object space so that they can keep traversing its mesh as a packet
+        const Instance& instance = instances[primitive - objectCount];
+        Ray localRays[BVH::maxPacketSize];
+        Hit localClosest[BVH::maxPacketSize];
+        uint localCount = 0;
+
+        // Only the distances of the closest hits are needed to cull the mesh's triangles
+        for(uint64_t bits = mask ; bits != 0 ; bits &= bits - 1) {
+            const uint j = std::countr_zero(bits);
+            localRays[localCount] = toObjectSpace(instance, rays[j]);
+            localClosest[localCount++].intersection = closest[j].intersection;
+        }
+
+        meshStore.getMesh(instance.mesh).bvh.intersect(localRays, localCount, localClosest);
+
+        localCount = 0;
+        for(uint64_t bits = mask ; bits != 0 ; bits &= bits - 1) {
+            const uint j = std::countr_zero(bits);
+            const Hit& hit = localClosest[localCount++];
+
+            if(hit.intersection < closest[j].intersection) {
+                closest[j].intersection = hit.intersection;
+                closest[j].u = hit.u;
+                closest[j].v = hit.v;
+                closest[j].object = nullptr;
+                closest[j].primitive = hit.primitive;
+                closest[j].instance = primitive - objectCount;
+            }
+        }
+    }
+}
+
+bool Geometry::occluded(const uint* primitives, uint count, const Ray& ray, float tMax) const {
+    const uint objectCount = objects.size();
+
+    for(uint i = 0 ; i < count ; ++i) {
+        const uint primitive = primitives[i];
+
+        if(primitive < objectCount) {
+            float t, u, v;
+            SYNTHESE_COUNT(primitivesTested, 1);
+            if(objects[primitive]->intersect(ray, t, u, v) && t < tMax) {
+                SYNTHESE_COUNT(intersectionsFound, 1);
+                return true;
+            }
+        } else {
+            const Instance& instance = instances[primitive - objectCount];
+            if(meshStore.getMesh(instance.mesh).bvh.occluded(toObjectSpace(instance, ray), tMax)) { return true; }
+        }
+    }
+
+    return false;
+}
+
+Ray Geometry::toObjectSpace(const Instance& instance, const Ray& ray) {
+    // The direction isn't normalised, so a point keeps the same distance parameter in object space
+    return Ray(instance.inverseTransform * ray.origin, instance.inverseTransform * ray.direction, ray.tMin, ray.tMax);
+}
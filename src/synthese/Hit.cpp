@@ -7,6 +7,9 @@
 
 #include "synthese/Object.hpp"
 
-Hit::Hit() : intersection(infinity), normal(0.0f, 0.0f, 0.0f), object(nullptr) { }
+Hit::Hit()
+    : intersection(infinity), normal(0.0f, 0.0f, 0.0f),
+      object(nullptr), primitive(-1u), instance(-1u), u(0.0f), v(0.0f) { }
 
-Hit::Hit(float intersection, const Vector& normal) : intersection(intersection), normal(normal), object(nullptr) { }
+Hit::Hit(float intersection, const Vector& normal)
+    : intersection(intersection), normal(normal), object(nullptr), primitive(-1u), instance(-1u), u(0.0f), v(0.0f) { }
@@ -0,0 +1,85 @@
+/***************************************************************************************************
+ * @file  ImageStream.cpp
+ * @brief Implementation of the ImageStream class
+ **************************************************************************************************/
+
+#include "synthese/ImageStream.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+ImageStream::ImageStream(ImageWriter& writer, unsigned int width, unsigned int height, unsigned int bandHeight,
+                         unsigned int slotCount)
+    : writer(writer), width(width), height(height), bandHeight(bandHeight),
+      bandCount((height + bandHeight - 1) / bandHeight),
+      slots(std::max(slotCount, 1u)), remainingPixels(slots.size(), 0), nextBand(0), writing(false) {
+
+    for(unsigned int i = 0 ; i < slots.size() ; ++i) {
+        slots[i].resize(4 * width * bandHeight);
+
+        unsigned int top;
+        if(i < bandCount) { remainingPixels[i] = width * getBandRows(i, top); }
+    }
+}
+
+void ImageStream::add(unsigned int firstColumn, unsigned int firstRow, unsigned int columns, unsigned int rows,
+                      const Color* pixels) {
+    const unsigned int band = bandCount - 1 - firstRow / bandHeight;
+    unsigned int top;
+    getBandRows(band, top);
+    if(firstRow + rows > top || firstColumn + columns > width) {
+        throw std::invalid_argument("A tile overlaps two bands of the image.");
+    }
+
+    const unsigned int slot = band % slots.size();
+    std::unique_lock lock(mutex);
+    written.wait(lock, [this, band] { return band < nextBand + slots.size(); });
+    lock.unlock();
+
+    // Quantised like gkit's write_image, the rows of the slot going from the top of the band to its bottom
+    for(unsigned int y = 0 ; y < rows ; ++y) {
+        unsigned char* row = slots[slot].data() + 4 * (width * (top - 1 - firstRow - y) + firstColumn);
+        const Color* tileRow = pixels + y * columns;
+        for(unsigned int x = 0 ; x < columns ; ++x) {
+            row[4 * x] = std::clamp(tileRow[x].r * 255.0f, 0.0f, 255.0f);
+            row[4 * x + 1] = std::clamp(tileRow[x].g * 255.0f, 0.0f, 255.0f);
+            row[4 * x + 2] = std::clamp(tileRow[x].b * 255.0f, 0.0f, 255.0f);
+            row[4 * x + 3] = std::clamp(tileRow[x].a * 255.0f, 0.0f, 255.0f);
+        }
+    }
+
+    lock.lock();
+    remainingPixels[slot] -= columns * rows;
+    if(writing) { return; }
+
+    // The bands are written outside the lock so that the other threads keep adding tiles meanwhile
+    writing = true;
+    while(nextBand < bandCount && remainingPixels[nextBand % slots.size()] == 0) {
+        const unsigned int writtenSlot = nextBand % slots.size();
+        const unsigned int bandRows = getBandRows(nextBand, top);
+
+        lock.unlock();
+        writer.writeRows(slots[writtenSlot].data(), bandRows);
+        lock.lock();
+
+        const unsigned int reusingBand = nextBand + slots.size();
+        if(reusingBand < bandCount) { remainingPixels[writtenSlot] = width * getBandRows(reusingBand, top); }
+        ++nextBand;
+        written.notify_all();
+    }
+    writing = false;
+}
+
+void ImageStream::finish() {
+    std::lock_guard lock(mutex);
+    if(nextBand != bandCount) { throw std::runtime_error("Some tiles of the image are missing."); }
+
+    writer.close();
+}
+
+unsigned int ImageStream::getBandRows(unsigned int band, unsigned int& top) const {
+    const unsigned int bottom = (bandCount - 1 - band) * bandHeight;
+    top = std::min(bottom + bandHeight, height);
+
+    return top - bottom;
+}
@@ -12,9 +12,21 @@
 
 Light::Light(const Color& color) : color(color) { }
 
-bool Light::isInShadow(const Object* object, const Ray& ray, const Scene* scene) {
-    const Hit closest = scene->getClosestHit(ray);
-    return closest.object != nullptr && closest.object != object;
+Color Light::calculate(const Hit& hit, const Point& point, const Scene* scene) const {
+    Ray shadowRay;
+    Color light = calculateUnshadowed(hit, point, shadowRay);
+
+    if(light == Black() || isInShadow(shadowRay, shadowRay.tMax, scene)) { return Black(); }
+
+    return light;
+}
+
+bool Light::getBoundingBox(Point&, Point&) const {
+    return false;
+}
+
+bool Light::isInShadow(const Ray& ray, float distance, const Scene* scene) {
+    return scene->isOccluded(ray, distance);
 }
 
 DirectionalLight::DirectionalLight(const Color& color, const Vector& direction)
@@ -24,16 +36,18 @@ LightType DirectionalLight::getType() const {
     return LightType::DirectionalLight;
 }
 
-Color DirectionalLight::calculate(const Hit& hit, const Point& point, const Scene* scene) const {
-    Ray ray(point, direction);
+Color DirectionalLight::calculateUnshadowed(const Hit& hit, const Point& point, Ray& shadowRay) const {
+    shadowRay = Ray(point, direction);
 
-    if(isInShadow(hit.object, ray, scene)) { return Black(); }
-
-    float cos_theta = std::max(dot(hit.normal, ray.direction), 0.0f);
+    float cos_theta = std::max(dot(hit.normal, shadowRay.direction), 0.0f);
 
     return color * cos_theta;
 }
 
+float DirectionalLight::getPower() const {
+    return color.power();
+}
+
 PointLight::PointLight(const Color& color, const Point& position, float radius)
     : Light(color), position(position), radius(radius) { }
 
@@ -41,16 +55,26 @@ LightType PointLight::getType() const {
     return LightType::PointLight;
 }
 
-Color PointLight::calculate(const Hit& hit, const Point& point, const Scene* scene) const {
+Color PointLight::calculateUnshadowed(const Hit& hit, const Point& point, Ray& shadowRay) const {
     Vector direction(point, position);
     float distance = length(direction);
-    Ray ray(point, direction * (1.0f / distance));
-
-    if(isInShadow(hit.object, ray, scene)) { return Black(); }
+    shadowRay = Ray(point, direction * (1.0f / distance), 0.0f, distance);
 
+    // Outside of the light's sphere, its windowing term is zero
     float windowing = pow2(std::max(1.0f - pow2(distance / radius), 0.0f));
     float attenuation = windowing * (pow2(radius) / (pow2(distance) + radius));
-    float cos_theta = std::max(dot(hit.normal, ray.direction), 0.0f);
+    float cos_theta = std::max(dot(hit.normal, shadowRay.direction), 0.0f);
 
     return color * (attenuation * cos_theta);
 }
+
+float PointLight::getPower() const {
+    return color.power() * radius;
+}
+
+bool PointLight::getBoundingBox(Point& pmin, Point& pmax) const {
+    pmin = position - Vector(radius, radius, radius);
+    pmax = position + Vector(radius, radius, radius);
+
+    return true;
+}
@@ -0,0 +1,209 @@
+/***************************************************************************************************
+ * @file  LightGrid.cpp
+ * @brief Implementation of the LightGrid class
+ **************************************************************************************************/
+
+#include "synthese/LightGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "utility.hpp"
+
+LightGrid::LightGrid() : pmin{ }, pmax{ }, inverseCellSize{ }, resolution{ }, boundedLightCount(0) { }
+
+void LightGrid::build(std::span<const Light* const> lights) {
+    std::vector<Point> minima(lights.size()), maxima(lights.size());
+    std::vector<bool> bounded(lights.size());
+    Point gridMin(infinity, infinity, infinity), gridMax(-infinity, -infinity, -infinity);
+
+    boundedLightCount = 0;
+    for(unsigned int i = 0 ; i < lights.size() ; ++i) {
+        bounded[i] = lights[i]->getBoundingBox(minima[i], maxima[i]);
+        if(bounded[i]) {
+            gridMin = min3(gridMin, minima[i]);
+            gridMax = max3(gridMax, maxima[i]);
+            ++boundedLightCount;
+        }
+    }
+
+    std::fill(resolution, resolution + 3, 0);
+    if(boundedLightCount > 0) {
+        // The cells are as cubic as possible, the flat axes of the grid only getting one cell
+        const float extents[3]{ gridMax.x - gridMin.x, gridMax.y - gridMin.y, gridMax.z - gridMin.z };
+        const unsigned int targetCellCount = std::min(boundedLightCount * cellsPerLight, maxCellCount);
+        float volume = 1.0f;
+        unsigned int dimensions = 0;
+        for(float extent : extents) {
+            if(extent > 0.0f) {
+                volume *= extent;
+                ++dimensions;
+            }
+        }
+
+        const float cellSize = dimensions == 0 ? 1.0f : std::pow(volume / targetCellCount, 1.0f / dimensions);
+        for(unsigned int axis = 0 ; axis < 3 ; ++axis) {
+            const float cells = std::ceil(extents[axis] / cellSize);
+            resolution[axis] = extents[axis] > 0.0f ? std::clamp(cells, 1.0f, static_cast<float>(maxCellCount)) : 1;
+        }
+
+        pmin[0] = gridMin.x, pmin[1] = gridMin.y, pmin[2] = gridMin.z;
+        pmax[0] = gridMax.x, pmax[1] = gridMax.y, pmax[2] = gridMax.z;
+
+        // Rounding the resolutions up can go over the maximum amount of cells, and lights overlapping many cells over
+        // the amount of entries aimed under
+        while(true) {
+            for(unsigned int axis = 0 ; axis < 3 ; ++axis) {
+                inverseCellSize[axis] = extents[axis] > 0.0f ? resolution[axis] / extents[axis] : 0.0f;
+            }
+
+            const uint64_t cellCount = static_cast<uint64_t>(resolution[0]) * resolution[1] * resolution[2];
+            uint64_t entryCount = cellCount * (lights.size() - boundedLightCount);
+            for(unsigned int i = 0 ; i < lights.size() && cellCount <= maxCellCount ; ++i) {
+                if(!bounded[i]) { continue; }
+
+                entryCount += static_cast<uint64_t>(getCell(maxima[i].x, 0) - getCell(minima[i].x, 0) + 1)
+                              * (getCell(maxima[i].y, 1) - getCell(minima[i].y, 1) + 1)
+                              * (getCell(maxima[i].z, 2) - getCell(minima[i].z, 2) + 1);
+            }
+
+            if(cellCount == 1 || (cellCount <= maxCellCount && entryCount <= maxEntryCount)) { break; }
+
+            unsigned int& largest = *std::max_element(resolution, resolution + 3);
+            largest = (largest + 1) / 2;
+        }
+    }
+
+    // Counts the lights of each cell, then lists them in the order of the lights so that they are summed in that order.
+    // The extra cell, after the grid's, only has the unbounded lights
+    const unsigned int gridCellCount = resolution[0] * resolution[1] * resolution[2];
+    const auto forEachCell = [this, &minima, &maxima, &bounded, gridCellCount](unsigned int light, auto&& function) {
+        if(!bounded[light]) {
+            for(unsigned int cell = 0 ; cell <= gridCellCount ; ++cell) { function(cell); }
+            return;
+        }
+
+        const unsigned int first[3]{ getCell(minima[light].x, 0), getCell(minima[light].y, 1),
+                                     getCell(minima[light].z, 2) };
+        const unsigned int last[3]{ getCell(maxima[light].x, 0), getCell(maxima[light].y, 1),
+                                    getCell(maxima[light].z, 2) };
+
+        for(unsigned int z = first[2] ; z <= last[2] ; ++z) {
+            for(unsigned int y = first[1] ; y <= last[1] ; ++y) {
+                for(unsigned int x = first[0] ; x <= last[0] ; ++x) {
+                    function((z * resolution[1] + y) * resolution[0] + x);
+                }
+            }
+        }
+    };
+
+    cellStarts.assign(gridCellCount + 2, 0);
+    for(unsigned int i = 0 ; i < lights.size() ; ++i) {
+        forEachCell(i, [this](unsigned int cell) { ++cellStarts[cell + 1]; });
+    }
+    for(unsigned int i = 0 ; i <= gridCellCount ; ++i) { cellStarts[i + 1] += cellStarts[i]; }
+
+    std::vector<unsigned int> cellEnds(cellStarts.begin(), cellStarts.end() - 1);
+    cellLights.resize(cellStarts.back());
+    for(unsigned int i = 0 ; i < lights.size() ; ++i) {
+        forEachCell(i, [this, &cellEnds, i](unsigned int cell) { cellLights[cellEnds[cell]++] = i; });
+    }
+
+    buildAliasTables(lights);
+}
+
+std::span<const unsigned int> LightGrid::getLights(const Point& point) const {
+    const unsigned int cell = findCell(point);
+    return { cellLights.data() + cellStarts[cell], cellLights.data() + cellStarts[cell + 1] };
+}
+
+unsigned int LightGrid::sampleLight(const Point& point, float u, float& probability) const {
+    const unsigned int cell = findCell(point);
+    const unsigned int first = cellStarts[cell];
+    const unsigned int count = cellStarts[cell + 1] - first;
+    if(count == 0) { return -1u; }
+
+    // The integer part of u * count picks an entry, its fractional part the entry's light or its alias
+    const float scaled = u * count;
+    const unsigned int entry = std::min(static_cast<unsigned int>(scaled), count - 1);
+    const AliasEntry& alias = aliases[first + entry];
+    const unsigned int chosen = scaled - entry < alias.threshold ? entry : alias.alias;
+
+    probability = aliases[first + chosen].probability;
+    return probability > 0.0f ? cellLights[first + chosen] : -1u;
+}
+
+unsigned int LightGrid::getBoundedLightCount() const {
+    return boundedLightCount;
+}
+
+unsigned int LightGrid::getResolution(unsigned int axis) const {
+    return resolution[axis];
+}
+
+unsigned int LightGrid::findCell(const Point& point) const {
+    const unsigned int gridCellCount = cellStarts.size() - 2;
+    if(gridCellCount == 0) { return 0; }
+
+    // Outside of the grid, only the lights lighting up the whole scene remain
+    const float coordinates[3]{ point.x, point.y, point.z };
+    for(unsigned int axis = 0 ; axis < 3 ; ++axis) {
+        if(!(coordinates[axis] >= pmin[axis] && coordinates[axis] <= pmax[axis])) { return gridCellCount; }
+    }
+
+    return (getCell(point.z, 2) * resolution[1] + getCell(point.y, 1)) * resolution[0] + getCell(point.x, 0);
+}
+
+unsigned int LightGrid::getCell(float coordinate, unsigned int axis) const {
+    const float cell = (coordinate - pmin[axis]) * inverseCellSize[axis];
+    return std::min(static_cast<unsigned int>(std::max(cell, 0.0f)), resolution[axis] - 1);
+}
+
+void LightGrid::buildAliasTables(std::span<const Light* const> lights) {
+    std::vector<float> powers(lights.size());
+    for(unsigned int i = 0 ; i < lights.size() ; ++i) { powers[i] = std::max(lights[i]->getPower(), 0.0f); }
+
+    aliases.resize(cellLights.size());
+    std::vector<float> scaled;
+    std::vector<unsigned int> small, large;
+
+    for(unsigned int cell = 0 ; cell + 1 < cellStarts.size() ; ++cell) {
+        const unsigned int first = cellStarts[cell];
+        const unsigned int count = cellStarts[cell + 1] - first;
+
+        float total = 0.0f;
+        for(unsigned int i = 0 ; i < count ; ++i) { total += powers[cellLights[first + i]]; }
+
+        // The entries of a cell whose lights have no power all have a null probability, which is never sampled
+        if(total == 0.0f) {
+            for(unsigned int i = 0 ; i < count ; ++i) { aliases[first + i] = { 1.0f, i, 0.0f }; }
+            continue;
+        }
+
+        // Every entry gets the average probability, made of its light's and of a light above the average
+        scaled.resize(count);
+        small.clear();
+        large.clear();
+        for(unsigned int i = 0 ; i < count ; ++i) {
+            const float power = powers[cellLights[first + i]];
+            aliases[first + i] = { 1.0f, i, power / total };
+            scaled[i] = power * count / total;
+            (scaled[i] < 1.0f ? small : large).push_back(i);
+        }
+
+        while(!small.empty() && !large.empty()) {
+            const unsigned int less = small.back(), more = large.back();
+            small.pop_back();
+
+            aliases[first + less].threshold = scaled[less];
+            aliases[first + less].alias = more;
+            scaled[more] -= 1.0f - scaled[less];
+            if(scaled[more] < 1.0f) {
+                large.pop_back();
+                small.push_back(more);
+            }
+        }
+
+        // The entries left by the rounding errors have almost the average probability, they keep their light
+    }
+}
@@ -0,0 +1,81 @@
+/***************************************************************************************************
+ * @file  MaterialTable.cpp
+ * @brief Implementation of the MaterialTable class
+ **************************************************************************************************/
+
+#include "synthese/MaterialTable.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "synthese/Statistics.hpp"
+#include "utility.hpp"
+
+MaterialTable::MaterialTable() {
+    add(White());
+}
+
+MaterialID MaterialTable::add(const Color& color) {
+    const std::array<float, 4> key{ color.r, color.g, color.b, color.a };
+
+    auto constant = constants.find(key);
+    if(constant != constants.end()) { return constant->second; }
+
+    MaterialID material = add(Entry{ Type::Constant, color, Color(), Point(), Vector(), 0 });
+    constants.emplace(key, material);
+
+    return material;
+}
+
+MaterialID MaterialTable::add(const ColorFunc& getColor) {
+    MaterialID material = add(Entry{ Type::Procedural, Color(), Color(), Point(), Vector(), 0 });
+    entries[material].procedural = procedurals.size();
+    procedurals.push_back(getColor);
+
+    return material;
+}
+
+MaterialID MaterialTable::addChecker(const Color& even, const Color& odd) {
+    return add(Entry{ Type::Checker, even, odd, Point(), Vector(), 0 });
+}
+
+MaterialID MaterialTable::addGradient(const Point& start, const Point& end, const Color& startColor,
+                                      const Color& endColor) {
+    Vector segment = end - start;
+    if(length2(segment) == 0.0f) { throw std::invalid_argument("A gradient needs two distinct points."); }
+
+    return add(Entry{ Type::Gradient, startColor, endColor, start, segment / length2(segment), 0 });
+}
+
+std::vector<MaterialID> MaterialTable::add(const Materials& materials) {
+    std::vector<MaterialID> ids;
+    ids.reserve(materials.count());
+    for(int i = 0 ; i < materials.count() ; ++i) { ids.push_back(add(materials.material(i).diffuse)); }
+
+    return ids;
+}
+
+uint MaterialTable::getMaterialCount() const {
+    return entries.size();
+}
+
+MaterialID MaterialTable::add(const Entry& entry) {
+    if(entries.size() >= meshMaterials) { throw std::runtime_error("Too many materials."); }
+
+    entries.push_back(entry);
+    return entries.size() - 1;
+}
+
+Color MaterialTable::evaluatePattern(const Entry& entry, const Point& point) const {
+    switch(entry.type) {
+        case Type::Checker:
+            return std::fmod(std::floor(point.x) + std::floor(point.z), 2.0f) == 0.0f ? entry.color : entry.otherColor;
+        case Type::Gradient:
+            return lerp(entry.color, entry.otherColor, std::clamp(dot(point - entry.origin, entry.axis), 0.0f, 1.0f));
+        case Type::Procedural:
+            SYNTHESE_COUNT(proceduralEvaluations, 1);
+            return procedurals[entry.procedural](point);
+        default:
+            return entry.color;
+    }
+}
@@ -0,0 +1,150 @@
+/***************************************************************************************************
+ * @file  MeshCache.cpp
+ * @brief Implementation of the MeshCache class
+ **************************************************************************************************/
+
+#include "synthese/MeshCache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "files.h"
+
+static_assert(std::is_trivially_copyable_v<Point> && std::is_trivially_copyable_v<BVH::Node>);
+
+MeshCache::MeshCache() : data(nullptr), size(0) { }
+
+MeshCache::~MeshCache() {
+    close();
+}
+
+std::string MeshCache::getPath(const std::string& meshPath, bool smooth) {
+    return meshPath + (smooth ? ".smooth.cache" : ".flat.cache");
+}
+
+bool MeshCache::open(const std::string& meshPath, bool smooth, BVH::BuildMethod method) {
+    close();
+
+    const size_t meshTimestamp = timestamp(meshPath);
+    if(meshTimestamp == 0) { return false; }
+
+    int file = ::open(getPath(meshPath, smooth).c_str(), O_RDONLY);
+    if(file < 0) { return false; }
+
+    struct stat info;
+    if(fstat(file, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        ::close(file);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file); // The mapping stays valid
+    if(mapping == MAP_FAILED) { return false; }
+
+    data = static_cast<const char*>(mapping);
+    size = info.st_size;
+    const Header* header = reinterpret_cast<const Header*>(data);
+
+    const size_t expectedSize = sizeof(Header) + header->positionCount * sizeof(Point)
+                                + header->indexCount * sizeof(uint) + header->normalCount * sizeof(Vector)
+                                + header->nodeCount * sizeof(BVH::Node) + header->primitiveIndexCount * sizeof(uint);
+
+    if(std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version
+       || header->nodeSize != sizeof(BVH::Node) || header->timestamp != meshTimestamp
+       || header->smooth != smooth || header->buildMethod != static_cast<uint32_t>(method) || size != expectedSize) {
+        close();
+        return false;
+    }
+
+    size_t offset = sizeof(Header);
+    positions = getArray<Point>(offset, header->positionCount);
+    indices = getArray<uint>(offset, header->indexCount);
+    normals = getArray<Vector>(offset, header->normalCount);
+    nodes = getArray<BVH::Node>(offset, header->nodeCount);
+    primitiveIndices = getArray<uint>(offset, header->primitiveIndexCount);
+
+    return true;
+}
+
+void MeshCache::close() {
+    if(data != nullptr) { munmap(const_cast<char*>(data), size); }
+
+    data = nullptr;
+    size = 0;
+    positions = {};
+    indices = {};
+    normals = {};
+    nodes = {};
+    primitiveIndices = {};
+}
+
+std::span<const Point> MeshCache::getPositions() const {
+    return positions;
+}
+
+std::span<const uint> MeshCache::getIndices() const {
+    return indices;
+}
+
+std::span<const Vector> MeshCache::getNormals() const {
+    return normals;
+}
+
+std::span<const BVH::Node> MeshCache::getNodes() const {
+    return nodes;
+}
+
+std::span<const uint> MeshCache::getPrimitiveIndices() const {
+    return primitiveIndices;
+}
+
+bool MeshCache::write(const std::string& meshPath, bool smooth, std::span<const Point> positions,
+                      std::span<const uint> indices, std::span<const Vector> normals, const BVH& bvh) {
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.nodeSize = sizeof(BVH::Node);
+    header.timestamp = timestamp(meshPath);
+    header.smooth = smooth;
+    header.buildMethod = static_cast<uint32_t>(bvh.getBuildMethod());
+    header.positionCount = positions.size();
+    header.indexCount = indices.size();
+    header.normalCount = normals.size();
+    header.nodeCount = bvh.getNodes().size();
+    header.primitiveIndexCount = bvh.getPrimitiveIndices().size();
+    if(header.timestamp == 0) { return false; }
+
+    const std::string path = getPath(meshPath, smooth);
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(positions.data()), positions.size_bytes());
+        file.write(reinterpret_cast<const char*>(indices.data()), indices.size_bytes());
+        file.write(reinterpret_cast<const char*>(normals.data()), normals.size_bytes());
+        file.write(reinterpret_cast<const char*>(bvh.getNodes().data()), bvh.getNodes().size_bytes());
+        file.write(reinterpret_cast<const char*>(bvh.getPrimitiveIndices().data()),
+                   bvh.getPrimitiveIndices().size_bytes());
+        if(!file) {
+            std::error_code error;
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
+
+template<typename T>
+std::span<const T> MeshCache::getArray(size_t& offset, uint32_t count) const {
+    std::span<const T> array(reinterpret_cast<const T*>(data + offset), count);
+    offset += array.size_bytes();
+    return array;
+}
@@ -0,0 +1,242 @@
+/***************************************************************************************************
+ * @file  MeshStore.cpp
+ * @brief Implementation of the MeshStore class
+ **************************************************************************************************/
+
+#include "synthese/MeshStore.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include "synthese/Statistics.hpp"
+#include "utility.hpp"
+
+Mesh::Mesh(const MeshStore& store, uint firstTriangle, uint triangleCount, uint firstVertex, uint firstNormal)
+    : store(store),
+      firstTriangle(firstTriangle), triangleCount(triangleCount), firstVertex(firstVertex), firstNormal(firstNormal),
+      bvh(*this) { }
+
+uint Mesh::getPrimitiveCount() const {
+    return triangleCount;
+}
+
+Point Mesh::getCentroid(uint primitive) const {
+    return store.getCentroid(firstTriangle + primitive);
+}
+
+void Mesh::compareBoundingBox(uint primitive, Point& pmin, Point& pmax) const {
+    store.compareBoundingBox(firstTriangle + primitive, pmin, pmax);
+}
+
+void Mesh::intersect(const uint* primitives, uint count, const Ray& ray, Hit& closest) const {
+    SYNTHESE_COUNT(primitivesTested, count);
+
+    for(uint i = 0 ; i < count ; ++i) {
+        const uint triangle = firstTriangle + primitives[i];
+        float t, u, v;
+
+        if(store.intersect(triangle, ray, t, u, v) && t < closest.intersection && ray.contains(t)) {
+            SYNTHESE_COUNT(intersectionsFound, 1);
+            closest.intersection = t;
+            closest.u = u;
+            closest.v = v;
+            closest.object = nullptr;
+            closest.primitive = triangle;
+        }
+    }
+}
+
+void Mesh::intersect(const uint* primitives, uint count, const Ray* rays, uint64_t mask, Hit* closest) const {
+    for(; mask != 0 ; mask &= mask - 1) {
+        const uint i = std::countr_zero(mask);
+        intersect(primitives, count, rays[i], closest[i]);
+    }
+}
+
+bool Mesh::occluded(const uint* primitives, uint count, const Ray& ray, float tMax) const {
+    for(uint i = 0 ; i < count ; ++i) {
+        float t, u, v;
+        SYNTHESE_COUNT(primitivesTested, 1);
+        if(store.intersect(firstTriangle + primitives[i], ray, t, u, v) && t < tMax && ray.contains(t)) {
+            SYNTHESE_COUNT(intersectionsFound, 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint MeshStore::add(std::span<const Point> positions, std::span<const uint> indices, std::span<const Vector> normals) {
+    if(!normals.empty() && normals.size() < positions.size()) { throw std::out_of_range("Missing mesh normals."); }
+
+    const uint firstTriangle = getTriangleCount();
+    const uint firstVertex = positionsX.size();
+    uint firstNormal = -1u;
+
+    positionsX.reserve(positionsX.size() + positions.size());
+    positionsY.reserve(positionsY.size() + positions.size());
+    positionsZ.reserve(positionsZ.size() + positions.size());
+    for(const Point& position : positions) {
+        positionsX.push_back(position.x);
+        positionsY.push_back(position.y);
+        positionsZ.push_back(position.z);
+    }
+
+    if(!normals.empty()) {
+        firstNormal = normalsX.size();
+
+        normalsX.reserve(normalsX.size() + positions.size());
+        normalsY.reserve(normalsY.size() + positions.size());
+        normalsZ.reserve(normalsZ.size() + positions.size());
+        for(unsigned int i = 0 ; i < positions.size() ; ++i) {
+            normalsX.push_back(normals[i].x);
+            normalsY.push_back(normals[i].y);
+            normalsZ.push_back(normals[i].z);
+        }
+    }
+
+    this->indices.reserve(this->indices.size() + indices.size() - indices.size() % 3);
+    for(unsigned int i = 0 ; i + 2 < indices.size() ; i += 3) {
+        for(unsigned int j = 0 ; j < 3 ; ++j) {
+            if(indices[i + j] >= positions.size()) { throw std::out_of_range("Mesh index out of range."); }
+            this->indices.push_back(firstVertex + indices[i + j]);
+        }
+    }
+
+    const uint triangleCount = getTriangleCount();
+    originsX.reserve(triangleCount);
+    originsY.reserve(triangleCount);
+    originsZ.reserve(triangleCount);
+    edges1X.reserve(triangleCount);
+    edges1Y.reserve(triangleCount);
+    edges1Z.reserve(triangleCount);
+    edges2X.reserve(triangleCount);
+    edges2Y.reserve(triangleCount);
+    edges2Z.reserve(triangleCount);
+    for(uint triangle = firstTriangle ; triangle < triangleCount ; ++triangle) {
+        const uint* vertices = &this->indices[3 * triangle];
+        Point A = getPosition(vertices[0]);
+        Vector edge1 = getPosition(vertices[1]) - A;
+        Vector edge2 = getPosition(vertices[2]) - A;
+
+        originsX.push_back(A.x);
+        originsY.push_back(A.y);
+        originsZ.push_back(A.z);
+        edges1X.push_back(edge1.x);
+        edges1Y.push_back(edge1.y);
+        edges1Z.push_back(edge1.z);
+        edges2X.push_back(edge2.x);
+        edges2Y.push_back(edge2.y);
+        edges2Z.push_back(edge2.z);
+    }
+
+    materials.resize(triangleCount, MaterialTable::defaultMaterial);
+
+    meshes.push_back(std::make_unique<Mesh>(*this, firstTriangle, triangleCount - firstTriangle, firstVertex,
+                                            firstNormal));
+
+    return meshes.size() - 1;
+}
+
+void MeshStore::setMaterials(uint mesh, std::span<const MaterialID> materials) {
+    const Mesh& target = getMesh(mesh);
+    if(materials.size() != target.triangleCount) {
+        throw std::invalid_argument("A mesh needs exactly one material per triangle.");
+    }
+
+    std::copy(materials.begin(), materials.end(), this->materials.begin() + target.firstTriangle);
+}
+
+MaterialID MeshStore::getMaterial(uint triangle) const {
+    return materials[triangle];
+}
+
+void MeshStore::clear() {
+    positionsX.clear();
+    positionsY.clear();
+    positionsZ.clear();
+    normalsX.clear();
+    normalsY.clear();
+    normalsZ.clear();
+    indices.clear();
+    materials.clear();
+    originsX.clear();
+    originsY.clear();
+    originsZ.clear();
+    edges1X.clear();
+    edges1Y.clear();
+    edges1Z.clear();
+    edges2X.clear();
+    edges2Y.clear();
+    edges2Z.clear();
+    meshes.clear();
+}
+
+uint MeshStore::getMeshCount() const {
+    return meshes.size();
+}
+
+uint MeshStore::getTriangleCount() const {
+    return indices.size() / 3;
+}
+
+Mesh& MeshStore::getMesh(uint mesh) {
+    return *meshes.at(mesh);
+}
+
+const Mesh& MeshStore::getMesh(uint mesh) const {
+    return *meshes.at(mesh);
+}
+
+const Mesh& MeshStore::findMesh(uint triangle) const {
+    auto next = std::upper_bound(meshes.begin(), meshes.end(), triangle,
+                                 [](uint triangle, const std::unique_ptr<Mesh>& mesh) {
+                                     return triangle < mesh->firstTriangle;
+                                 });
+
+    return **(next - 1);
+}
+
+Point MeshStore::getCentroid(uint triangle) const {
+    const uint* vertices = &indices[3 * triangle];
+    return (getPosition(vertices[0]) + getPosition(vertices[1]) + getPosition(vertices[2])) / 3.0f;
+}
+
+void MeshStore::compareBoundingBox(uint triangle, Point& pmin, Point& pmax) const {
+    const uint* vertices = &indices[3 * triangle];
+    for(uint i = 0 ; i < 3 ; ++i) {
+        Point position = getPosition(vertices[i]);
+        pmin = min3(pmin, position);
+        pmax = max3(pmax, position);
+    }
+}
+
+bool MeshStore::intersect(uint triangle, const Ray& ray, float& t, float& u, float& v) const {
+    return intersectTriangle(ray.origin, ray.direction,
+                             Point(originsX[triangle], originsY[triangle], originsZ[triangle]),
+                             Vector(edges1X[triangle], edges1Y[triangle], edges1Z[triangle]),
+                             Vector(edges2X[triangle], edges2Y[triangle], edges2Z[triangle]),
+                             t, u, v);
+}
+
+Vector MeshStore::getNormal(uint triangle, float u, float v) const {
+    const Mesh& mesh = findMesh(triangle);
+
+    if(mesh.firstNormal == -1u) {
+        return normalize(cross(Vector(edges1X[triangle], edges1Y[triangle], edges1Z[triangle]),
+                               Vector(edges2X[triangle], edges2Y[triangle], edges2Z[triangle])));
+    }
+
+    const uint* vertices = &indices[3 * triangle];
+    const uint offset = mesh.firstNormal - mesh.firstVertex;
+    const uint a = vertices[0] + offset, b = vertices[1] + offset, c = vertices[2] + offset;
+    const float w = 1.0f - u - v;
+
+    return normalize(Vector(w * normalsX[a] + u * normalsX[b] + v * normalsX[c],
+                            w * normalsY[a] + u * normalsY[b] + v * normalsY[c],
+                            w * normalsZ[a] + u * normalsZ[b] + v * normalsZ[c]));
+}
+
+Point MeshStore::getPosition(uint vertex) const {
+    return Point(positionsX[vertex], positionsY[vertex], positionsZ[vertex]);
+}
@@ -8,47 +8,36 @@
 #include <cmath>
 #include "utility.hpp"
 
-Object::Object(const Color& color) : getColor([color](const Point&) { return color; }) { }
+Object::Object(MaterialID material) : material(material) { }
 
-Object::Object(const ColorFunc& getColor) : getColor(getColor) { }
-
-Plane::Plane(const Color& color, const Point& point, const Vector& normal)
-    : Object(color), point(point), normal(normalize(normal)) { }
-
-Plane::Plane(const ColorFunc& getColor, const Point& point, const Vector& normal)
-    : Object(getColor), point(point), normal(normalize(normal)) { }
+Plane::Plane(MaterialID material, const Point& point, const Vector& normal)
+    : Object(material), point(point), normal(normalize(normal)) { }
 
 ObjectType Plane::getType() const {
     return ObjectType::Plane;
 }
 
-Hit Plane::intersect(const Ray& ray) const {
-    Hit hit;
-
-    hit.intersection = dot(normal, point - ray.origin) / dot(normal, ray.direction);
-    if(hit.intersection < 0.0f) { return Hit(); }
-    hit.normal = normal;
+bool Plane::intersect(const Ray& ray, float& t, float&, float&) const {
+    t = dot(normal, point - ray.origin) / dot(normal, ray.direction);
+    return !(t < ray.tMin || t > ray.tMax);
+}
 
-    return hit;
+Vector Plane::getNormal(const Point&, float, float) const {
+    return normal;
 }
 
 Point Plane::getCentroid() const { return point; }
 
 void Plane::compareBoundingBox(Point& pmin, Point& pmax) const { }
 
-Sphere::Sphere(const Color& color, const Point& center, float radius)
-    : Object(color), center(center), radius(radius) { }
-
-Sphere::Sphere(const ColorFunc& getColor, const Point& center, float radius)
-    : Object(getColor), center(center), radius(radius) { }
+Sphere::Sphere(MaterialID material, const Point& center, float radius)
+    : Object(material), center(center), radius(radius) { }
 
 ObjectType Sphere::getType() const {
     return ObjectType::Sphere;
 }
 
-Hit Sphere::intersect(const Ray& ray) const {
-    Hit hit;
-
+bool Sphere::intersect(const Ray& ray, float& t, float&, float&) const {
     Vector co(center, ray.origin);
 
     // float a = dot(ray.direction, ray.direction); // ray.direction is normalized so this always equals 1
@@ -57,18 +46,20 @@ Hit Sphere::intersect(const Ray& ray) const {
 
     float delta = std::sqrt(b * b - 4.0f * c);
 
-    if(delta < 0.0f) { return Hit(); }
+    if(delta < 0.0f) { return false; }
 
     float x1 = (-b + delta) / 2.0f;
     float x2 = (-b - delta) / 2.0f;
 
-    if(x1 >= 0.0f) { hit.intersection = x1; }
-    if(x2 >= 0.0f && x2 < hit.intersection) { hit.intersection = x2; }
-    if(hit.intersection == infinity) { return Hit(); }
+    t = infinity;
+    if(ray.contains(x1)) { t = x1; }
+    if(ray.contains(x2) && x2 < t) { t = x2; }
 
-    hit.normal = normalize(ray.getPoint(hit.intersection) - center);
+    return t != infinity;
+}
 
-    return hit;
+Vector Sphere::getNormal(const Point& point, float, float) const {
+    return normalize(point - center);
 }
 
 Point Sphere::getCentroid() const {
@@ -81,30 +72,19 @@ void Sphere::compareBoundingBox(Point& pmin, Point& pmax) const {
     pmax = max3(pmax, center + r);
 }
 
-Triangle::Triangle(const Color& color, const Point& A, const Point& B, const Point& C)
-    : Object(color), A(A), B(B), C(C) { }
-
-Triangle::Triangle(const ColorFunc& getColor, const Point& A, const Point& B, const Point& C)
-    : Object(getColor), A(A), B(B), C(C) { }
+Triangle::Triangle(MaterialID material, const Point& A, const Point& B, const Point& C)
+    : Object(material), A(A), B(B), C(C), edge1(B - A), edge2(C - A), normal(normalize(cross(edge1, edge2))) { }
 
 ObjectType Triangle::getType() const {
     return ObjectType::Triangle;
 }
 
-Hit Triangle::intersect(const Ray& ray) const {
-    Hit hit;
-
-    hit.normal = normalize(cross(B - A, C - A));
-    hit.intersection = dot(hit.normal, A - ray.origin) / dot(hit.normal, ray.direction);
-
-    if(hit.intersection < 0.0f) { return Hit(); }
-    Point point = ray.getPoint(hit.intersection);
-
-    if(dot(hit.normal, cross(B - A, point - A)) < 0.0f) { return Hit(); }
-    if(dot(hit.normal, cross(C - B, point - B)) < 0.0f) { return Hit(); }
-    if(dot(hit.normal, cross(A - C, point - C)) < 0.0f) { return Hit(); }
+bool Triangle::intersect(const Ray& ray, float& t, float& u, float& v) const {
+    return intersectTriangle(ray.origin, ray.direction, A, edge1, edge2, t, u, v) && ray.contains(t);
+}
 
-    return hit;
+Vector Triangle::getNormal(const Point&, float, float) const {
+    return normal;
 }
 
 Point Triangle::getCentroid() const {
@@ -120,43 +100,19 @@ void Triangle::compareBoundingBox(Point& pmin, Point& pmax) const {
     pmax = max3(pmax, C);
 }
 
-MeshTriangle::MeshTriangle(const Color& color, const Vertex& A, const Vertex& B, const Vertex& C)
-    : Object(color), A(A), B(B), C(C) { }
-
-MeshTriangle::MeshTriangle(const ColorFunc& getColor, const Vertex& A, const Vertex& B, const Vertex& C)
-    : Object(getColor), A(A), B(B), C(C) { }
+MeshTriangle::MeshTriangle(MaterialID material, const Vertex& A, const Vertex& B, const Vertex& C)
+    : Object(material), A(A), B(B), C(C), edge1(B.position - A.position), edge2(C.position - A.position) { }
 
 ObjectType MeshTriangle::getType() const {
     return ObjectType::MeshTriangle;
 }
 
-Hit MeshTriangle::intersect(const Ray& ray) const {
-    Hit hit;
-
-    hit.normal = cross(B.position - A.position, C.position - A.position);
-    float area2 = length(hit.normal); // 2 times the area of triangle ABC
-    hit.normal = hit.normal / area2;
-
-    hit.intersection = dot(hit.normal, A.position - ray.origin) / dot(hit.normal, ray.direction);
-
-    if(hit.intersection < 0.0f) { return Hit(); }
-
-    Point point = ray.getPoint(hit.intersection);
-
-    Vector BCP = cross(C.position - B.position, point - B.position);
-    Vector CAP = cross(A.position - C.position, point - C.position);
-
-    if(dot(hit.normal, cross(B.position - A.position, point - A.position)) < 0.0f) { return Hit(); }
-    if(dot(hit.normal, BCP) < 0.0f) { return Hit(); }
-    if(dot(hit.normal, CAP) < 0.0f) { return Hit(); }
-
-    float u = length(BCP) / area2;
-    float v = length(CAP) / area2;
-    float w = 1.0f - u - v;
-
-    hit.normal = normalize(u * A.normal + v * B.normal + w * C.normal);
+bool MeshTriangle::intersect(const Ray& ray, float& t, float& u, float& v) const {
+    return intersectTriangle(ray.origin, ray.direction, A.position, edge1, edge2, t, u, v) && ray.contains(t);
+}
 
-    return hit;
+Vector MeshTriangle::getNormal(const Point&, float u, float v) const {
+    return normalize((1.0f - u - v) * A.normal + u * B.normal + v * C.normal);
 }
 
 Point MeshTriangle::getCentroid() const {
@@ -5,7 +5,27 @@
 
 #include "synthese/Ray.hpp"
 
-Ray::Ray(const Point& origin, const Vector& direction) : origin(origin), direction(direction) { }
+#include <cmath>
+
+/**
+ * @brief Computes the inverse of a direction's component. Null components are replaced by a tiny value of the same
+ * sign, so that a slab test never multiplies 0 by infinity and never produces NaN, even when the ray's origin lies on
+ * the plane of a bounding box.
+ * @param component The component.
+ * @return Its inverse.
+ */
+static float inverse(float component) {
+    static constexpr float epsilon = 1e-20f;
+    return 1.0f / (std::abs(component) > epsilon ? component : std::copysign(epsilon, component));
+}
+
+Ray::Ray() : Ray(Point(), Vector()) { }
+
+Ray::Ray(const Point& origin, const Vector& direction, float tMin, float tMax)
+    : origin(origin), direction(direction),
+      inverseDirection(inverse(direction.x), inverse(direction.y), inverse(direction.z)),
+      sign{ std::signbit(inverseDirection.x), std::signbit(inverseDirection.y), std::signbit(inverseDirection.z) },
+      tMin(tMin), tMax(tMax) { }
 
 Point Ray::getPoint(float t) const {
     return origin + t * direction;
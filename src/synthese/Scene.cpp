@@ -5,51 +5,201 @@
 
 #include "synthese/Scene.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <chrono>
-#include <mutex>
-#include <thread>
-#include "image_io.h"
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
 #include "mesh_io.h"
+#include "synthese/ImageStream.hpp"
+#include "synthese/MeshCache.hpp"
 #include "utility.hpp"
 
-Scene::Scene(const std::string& name)
+/**
+ * @brief Computes the position of the samples of an antialiased pixel relative to its center. 4 samples are placed on a
+ * rotated grid, other amounts on a rank-1 lattice, so that no two samples share a row or a column.
+ * @param count The amount of samples.
+ * @return The position of each sample.
+ */
+static std::vector<vec2> getSampleOffsets(unsigned int count) {
+    if(count == 4) {
+        return { vec2(0.125f, 0.375f), vec2(-0.125f, -0.375f), vec2(-0.375f, 0.125f), vec2(0.375f, -0.125f) };
+    }
+
+    // The generator is close to the golden ratio of the count, which spreads the samples evenly
+    unsigned int generator = std::max(1u, static_cast<unsigned int>(std::lround(0.618034f * count)));
+    while(std::gcd(generator, count) != 1) { ++generator; }
+
+    std::vector<vec2> offsets(count);
+    for(unsigned int i = 0 ; i < count ; ++i) {
+        offsets[i] = vec2((i + 0.5f) / count - 0.5f, (i * generator % count + 0.5f) / count - 0.5f);
+    }
+
+    return offsets;
+}
+
+Scene::Scene(const std::string& name, unsigned int threadCount)
     : name(name),
-      globalRow(0),
-      bvh(objects),
+      threadPool(threadCount),
+      nextTile(0), tileSize(32), rayPacketSize(8),
+      antialiasing(Antialiasing::Fixed), sampleOffsets(getSampleOffsets(4)), adaptiveThreshold(0.05f),
+      lightSampling(LightSampling::All), lightSampleCount(1), pipeline(Pipeline::PerSample),
+      cameraRayCount(0), statistics{ 0.0f, 0.0f, 0, Statistics() }, verbose(true),
+      imageFormat(ImageWriter::Format::PNG), compressionLevel(Deflate::defaultLevel),
+      meshCaching(true),
+      bvh(geometry), bvhOutdated(true), bvhMoved(false),
       lowSkyColor(0.671f, 0.851f, 1.0f), highSkyColor(0.239f, 0.29f, 0.761f) { }
 
 Scene::~Scene() {
     for(const Light* light : lights) { delete light; }
-    for(const Object* object : objects) { delete object; }
     for(const Plane* plane : planes) {delete plane;}
 }
 
 void Scene::render(unsigned int width, unsigned int height) {
+    renderToFile("data/synthese/" + name + ImageWriter::getExtension(imageFormat), width, height);
+}
+
+Image Scene::renderImage(unsigned int width, unsigned int height) {
     if(width == 0 || height == 0) { throw std::runtime_error("Cannot render to an empty image."); }
 
-    std::cout << "Rendering scene \"" << name << "\" to a " << width << " by " << height << " image.\n";
-    printSceneInfo();
+    Image image(width, height);
+    renderTiles(width, height, false, [&image](const Tile& tile, const Color* pixels) {
+        for(unsigned int y = 0 ; y < tile.rows ; ++y) {
+            const Color* tileRow = pixels + y * tile.columns;
+            std::copy(tileRow, tileRow + tile.columns, &image(tile.firstColumn, tile.firstRow + y));
+        }
+    });
 
-    bvh.initialize();
+    return image;
+}
+
+void Scene::renderAnimation(unsigned int width, unsigned int height, unsigned int frameCount, float frameRate) {
+    if(!(frameRate > 0.0f)) { throw std::invalid_argument("The frame rate must be positive."); }
+
+    for(unsigned int frame = 0 ; frame < frameCount ; ++frame) {
+        setTime(frame / frameRate);
+
+        std::ostringstream path;
+        path << "data/synthese/" << name << '_' << std::setfill('0') << std::setw(4) << frame
+             << ImageWriter::getExtension(imageFormat);
+        renderToFile(path.str(), width, height);
+    }
+}
+
+void Scene::renderToFile(const std::string& path, unsigned int width, unsigned int height) {
+    if(width == 0 || height == 0) { throw std::runtime_error("Cannot render to an empty image."); }
+
+    // The bands are compressed by the render thread writing them: the other threads are still busy tracing
+    ImageWriter writer(path, width, height, 4, compressionLevel, 1);
+    // Two more bands than threads, so that a thread rarely waits for the band on top of the ring to be written
+    ImageStream stream(writer, width, height, tileSize, threadPool.getThreadCount() + 2);
+
+    renderTiles(width, height, true, [&stream](const Tile& tile, const Color* pixels) {
+        stream.add(tile.firstColumn, tile.firstRow, tile.columns, tile.rows, pixels);
+    });
+    stream.finish();
+}
+
+void Scene::renderTiles(unsigned int width, unsigned int height, bool byBands, const TileStore& store) {
+    if(verbose) {
+        std::cout << "Rendering scene \"" << name << "\" to a " << width << " by " << height << " image.\n";
+        printSceneInfo();
+    }
+
+    const std::chrono::time_point buildStartTime(std::chrono::high_resolution_clock::now());
+    geometry.initialize(bvh.getBuildMethod(), bvh.getLayout(), &threadPool);
+
+    // Moving instances keeps the primitives of the top level BVH, whose tree only needs new bounds
+    const bool rebuilt = bvhOutdated;
+    const bool refitted = !bvhOutdated && bvhMoved;
+    if(rebuilt) {
+        bvh.initialize(&threadPool);
+    } else if(refitted) {
+        bvh.refit(&threadPool);
+    }
+    bvhOutdated = bvhMoved = false;
+
+    lightGrid.build(lights);
+    std::chrono::duration<float> buildDuration = std::chrono::high_resolution_clock::now() - buildStartTime;
+
+    if(verbose && !rebuilt) {
+        std::cout << '\t' << (refitted ? "Refitted" : "Kept") << " the top level BVH of " << bvh.getNodeCount()
+                  << " nodes in " << buildDuration.count() << "s (SAH cost: " << bvh.getSAHCost() << ").\n";
+    } else if(verbose) {
+        const MeshStore& meshStore = geometry.getMeshStore();
+        uint meshNodeCount = 0;
+        for(uint i = 0 ; i < meshStore.getMeshCount() ; ++i) {
+            meshNodeCount += meshStore.getMesh(i).bvh.getNodeCount();
+        }
+
+        std::cout << "\tBuilt " << meshStore.getMeshCount() << " mesh BVH" << (meshStore.getMeshCount() > 1 ? "s" : "")
+                  << " of " << meshNodeCount << " nodes in total and a top level BVH of " << bvh.getNodeCount() << ' ';
+        switch(bvh.getLayout()) {
+            case BVH::Layout::Binary: std::cout << "binary";
+                break;
+            case BVH::Layout::Wide4: std::cout << "4-wide";
+                break;
+            case BVH::Layout::Wide8: std::cout << "8-wide";
+                break;
+        }
+        std::cout << " nodes in " << buildDuration.count() << "s using the ";
+        switch(bvh.getBuildMethod()) {
+            case BVH::BuildMethod::Midpoint: std::cout << "midpoint";
+                break;
+            case BVH::BuildMethod::SAH: std::cout << "SAH";
+                break;
+            case BVH::BuildMethod::LBVH: std::cout << "LBVH";
+                break;
+            case BVH::BuildMethod::TRBVH: std::cout << "TRBVH";
+                break;
+        }
+        std::cout << " builder (SAH cost: " << bvh.getSAHCost() << " for the top level).\n";
+    }
+
+    if(verbose && lightGrid.getBoundedLightCount() > 0) {
+        std::cout << "\tIndexed " << lightGrid.getBoundedLightCount() << " bounded light"
+                  << (lightGrid.getBoundedLightCount() > 1 ? "s" : "") << " in a " << lightGrid.getResolution(0)
+                  << " by " << lightGrid.getResolution(1) << " by " << lightGrid.getResolution(2) << " grid.\n";
+    }
 
-    Image image(width, height);
-    std::vector<std::thread> threads;
     const std::chrono::time_point startTime(std::chrono::high_resolution_clock::now());
 
-    unsigned int threadCount = std::thread::hardware_concurrency();
-    globalRow = 0;
+    unsigned int threadCount = threadPool.getThreadCount();
+    orderTiles(width, height, byBands);
+    nextTile = 0;
+    cameraRayCount = 0;
+    statistics.counters = Statistics();
 
-    std::cout << "\tDispatching " << threadCount << " threads...\n";
+    if(verbose) {
+        std::cout << "\tDispatching " << threadCount << " threads over " << tileOrder.size() << " tiles of "
+                  << tileSize << " by " << tileSize << " pixels"
+                  << (pipeline == Pipeline::Wavefront ? " with the wavefront pipeline" : "") << "...\n";
+    }
+    tileBuffers.resize(threadCount);
+    ThreadPool::TaskGroup group;
     for(unsigned int i = 0 ; i < threadCount ; ++i) {
-        threads.emplace_back(&Scene::computeImage, this, std::ref(image));
+        threadPool.run(group, [this, width, height, &store, i] { computeImage(width, height, tileBuffers[i], store); });
     }
-
-    for(std::thread& thread : threads) { thread.join(); }
+    threadPool.wait(group);
 
     std::chrono::duration<float> duration = std::chrono::high_resolution_clock::now() - startTime;
-    std::cout << "The image took " << duration.count() << "s to compute.\n\n";
+    statistics.buildDuration = buildDuration.count();
+    statistics.renderDuration = duration.count();
+    statistics.cameraRayCount = cameraRayCount;
 
-    write_image(image, ("data/synthese/" + name + ".png").c_str());
+    if(verbose) {
+        std::cout << '\t' << (antialiasing == Antialiasing::Fixed ? "Fixed" : "Adaptive") << " antialiasing traced "
+                  << static_cast<float>(cameraRayCount) / (width * height) << " camera rays per pixel on average.\n";
+        if(Statistics::enabled) { statistics.counters.print(std::cout); }
+        std::cout << "The image took " << duration.count() << "s to compute.\n\n";
+    }
+}
+
+const Scene::RenderStatistics& Scene::getRenderStatistics() const {
+    return statistics;
 }
 
 void Scene::add(const Light* light) {
@@ -57,96 +207,209 @@ void Scene::add(const Light* light) {
 }
 
 void Scene::add(const Object* object) {
-    objects.push_back(object);
+    geometry.add(object);
+    bvhOutdated = true;
 }
 
 void Scene::add(const Plane* plane) {
+    geometry.checkMaterial(plane->material);
     planes.push_back(plane);
 }
 
-void Scene::add(const std::string& meshPath, const mat4& transform, const ColorFunc& getColor, bool smooth) {
-    if(smooth) {
-        MeshIOData data;
-        read_meshio_data(meshPath.c_str(), data);
-        add(data, transform, getColor, smooth);
+MaterialID Scene::addMaterial(const Color& color) {
+    return geometry.getMaterials().add(color);
+}
+
+MaterialID Scene::addMaterial(const ColorFunc& getColor) {
+    return geometry.getMaterials().add(getColor);
+}
+
+MaterialID Scene::addCheckerMaterial(const Color& even, const Color& odd) {
+    return geometry.getMaterials().addChecker(even, odd);
+}
+
+MaterialID Scene::addGradientMaterial(const Point& start, const Point& end, const Color& startColor,
+                                      const Color& endColor) {
+    return geometry.getMaterials().addGradient(start, end, startColor, endColor);
+}
+
+void Scene::loadMaterials(uint mesh, const std::string& meshPath) {
+    Materials loaded;
+    std::vector<int> indices;
+    if(!read_materials(meshPath.c_str(), loaded, indices)) {
+        throw std::runtime_error("Couldn't load the materials of " + meshPath + '.');
+    }
+
+    const std::vector<MaterialID> ids = geometry.getMaterials().add(loaded);
+    std::vector<MaterialID> materials(indices.size(), MaterialTable::defaultMaterial);
+    for(uint i = 0 ; i < materials.size() ; ++i) {
+        if(indices[i] >= 0) { materials[i] = ids[indices[i]]; }
+    }
+
+    geometry.getMeshStore().setMaterials(mesh, materials);
+}
+
+uint Scene::addMesh(const std::string& meshPath, bool smooth) {
+    auto loaded = loadedMeshes.find({ meshPath, smooth });
+    if(loaded != loadedMeshes.end()) { return loaded->second; }
+
+    MeshStore& meshStore = geometry.getMeshStore();
+    uint mesh;
+
+    MeshCache cache;
+    if(meshCaching && cache.open(meshPath, smooth, bvh.getBuildMethod())) {
+        mesh = meshStore.add(cache.getPositions(), cache.getIndices(), cache.getNormals());
+
+        BVH& meshBVH = meshStore.getMesh(mesh).bvh;
+        meshBVH.setBuildMethod(bvh.getBuildMethod());
+        meshBVH.load(cache.getNodes(), cache.getPrimitiveIndices());
     } else {
-        std::vector<Point> positions;
-        read_positions(meshPath.c_str(), positions);
-        add(positions, transform, getColor);
+        MeshIOData data;
+        bool loaded = smooth ? read_meshio_data(meshPath.c_str(), data)
+                             : read_indexed_positions(meshPath.c_str(), data.positions, data.indices);
+        if(!smooth) { data.normals.clear(); }
+        mesh = meshStore.add(data.positions, data.indices, data.normals);
+
+        if(meshCaching && loaded) {
+            BVH& meshBVH = meshStore.getMesh(mesh).bvh;
+            meshBVH.setBuildMethod(bvh.getBuildMethod());
+            meshBVH.initialize(&threadPool);
+
+            if(!MeshCache::write(meshPath, smooth, data.positions, data.indices, data.normals, meshBVH)) {
+                std::cerr << "Could not write the cache of mesh \"" << meshPath << "\".\n";
+            }
+        }
     }
+
+    loadedMeshes.emplace(std::make_pair(meshPath, smooth), mesh);
+    return mesh;
+}
+
+uint Scene::addMesh(const MeshIOData& data, bool smooth) {
+    return geometry.getMeshStore().add(data.positions, data.indices, smooth ? data.normals : std::vector<Vector>());
+}
+
+uint Scene::addMesh(const std::vector<Point>& positions) {
+    std::vector<uint> indices(positions.size());
+    for(unsigned int i = 0 ; i < positions.size() ; ++i) { indices[i] = i; }
+
+    return addMesh(positions, indices);
+}
+
+uint Scene::addMesh(const std::vector<Point>& positions, const std::vector<uint>& indices) {
+    return geometry.getMeshStore().add(positions, indices, {});
+}
+
+uint Scene::addInstance(uint mesh, const mat4& transform, MaterialID material) {
+    bvhOutdated = true;
+    return geometry.addInstance(mesh, transform, material);
+}
+
+uint Scene::addInstance(uint mesh, const mat4& transform, const ColorFunc& getColor) {
+    return addInstance(mesh, transform, addMaterial(getColor));
+}
+
+uint Scene::addInstance(uint mesh, const mat4& transform, const Color& color) {
+    return addInstance(mesh, transform, addMaterial(color));
+}
+
+void Scene::setInstanceTransform(uint instance, const mat4& transform) {
+    geometry.setInstanceTransform(instance, transform);
+    bvhMoved = true;
+}
+
+void Scene::animate(uint instance, const Animation& animation) {
+    if(instance >= geometry.getInstances().size()) { throw std::out_of_range("Instance index out of range."); }
+
+    animations.emplace_back(instance, animation);
+}
+
+void Scene::setTime(float time) {
+    for(const auto& [instance, animation] : animations) { setInstanceTransform(instance, animation(time)); }
+}
+
+void Scene::add(const std::string& meshPath, const mat4& transform, const ColorFunc& getColor, bool smooth) {
+    addInstance(addMesh(meshPath, smooth), transform, getColor);
 }
 
 void Scene::add(const std::string& meshPath, const mat4& transform, const Color& color, bool smooth) {
-    add(meshPath, transform, [color](const Point&) { return color; }, smooth);
+    addInstance(addMesh(meshPath, smooth), transform, color);
 }
 
 void Scene::add(const MeshIOData& data, const mat4& transform, const ColorFunc& getColor, bool smooth) {
-    if(smooth) {
-        for(unsigned int i = 0 ; i + 2 < data.indices.size() ; i += 3) {
-            unsigned int index0 = data.indices.at(i);
-            unsigned int index1 = data.indices.at(i + 1);
-            unsigned int index2 = data.indices.at(i + 2);
-
-            add(new MeshTriangle(getColor,
-                                 Vertex(transform * data.positions.at(index0), data.normals.at(index0)),
-                                 Vertex(transform * data.positions.at(index1), data.normals.at(index1)),
-                                 Vertex(transform * data.positions.at(index2), data.normals.at(index2))));
-        }
-    } else {
-        add(data.positions, data.indices, transform, getColor);
-    }
+    addInstance(addMesh(data, smooth), transform, getColor);
 }
 
 void Scene::add(const MeshIOData& data, const mat4& transform, const Color& color, bool smooth) {
-    add(data, transform, [color](const Point&) { return color; }, smooth);
+    addInstance(addMesh(data, smooth), transform, color);
 }
 
 void Scene::add(const std::vector<Point>& positions, const mat4& transform, const ColorFunc& getColor) {
-    for(unsigned int i = 0 ; i + 2 < positions.size() ; i += 3) {
-        add(new Triangle(getColor,
-                         transform * positions[i],
-                         transform * positions[i + 1],
-                         transform * positions[i + 2]));
-    }
+    addInstance(addMesh(positions), transform, getColor);
 }
 
 void Scene::add(const std::vector<Point>& positions, const mat4& transform, const Color& color) {
-    add(positions, transform, [color](const Point&) { return color; });
+    addInstance(addMesh(positions), transform, color);
 }
 
 void Scene::add(const std::vector<Point>& positions,
                 const std::vector<uint>& indices,
                 const mat4& transform,
                 const ColorFunc& getColor) {
-    for(unsigned int i = 0 ; i + 2 < indices.size() ; i += 3) {
-        add(new Triangle(getColor,
-                         transform * positions.at(indices.at(i)),
-                         transform * positions.at(indices.at(i + 1)),
-                         transform * positions.at(indices.at(i + 2))));
-    }
+    addInstance(addMesh(positions, indices), transform, getColor);
 }
 
 void Scene::add(const std::vector<Point>& positions,
                 const std::vector<uint>& indices,
                 const mat4& transform,
                 const Color& color) {
-    add(positions, indices, transform, [color](const Point&) { return color; });
+    addInstance(addMesh(positions, indices), transform, color);
 }
 
 Hit Scene::getClosestHit(const Ray& ray) const {
     Hit closest = bvh.intersect(ray);
+    completeHit(ray, closest);
+
+    return closest;
+}
 
+void Scene::getClosestHits(const Ray* rays, unsigned int count, Hit* closest) const {
+    for(unsigned int i = 0 ; i < count ; ++i) { closest[i] = Hit(); }
+
+    bvh.intersect(rays, count, closest);
+    for(unsigned int i = 0 ; i < count ; ++i) { completeHit(rays[i], closest[i]); }
+}
+
+void Scene::completeHit(const Ray& ray, Hit& closest) const {
     for(const Plane* plane : planes) {
-        Hit hit = plane->intersect(ray);
+        float t, u, v;
+        SYNTHESE_COUNT(primitivesTested, 1);
 
-        if(hit.intersection != infinity && (closest.object == nullptr || hit.intersection < closest.intersection)) {
-            closest.intersection = hit.intersection;
-            closest.normal = hit.normal;
+        if(plane->intersect(ray, t, u, v) && t < closest.intersection) {
+            SYNTHESE_COUNT(intersectionsFound, 1);
+            closest.intersection = t;
             closest.object = plane;
+            closest.primitive = -1u;
+            closest.instance = -1u;
         }
     }
 
-    return closest;
+    geometry.computeNormal(ray, closest);
+}
+
+bool Scene::isOccluded(const Ray& ray, float tMax) const {
+    SYNTHESE_COUNT(shadowRays, 1);
+
+    for(const Plane* plane : planes) {
+        float t, u, v;
+        SYNTHESE_COUNT(primitivesTested, 1);
+        if(plane->intersect(ray, t, u, v) && t < tMax) {
+            SYNTHESE_COUNT(intersectionsFound, 1);
+            return true;
+        }
+    }
+
+    return bvh.occluded(ray, tMax);
 }
 
 void Scene::setLowSkyColor(float r, float g, float b) {
@@ -161,64 +424,590 @@ void Scene::setHighSkyColor(float r, float g, float b) {
     highSkyColor.b = b;
 }
 
-void Scene::computeImage(Image& image) {
-    static std::mutex mutex;
+void Scene::setBVHBuildMethod(BVH::BuildMethod method) {
+    bvh.setBuildMethod(method);
+    bvhOutdated = true;
+}
+
+void Scene::setBVHLayout(BVH::Layout layout) {
+    bvh.setLayout(layout);
+}
+
+void Scene::setRayPacketSize(unsigned int size) {
+    if(size == 0 || size * size > BVH::maxPacketSize) {
+        throw std::invalid_argument("Ray packets must be between 1 and 8 pixels wide.");
+    }
+
+    rayPacketSize = size;
+}
+
+void Scene::setTileSize(unsigned int size) {
+    if(size == 0) { throw std::invalid_argument("Tiles must be at least 1 pixel wide."); }
+
+    tileSize = size;
+}
+
+void Scene::setAntialiasing(Antialiasing mode) {
+    antialiasing = mode;
+}
+
+void Scene::setSampleCount(unsigned int count) {
+    if(count == 0 || count > 256) { throw std::invalid_argument("Pixels must have between 1 and 256 samples."); }
+
+    sampleOffsets = getSampleOffsets(count);
+}
+
+void Scene::setAdaptiveThreshold(float threshold) {
+    if(!(threshold >= 0.0f)) { throw std::invalid_argument("The adaptive threshold can't be negative."); }
+
+    adaptiveThreshold = threshold;
+}
+
+void Scene::setLightSampling(LightSampling mode) {
+    lightSampling = mode;
+}
+
+void Scene::setLightSampleCount(unsigned int count) {
+    if(count == 0 || count > 64) { throw std::invalid_argument("Between 1 and 64 lights must be picked per sample."); }
+
+    lightSampleCount = count;
+}
+
+void Scene::setPipeline(Pipeline pipeline) {
+    this->pipeline = pipeline;
+}
+
+void Scene::setVerbose(bool enabled) {
+    verbose = enabled;
+}
+
+void Scene::setMeshCaching(bool enabled) {
+    meshCaching = enabled;
+}
+
+void Scene::setImageFormat(ImageWriter::Format format) {
+    imageFormat = format;
+}
+
+void Scene::setCompressionLevel(unsigned int level) {
+    if(level > 9) { throw std::invalid_argument("The compression level must be between 0 and 9."); }
+
+    compressionLevel = level;
+}
+
+void Scene::computeImage(unsigned int width, unsigned int height, TileBuffers& buffers, const TileStore& store) {
+    const unsigned int tileColumns = (width + tileSize - 1) / tileSize;
+
+    Statistics::local() = Statistics();
+
+    buffers.pixels.resize(tileSize * tileSize);
+    if(antialiasing == Antialiasing::Adaptive) {
+        buffers.centerColors.resize((tileSize + 2) * (tileSize + 2));
+        buffers.centerHits.resize((tileSize + 2) * (tileSize + 2));
+        buffers.refined.reserve(tileSize * tileSize);
+    }
+
+    unsigned long rayCount = 0;
+    for(unsigned int t = nextTile++ ; t < tileOrder.size() ; t = nextTile++) {
+        Tile tile;
+        tile.firstRow = tileOrder[t] / tileColumns * tileSize;
+        tile.firstColumn = tileOrder[t] % tileColumns * tileSize;
+        tile.rows = std::min(tile.firstRow + tileSize, height) - tile.firstRow;
+        tile.columns = std::min(tile.firstColumn + tileSize, width) - tile.firstColumn;
+
+        if(antialiasing == Antialiasing::Fixed) {
+            computeFixedTile(tile, width, height, buffers);
+            rayCount += tile.columns * tile.rows * sampleOffsets.size();
+        } else {
+            rayCount += computeAdaptiveTile(tile, width, height, buffers);
+        }
+
+        store(tile, buffers.pixels.data());
+    }
+
+    cameraRayCount += rayCount;
+
+    if(Statistics::enabled) {
+        std::lock_guard lock(countersMutex);
+        statistics.counters.merge(Statistics::local());
+    }
+}
+
+void Scene::computeFixedTile(const Tile& tile, unsigned int width, unsigned int height, TileBuffers& buffers) {
+    const float weight = 1.0f / sampleOffsets.size();
+
+    unsigned int pixels[BVH::maxPacketSize];
+    Hit hits[BVH::maxPacketSize];
+    Color colors[BVH::maxPacketSize];
+    Color sums[BVH::maxPacketSize];
 
-    static const vec2 offsets[4]{
-        vec2(0.125f, 0.375f),
-        vec2(-0.125f, -0.375f),
-        vec2(-0.375f, 0.125f),
-        vec2(0.375f, -0.125f)
+    // With the wavefront pipeline, the samples are summed in the pixels of the tile as each wave of them is traced
+    const bool wavefront = pipeline == Pipeline::Wavefront;
+    const SampleStore addSample = [&tile, width, &buffers](unsigned int pixel, const Hit&, const Color& color) {
+        buffers.pixels[(pixel / width - tile.firstRow) * tile.columns + pixel % width - tile.firstColumn] += color;
     };
+    if(wavefront) { std::fill_n(buffers.pixels.begin(), tile.columns * tile.rows, Color()); }
+
+    // The tile is rendered one square block of pixels at a time so that the camera rays of each block can be traced
+    // together
+    const unsigned int tileLastRow = tile.firstRow + tile.rows;
+    const unsigned int tileLastColumn = tile.firstColumn + tile.columns;
+
+    for(unsigned int row = tile.firstRow ; row < tileLastRow ; row += rayPacketSize) {
+        const unsigned int lastRow = std::min(row + rayPacketSize, tileLastRow);
 
-    const unsigned int rows = image.height();
-    const unsigned int columns = image.width();
+        for(unsigned int column = tile.firstColumn ; column < tileLastColumn ; column += rayPacketSize) {
+            const unsigned int lastColumn = std::min(column + rayPacketSize, tileLastColumn);
 
-    mutex.lock();
-    unsigned int row = globalRow++;
-    mutex.unlock();
+            unsigned int count = 0;
+            for(unsigned int y = row ; y < lastRow ; ++y) {
+                for(unsigned int x = column ; x < lastColumn ; ++x) { pixels[count++] = y * width + x; }
+            }
 
-    Point extremity(0.0f, 0.0f, -1.0f);
-    while(row < rows) {
-        for(unsigned int column = 0 ; column < columns ; ++column) {
-            Color color;
+            if(wavefront) {
+                for(const vec2& offset : sampleOffsets) {
+                    queueSamples(pixels, count, offset, width, height, buffers.wavefront);
+                    if(buffers.wavefront.rays.size() >= wavefrontSize) { traceWavefront(buffers.wavefront, addSample); }
+                }
+                continue;
+            }
 
-            for(const vec2& offset : offsets) {
-                extremity.x = (2.0f * (column + offset.x) - columns) / rows;
-                extremity.y = (2.0f * (row + offset.y) - rows) / rows;
+            for(unsigned int i = 0 ; i < count ; ++i) { sums[i] = Color(); }
 
-                color += computePixel(extremity);
+            for(const vec2& offset : sampleOffsets) {
+                samplePixels(pixels, count, offset, width, height, hits, colors);
+                for(unsigned int i = 0 ; i < count ; ++i) { sums[i] += colors[i]; }
             }
 
-            Color& pixel = image(column, row);
-            pixel = 0.25f * color;
+            for(unsigned int i = 0 ; i < count ; ++i) {
+                Color& pixel = buffers.pixels[(pixels[i] / width - tile.firstRow) * tile.columns
+                                              + pixels[i] % width - tile.firstColumn];
+                pixel = weight * sums[i];
+                pixel.a = 1.0f;
+            }
+        }
+    }
+
+    if(wavefront) {
+        traceWavefront(buffers.wavefront, addSample);
+        for(unsigned int i = 0 ; i < tile.columns * tile.rows ; ++i) {
+            buffers.pixels[i] = weight * buffers.pixels[i];
+            buffers.pixels[i].a = 1.0f;
+        }
+    }
+}
+
+/**
+ * @brief Checks whether two neighbouring pixels differ enough for adaptive antialiasing to sample them again.
+ * @param hit The hit seen through the center of the first pixel.
+ * @param color The color seen through the center of the first pixel.
+ * @param otherHit The hit seen through the center of the second pixel.
+ * @param otherColor The color seen through the center of the second pixel.
+ * @param threshold How much the colors and the normals can differ.
+ * @return Whether the pixels differ.
+ */
+static bool differ(const Hit& hit, const Color& color, const Hit& otherHit, const Color& otherColor, float threshold) {
+    if(hit.object != otherHit.object || hit.instance != otherHit.instance) { return true; }
+
+    const float colorDifference = std::max({ std::abs(color.r - otherColor.r), std::abs(color.g - otherColor.g),
+                                             std::abs(color.b - otherColor.b) });
+    if(colorDifference > threshold) { return true; }
+
+    // Both pixels see the same primitive, or both see the sky which has no normal
+    return hit.intersection != infinity && 1.0f - dot(hit.normal, otherHit.normal) > threshold;
+}
+
+unsigned int Scene::computeAdaptiveTile(const Tile& tile, unsigned int width, unsigned int height,
+                                        TileBuffers& buffers) {
+    // The tile with a border of one pixel, clamped to the image
+    const unsigned int firstColumn = tile.firstColumn > 0 ? tile.firstColumn - 1 : 0;
+    const unsigned int firstRow = tile.firstRow > 0 ? tile.firstRow - 1 : 0;
+    const unsigned int lastColumn = std::min(tile.firstColumn + tile.columns + 1, width);
+    const unsigned int lastRow = std::min(tile.firstRow + tile.rows + 1, height);
+    const unsigned int columns = lastColumn - firstColumn;
+
+    unsigned int pixels[BVH::maxPacketSize];
+    Hit hits[BVH::maxPacketSize];
+    Color colors[BVH::maxPacketSize];
+    Color sums[BVH::maxPacketSize];
+
+    const bool wavefront = pipeline == Pipeline::Wavefront;
+    const SampleStore storeCenter = [firstColumn, firstRow, columns, width, &buffers]
+                                    (unsigned int pixel, const Hit& hit, const Color& color) {
+        const unsigned int center = (pixel / width - firstRow) * columns + pixel % width - firstColumn;
+        buffers.centerHits[center] = hit;
+        buffers.centerColors[center] = color;
+    };
+
+    // First pass: one sample at the center of every pixel, traced one square block at a time
+    for(unsigned int row = firstRow ; row < lastRow ; row += rayPacketSize) {
+        for(unsigned int column = firstColumn ; column < lastColumn ; column += rayPacketSize) {
+            unsigned int count = 0;
+            for(unsigned int y = row ; y < std::min(row + rayPacketSize, lastRow) ; ++y) {
+                for(unsigned int x = column ; x < std::min(column + rayPacketSize, lastColumn) ; ++x) {
+                    pixels[count++] = y * width + x;
+                }
+            }
+
+            if(wavefront) {
+                queueSamples(pixels, count, vec2(0.0f, 0.0f), width, height, buffers.wavefront);
+                if(buffers.wavefront.rays.size() >= wavefrontSize) { traceWavefront(buffers.wavefront, storeCenter); }
+                continue;
+            }
+
+            samplePixels(pixels, count, vec2(0.0f, 0.0f), width, height, hits, colors);
+            for(unsigned int i = 0 ; i < count ; ++i) {
+                const unsigned int center = (pixels[i] / width - firstRow) * columns + pixels[i] % width - firstColumn;
+                buffers.centerHits[center] = hits[i];
+                buffers.centerColors[center] = colors[i];
+            }
+        }
+    }
+    if(wavefront) { traceWavefront(buffers.wavefront, storeCenter); }
+
+    // Pixels that differ from one of their 8 neighbours are sampled again, the others keep their center's color
+    buffers.refined.clear();
+    for(unsigned int y = tile.firstRow ; y < tile.firstRow + tile.rows ; ++y) {
+        for(unsigned int x = tile.firstColumn ; x < tile.firstColumn + tile.columns ; ++x) {
+            const unsigned int center = (y - firstRow) * columns + x - firstColumn;
+            const Hit& hit = buffers.centerHits[center];
+            const Color& color = buffers.centerColors[center];
+
+            bool refine = false;
+            for(unsigned int ny = std::max(y, firstRow + 1) - 1 ; ny < std::min(y + 2, lastRow) && !refine ; ++ny) {
+                for(unsigned int nx = std::max(x, firstColumn + 1) - 1 ; nx < std::min(x + 2, lastColumn) ; ++nx) {
+                    const unsigned int neighbour = (ny - firstRow) * columns + nx - firstColumn;
+                    if(differ(hit, color, buffers.centerHits[neighbour], buffers.centerColors[neighbour],
+                              adaptiveThreshold)) {
+                        refine = true;
+                        break;
+                    }
+                }
+            }
+
+            if(refine) {
+                buffers.refined.push_back(y * width + x);
+            } else {
+                Color& pixel = buffers.pixels[(y - tile.firstRow) * tile.columns + x - tile.firstColumn];
+                pixel = color;
+                pixel.a = 1.0f;
+            }
+        }
+    }
+
+    // Second pass: the refined pixels get every sample, traced in packets of pixels close to each other
+    const float weight = 1.0f / sampleOffsets.size();
+    const unsigned int packetSize = rayPacketSize * rayPacketSize;
+    const auto getPixel = [&tile, width, &buffers](unsigned int pixel) -> Color& {
+        return buffers.pixels[(pixel / width - tile.firstRow) * tile.columns + pixel % width - tile.firstColumn];
+    };
+    const SampleStore addSample = [&getPixel](unsigned int pixel, const Hit&, const Color& color) {
+        getPixel(pixel) += color;
+    };
+    if(wavefront) {
+        for(unsigned int pixel : buffers.refined) { getPixel(pixel) = Color(); }
+    }
+
+    for(unsigned int first = 0 ; first < buffers.refined.size() ; first += packetSize) {
+        const unsigned int count = std::min<unsigned int>(packetSize, buffers.refined.size() - first);
+        const unsigned int* refined = buffers.refined.data() + first;
+
+        if(wavefront) {
+            for(const vec2& offset : sampleOffsets) {
+                queueSamples(refined, count, offset, width, height, buffers.wavefront);
+                if(buffers.wavefront.rays.size() >= wavefrontSize) { traceWavefront(buffers.wavefront, addSample); }
+            }
+            continue;
+        }
+
+        for(unsigned int i = 0 ; i < count ; ++i) { sums[i] = Color(); }
+
+        for(const vec2& offset : sampleOffsets) {
+            samplePixels(refined, count, offset, width, height, hits, colors);
+            for(unsigned int i = 0 ; i < count ; ++i) { sums[i] += colors[i]; }
+        }
+
+        for(unsigned int i = 0 ; i < count ; ++i) {
+            Color& pixel = getPixel(refined[i]);
+            pixel = weight * sums[i];
             pixel.a = 1.0f;
         }
+    }
+
+    if(wavefront) {
+        traceWavefront(buffers.wavefront, addSample);
+        for(unsigned int pixel : buffers.refined) {
+            getPixel(pixel) = weight * getPixel(pixel);
+            getPixel(pixel).a = 1.0f;
+        }
+    }
+
+    return columns * (lastRow - firstRow) + buffers.refined.size() * sampleOffsets.size();
+}
+
+/**
+ * @brief Hashes an integer with the output permutation of PCG, to seed and advance random numbers.
+ * @param x The integer.
+ * @return The hash.
+ */
+static uint32_t hash(uint32_t x) {
+    const uint32_t state = x * 747796405u + 2891336453u;
+    const uint32_t word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737u;
+    return (word >> 22) ^ word;
+}
+
+/**
+ * @brief Generates the next random number of a sequence.
+ * @param state The state of the sequence, advanced.
+ * @return A random number in [0, 1).
+ */
+static float nextRandom(uint32_t& state) {
+    state = hash(state);
+    return (state >> 8) * 0x1p-24f;
+}
+
+/**
+ * @brief Computes the seed shared by a sample of every pixel, mixed with each pixel's index so that every sample of
+ * every pixel gets its own random numbers.
+ * @param offset The position of the sample relative to the center of the pixels.
+ * @return The seed.
+ */
+static uint32_t getSampleSeed(const vec2& offset) {
+    return hash(std::bit_cast<uint32_t>(offset.x) ^ hash(std::bit_cast<uint32_t>(offset.y)));
+}
+
+Ray Scene::getCameraRay(unsigned int pixel, const vec2& offset, unsigned int width, unsigned int height) const {
+    const Point extremity((2.0f * (pixel % width + offset.x) - width) / height,
+                          (2.0f * (pixel / width + offset.y) - height) / height, -1.0f);
+
+    return Ray(camera, normalize(Vector(camera, extremity)));
+}
+
+void Scene::samplePixels(const unsigned int* pixels, unsigned int count, const vec2& offset, unsigned int width,
+                         unsigned int height, Hit* hits, Color* colors) const {
+    Ray rays[BVH::maxPacketSize];
+    SYNTHESE_COUNT(primaryRays, count);
+
+    for(unsigned int i = 0 ; i < count ; ++i) { rays[i] = getCameraRay(pixels[i], offset, width, height); }
+
+    getClosestHits(rays, count, hits);
+    const uint32_t sampleSeed = getSampleSeed(offset);
+    for(unsigned int i = 0 ; i < count ; ++i) {
+        colors[i] = computePixel(rays[i], hits[i], hash(pixels[i] ^ sampleSeed));
+    }
+}
+
+void Scene::queueSamples(const unsigned int* pixels, unsigned int count, const vec2& offset, unsigned int width,
+                         unsigned int height, WavefrontQueues& queues) const {
+    SYNTHESE_COUNT(primaryRays, count);
 
-        mutex.lock();
-        row = globalRow++;
-        mutex.unlock();
+    const uint32_t sampleSeed = getSampleSeed(offset);
+    for(unsigned int i = 0 ; i < count ; ++i) {
+        queues.pixels.push_back(pixels[i]);
+        queues.seeds.push_back(hash(pixels[i] ^ sampleSeed));
+        queues.rays.push_back(getCameraRay(pixels[i], offset, width, height));
     }
+
+    queues.packetEnds.push_back(queues.rays.size());
 }
 
-Color Scene::computePixel(Point extremity) const {
+void Scene::traceWavefront(WavefrontQueues& queues, const SampleStore& store) const {
     static const Vector horizon(0.0f, 1.0f, 0.0f);
+    const unsigned int count = queues.rays.size();
+
+    // Closest hits, one packet of camera rays at a time
+    queues.hits.resize(count);
+    unsigned int packetStart = 0;
+    for(unsigned int packetEnd : queues.packetEnds) {
+        getClosestHits(&queues.rays[packetStart], packetEnd - packetStart, &queues.hits[packetStart]);
+        packetStart = packetEnd;
+    }
+
+    // Materials, the rays that hit nothing seeing the sky
+    queues.colors.resize(count);
+    for(unsigned int i = 0 ; i < count ; ++i) {
+        const Ray& ray = queues.rays[i];
+        const Hit& closest = queues.hits[i];
+
+        queues.colors[i] = closest.intersection == infinity
+                           ? lerp(lowSkyColor, highSkyColor, (1.0f + dot(ray.direction, horizon)) / 2.0f)
+                           : geometry.getColor(closest, ray.getPoint(closest.intersection));
+    }
 
-    const Ray ray(camera, normalize(Vector(camera, extremity)));
+    // Lights: each light reaching a point queues a shadow ray, the ones bringing no light are skipped
+    queues.lightColors.assign(count, Color());
+    queues.shadowRays.clear();
+    queues.shadowLights.clear();
+    queues.shadowSamples.clear();
+    queues.shadowLightIDs.clear();
 
-    Hit closest = getClosestHit(ray);
-    if(closest.object == nullptr) { return lerp(lowSkyColor, highSkyColor, (1.0f + dot(ray.direction, horizon)) / 2.0f); }
+    const auto queueShadowRay = [&queues](unsigned int sample, unsigned int light, const Color& color,
+                                          const Ray& shadowRay) {
+        queues.shadowRays.push_back(shadowRay);
+        queues.shadowLights.push_back(color);
+        queues.shadowSamples.push_back(sample);
+        queues.shadowLightIDs.push_back(light);
+    };
+
+    for(unsigned int i = 0 ; i < count ; ++i) {
+        const Hit& closest = queues.hits[i];
+        if(closest.intersection == infinity) { continue; }
+
+        const Point epsilonPoint = queues.rays[i].getEpsilonPoint(closest);
+        Color light;
+        Ray shadowRay;
+
+        if(lightSampling == LightSampling::Stochastic) {
+            uint32_t seed = queues.seeds[i];
+            for(unsigned int j = 0 ; j < lightSampleCount ; ++j) {
+                const unsigned int picked = pickLight(closest, epsilonPoint, seed, light, shadowRay);
+                if(picked != -1u) { queueShadowRay(i, picked, light, shadowRay); }
+            }
+        } else {
+            for(unsigned int index : lightGrid.getLights(epsilonPoint)) {
+                light = lights[index]->calculateUnshadowed(closest, epsilonPoint, shadowRay);
+                if(light == Black()) { continue; }
+
+                queueShadowRay(i, index, light, shadowRay);
+            }
+        }
+    }
+
+    // Shadow rays, traced sorted by light so that the rays going to a light from neighbouring points follow each other
+    const unsigned int shadowCount = queues.shadowRays.size();
+    queues.lightOffsets.assign(lights.size() + 1, 0);
+    for(unsigned int light : queues.shadowLightIDs) { ++queues.lightOffsets[light + 1]; }
+    for(unsigned int i = 0 ; i < lights.size() ; ++i) { queues.lightOffsets[i + 1] += queues.lightOffsets[i]; }
+
+    queues.shadowOrder.resize(shadowCount);
+    for(unsigned int i = 0 ; i < shadowCount ; ++i) {
+        queues.shadowOrder[queues.lightOffsets[queues.shadowLightIDs[i]]++] = i;
+    }
+
+    queues.shadowOccluded.resize(shadowCount);
+    for(unsigned int i : queues.shadowOrder) {
+        queues.shadowOccluded[i] = isOccluded(queues.shadowRays[i], queues.shadowRays[i].tMax);
+    }
+
+    // The lights of each point are summed in the order they were gathered in, as with the per-sample pipeline
+    for(unsigned int i = 0 ; i < shadowCount ; ++i) {
+        if(!queues.shadowOccluded[i]) { queues.lightColors[queues.shadowSamples[i]] += queues.shadowLights[i]; }
+    }
+
+    for(unsigned int i = 0 ; i < count ; ++i) {
+        if(queues.hits[i].intersection != infinity) { queues.colors[i] = queues.colors[i] * queues.lightColors[i]; }
+        store(queues.pixels[i], queues.hits[i], queues.colors[i]);
+    }
+
+    queues.pixels.clear();
+    queues.seeds.clear();
+    queues.rays.clear();
+    queues.packetEnds.clear();
+}
+
+/**
+ * @brief Spreads the lower 16 bits of an integer to its even bits.
+ * @param x The integer.
+ * @return The spread bits.
+ */
+static unsigned int spreadBits(unsigned int x) {
+    x &= 0x0000FFFF;
+    x = (x | (x << 8)) & 0x00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+void Scene::orderTiles(unsigned int width, unsigned int height, bool byBands) {
+    const unsigned int tileColumns = (width + tileSize - 1) / tileSize;
+    const unsigned int tileRows = (height + tileSize - 1) / tileSize;
+
+    tileOrder.resize(tileColumns * tileRows);
+    if(byBands) {
+        // The last row of tiles is the top of the image
+        for(unsigned int i = 0 ; i < tileOrder.size() ; ++i) {
+            tileOrder[i] = (tileRows - 1 - i / tileColumns) * tileColumns + i % tileColumns;
+        }
+        return;
+    }
+
+    for(unsigned int i = 0 ; i < tileOrder.size() ; ++i) { tileOrder[i] = i; }
+
+    std::sort(tileOrder.begin(), tileOrder.end(), [tileColumns](unsigned int tile, unsigned int other) {
+        return (spreadBits(tile % tileColumns) | spreadBits(tile / tileColumns) << 1)
+               < (spreadBits(other % tileColumns) | spreadBits(other / tileColumns) << 1);
+    });
+}
+
+Color Scene::computePixel(const Ray& ray, const Hit& closest, uint32_t seed) const {
+    static const Vector horizon(0.0f, 1.0f, 0.0f);
+
+    if(closest.intersection == infinity) {
+        return lerp(lowSkyColor, highSkyColor, (1.0f + dot(ray.direction, horizon)) / 2.0f);
+    }
 
     Point point = ray.getPoint(closest.intersection);
     Point epsilonPoint = ray.getEpsilonPoint(closest);
-    Color color = closest.object->getColor(point);
+    Color color = geometry.getColor(closest, point);
+
+    if(lightSampling == LightSampling::Stochastic) { return color * sampleLights(closest, epsilonPoint, seed); }
 
     Color lightColor;
-    for(const Light* light : lights) { lightColor += light->calculate(closest, epsilonPoint, this); }
+    for(unsigned int light : lightGrid.getLights(epsilonPoint)) {
+        lightColor += lights[light]->calculate(closest, epsilonPoint, this);
+    }
 
     return color * lightColor;
 }
 
+Color Scene::sampleLights(const Hit& closest, const Point& point, uint32_t seed) const {
+    Color lightColor;
+    Color light;
+    Ray shadowRay;
+
+    for(unsigned int i = 0 ; i < lightSampleCount ; ++i) {
+        if(pickLight(closest, point, seed, light, shadowRay) != -1u && !isOccluded(shadowRay, shadowRay.tMax)) {
+            lightColor += light;
+        }
+    }
+
+    return lightColor;
+}
+
+unsigned int Scene::pickLight(const Hit& closest, const Point& point, uint32_t& seed, Color& light,
+                              Ray& shadowRay) const {
+    // Resampled importance sampling: the candidates are drawn by power, and one of them is chosen with a probability
+    // proportional to its weight, the light it brings divided by the probability of drawing it
+    unsigned int chosen = -1u;
+    float chosenTarget = 0.0f;
+    float weightSum = 0.0f;
+
+    for(unsigned int i = 0 ; i < lightCandidateCount ; ++i) {
+        float probability;
+        const unsigned int candidate = lightGrid.sampleLight(point, nextRandom(seed), probability);
+        if(candidate == -1u) { break; }
+
+        Ray candidateRay;
+        const Color candidateLight = lights[candidate]->calculateUnshadowed(closest, point, candidateRay);
+        const float target = candidateLight.power();
+        if(!(target > 0.0f)) { continue; }
+
+        const float weight = target / probability;
+        weightSum += weight;
+        if(nextRandom(seed) * weightSum < weight) {
+            chosen = candidate;
+            chosenTarget = target;
+            light = candidateLight;
+            shadowRay = candidateRay;
+        }
+    }
+
+    if(chosen != -1u) { light = light * (weightSum / (lightCandidateCount * lightSampleCount * chosenTarget)); }
+
+    return chosen;
+}
+
 void Scene::printSceneInfo() const {
     static constexpr unsigned char lightTypeCount = static_cast<unsigned char>(LightType::TYPE_COUNT);
     static constexpr unsigned char objectTypeCount = static_cast<unsigned char>(ObjectType::TYPE_COUNT);
@@ -230,7 +1019,7 @@ void Scene::printSceneInfo() const {
     int objectCounts[objectTypeCount];
     for(int& objectCount : objectCounts) { objectCount = 0; }
     objectCounts[static_cast<unsigned char>(ObjectType::Plane)] += planes.size();
-    for(const Object* object : objects) { objectCounts[static_cast<unsigned char>(object->getType())]++; }
+    for(const Object* object : geometry.getObjects()) { objectCounts[static_cast<unsigned char>(object->getType())]++; }
 
     std::cout << "\tThere are:\n";
     for(unsigned int i = 0 ; i < lightTypeCount ; ++i) {
@@ -270,4 +1059,12 @@ void Scene::printSceneInfo() const {
             std::cout << (objectCounts[i] > 1 ? "s" : "") << '\n';
         }
     }
+
+    const MeshStore& meshStore = geometry.getMeshStore();
+    if(meshStore.getMeshCount() > 0) {
+        const uint instanceCount = geometry.getInstances().size();
+        std::cout << "\t\t" << meshStore.getMeshCount() << " Mesh" << (meshStore.getMeshCount() > 1 ? "es" : "")
+                  << " (" << meshStore.getTriangleCount() << " Triangles) placed " << instanceCount << " time"
+                  << (instanceCount > 1 ? "s" : "") << '\n';
+    }
 }
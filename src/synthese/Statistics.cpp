@@ -0,0 +1,36 @@
+/***************************************************************************************************
+ * @file  Statistics.cpp
+ * @brief Implementation of the Statistics struct
+ **************************************************************************************************/
+
+#include "synthese/Statistics.hpp"
+
+void Statistics::merge(const Statistics& other) {
+    primaryRays += other.primaryRays;
+    shadowRays += other.shadowRays;
+    nodesVisited += other.nodesVisited;
+    primitivesTested += other.primitivesTested;
+    intersectionsFound += other.intersectionsFound;
+    proceduralEvaluations += other.proceduralEvaluations;
+}
+
+void Statistics::print(std::ostream& stream) const {
+    const unsigned long rays = primaryRays + shadowRays;
+    const float perRay = rays > 0 ? 1.0f / rays : 0.0f;
+    const float perPrimaryRay = primaryRays > 0 ? 1.0f / primaryRays : 0.0f;
+
+    stream << "\tStatistics:\n"
+           << "\t\t" << primaryRays << " primary rays and " << shadowRays << " shadow rays ("
+           << shadowRays * perPrimaryRay << " per primary ray)\n"
+           << "\t\t" << nodesVisited << " BVH nodes visited (" << nodesVisited * perRay << " per ray)\n"
+           << "\t\t" << primitivesTested << " primitives tested (" << primitivesTested * perRay << " per ray)\n"
+           << "\t\t" << intersectionsFound << " intersections found (" << intersectionsFound * perRay << " per ray)\n"
+           << "\t\t" << proceduralEvaluations << " procedural material evaluations ("
+           << proceduralEvaluations * perPrimaryRay << " per primary ray)\n";
+}
+
+void Statistics::writeJSON(std::ostream& stream) const {
+    stream << "{ \"primary_rays\": " << primaryRays << ", \"shadow_rays\": " << shadowRays << ", \"nodes_visited\": "
+           << nodesVisited << ", \"primitives_tested\": " << primitivesTested << ", \"intersections_found\": "
+           << intersectionsFound << ", \"procedural_evaluations\": " << proceduralEvaluations << " }";
+}
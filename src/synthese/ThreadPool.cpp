@@ -0,0 +1,87 @@
+/***************************************************************************************************
+ * @file  ThreadPool.cpp
+ * @brief Implementation of the ThreadPool class
+ **************************************************************************************************/
+
+#include "synthese/ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::TaskGroup::TaskGroup() : pendingCount(0) { }
+
+ThreadPool::ThreadPool(unsigned int threadCount) : stopping(false) {
+    threadCount = std::max(threadCount, 1u);
+    for(unsigned int i = 0 ; i < threadCount ; ++i) { threads.emplace_back(&ThreadPool::work, this); }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+
+    for(std::thread& thread : threads) { thread.join(); }
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+    return threads.size();
+}
+
+void ThreadPool::run(TaskGroup& group, std::function<void()> task) {
+    group.pendingCount++;
+
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back({ std::move(task), &group });
+    }
+    available.notify_one();
+    done.notify_all(); // Threads waiting on a group can run the task too
+}
+
+void ThreadPool::wait(TaskGroup& group) {
+    std::unique_lock lock(mutex);
+
+    while(group.pendingCount > 0) {
+        if(tasks.empty()) {
+            // Only tasks already running on other threads are left, their completion wakes this thread up
+            done.wait(lock, [this, &group] { return group.pendingCount == 0 || !tasks.empty(); });
+            continue;
+        }
+
+        // Runs the most recent task, which is the most likely to be part of this group when groups are nested
+        Task task = std::move(tasks.back());
+        tasks.pop_back();
+
+        lock.unlock();
+        execute(task);
+        lock.lock();
+    }
+}
+
+void ThreadPool::work() {
+    std::unique_lock lock(mutex);
+
+    while(true) {
+        available.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if(tasks.empty()) { return; }
+
+        Task task = std::move(tasks.front());
+        tasks.pop_front();
+
+        lock.unlock();
+        execute(task);
+        lock.lock();
+    }
+}
+
+void ThreadPool::execute(Task& task) {
+    task.function();
+
+    // The counter is decremented under the lock so that a waiting thread can't miss the notification
+    {
+        std::lock_guard lock(mutex);
+        task.group->pendingCount--;
+    }
+    done.notify_all();
+}
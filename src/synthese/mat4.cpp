@@ -5,6 +5,7 @@
 
 #include "synthese/mat4.hpp"
 
+#include <stdexcept>
 #include "utility.hpp"
 
 mat4::mat4()
@@ -413,17 +414,17 @@ Point operator*(const mat4& mat, const Point& point) {
 
 Vector operator*(const mat4& mat, const Vector& vec) {
     return Vector(
-        mat(0, 0) * vec.x + mat(0, 1) * vec.y + mat(0, 2) * vec.z + mat(0, 3),
-        mat(1, 0) * vec.x + mat(1, 1) * vec.y + mat(1, 2) * vec.z + mat(1, 3),
-        mat(2, 0) * vec.x + mat(2, 1) * vec.y + mat(2, 2) * vec.z + mat(2, 3)
+        mat(0, 0) * vec.x + mat(0, 1) * vec.y + mat(0, 2) * vec.z,
+        mat(1, 0) * vec.x + mat(1, 1) * vec.y + mat(1, 2) * vec.z,
+        mat(2, 0) * vec.x + mat(2, 1) * vec.y + mat(2, 2) * vec.z
     );
 }
 
 vec3 operator*(const mat4& mat, const vec3& vec) {
     return vec3(
-        mat(0, 0) * vec.x + mat(0, 1) * vec.y + mat(0, 2) * vec.z + mat(0, 3),
-        mat(1, 0) * vec.x + mat(1, 1) * vec.y + mat(1, 2) * vec.z + mat(1, 3),
-        mat(2, 0) * vec.x + mat(2, 1) * vec.y + mat(2, 2) * vec.z + mat(2, 3)
+        mat(0, 0) * vec.x + mat(0, 1) * vec.y + mat(0, 2) * vec.z,
+        mat(1, 0) * vec.x + mat(1, 1) * vec.y + mat(1, 2) * vec.z,
+        mat(2, 0) * vec.x + mat(2, 1) * vec.y + mat(2, 2) * vec.z
     );
 }
 
@@ -435,3 +436,54 @@ vec4 operator*(const mat4& mat, const vec4& vec) {
         mat(3, 0) * vec.x + mat(3, 1) * vec.y + mat(3, 2) * vec.z + mat(3, 3) * vec.w
     );
 }
+
+mat4 transpose(const mat4& mat) {
+    mat4 result;
+    for(int row = 0 ; row < 4 ; ++row) {
+        for(int column = 0 ; column < 4 ; ++column) { result(row, column) = mat(column, row); }
+    }
+
+    return result;
+}
+
+mat4 inverse(const mat4& mat) {
+    // Cofactor expansion using the 2x2 determinants of the two upper and the two lower rows
+    const float s0 = mat(0, 0) * mat(1, 1) - mat(1, 0) * mat(0, 1);
+    const float s1 = mat(0, 0) * mat(1, 2) - mat(1, 0) * mat(0, 2);
+    const float s2 = mat(0, 0) * mat(1, 3) - mat(1, 0) * mat(0, 3);
+    const float s3 = mat(0, 1) * mat(1, 2) - mat(1, 1) * mat(0, 2);
+    const float s4 = mat(0, 1) * mat(1, 3) - mat(1, 1) * mat(0, 3);
+    const float s5 = mat(0, 2) * mat(1, 3) - mat(1, 2) * mat(0, 3);
+
+    const float c5 = mat(2, 2) * mat(3, 3) - mat(3, 2) * mat(2, 3);
+    const float c4 = mat(2, 1) * mat(3, 3) - mat(3, 1) * mat(2, 3);
+    const float c3 = mat(2, 1) * mat(3, 2) - mat(3, 1) * mat(2, 2);
+    const float c2 = mat(2, 0) * mat(3, 3) - mat(3, 0) * mat(2, 3);
+    const float c1 = mat(2, 0) * mat(3, 2) - mat(3, 0) * mat(2, 2);
+    const float c0 = mat(2, 0) * mat(3, 1) - mat(3, 0) * mat(2, 1);
+
+    const float determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if(determinant == 0.0f) { throw std::runtime_error("Cannot invert a singular matrix."); }
+
+    return mat4(
+        mat(1, 1) * c5 - mat(1, 2) * c4 + mat(1, 3) * c3,
+        -mat(0, 1) * c5 + mat(0, 2) * c4 - mat(0, 3) * c3,
+        mat(3, 1) * s5 - mat(3, 2) * s4 + mat(3, 3) * s3,
+        -mat(2, 1) * s5 + mat(2, 2) * s4 - mat(2, 3) * s3,
+
+        -mat(1, 0) * c5 + mat(1, 2) * c2 - mat(1, 3) * c1,
+        mat(0, 0) * c5 - mat(0, 2) * c2 + mat(0, 3) * c1,
+        -mat(3, 0) * s5 + mat(3, 2) * s2 - mat(3, 3) * s1,
+        mat(2, 0) * s5 - mat(2, 2) * s2 + mat(2, 3) * s1,
+
+        mat(1, 0) * c4 - mat(1, 1) * c2 + mat(1, 3) * c0,
+        -mat(0, 0) * c4 + mat(0, 1) * c2 - mat(0, 3) * c0,
+        mat(3, 0) * s4 - mat(3, 1) * s2 + mat(3, 3) * s0,
+        -mat(2, 0) * s4 + mat(2, 1) * s2 - mat(2, 3) * s0,
+
+        -mat(1, 0) * c3 + mat(1, 1) * c1 - mat(1, 2) * c0,
+        mat(0, 0) * c3 - mat(0, 1) * c1 + mat(0, 2) * c0,
+        -mat(3, 0) * s3 + mat(3, 1) * s1 - mat(3, 2) * s0,
+        mat(2, 0) * s3 - mat(2, 1) * s1 + mat(2, 2) * s0
+    ) / determinant;
+}
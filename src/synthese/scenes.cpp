@@ -0,0 +1,232 @@
+/***************************************************************************************************
+ * @file  scenes.cpp
+ * @brief Implementation of the scenes of the project
+ **************************************************************************************************/
+
+#include "synthese/scenes.hpp"
+
+#include <stdexcept>
+#include "synthese/transforms.hpp"
+#include "utility.hpp"
+
+static void scene1(Scene& scene) {
+    /* ---- Lights ---- */
+    scene.add(new DirectionalLight(White(), Vector(-4.0f, 6.0f, 1.0f)));
+    scene.add(new DirectionalLight(White(), Vector(4.0f, 6.0f, 1.0f)));
+
+    /* ---- Objects ---- */
+    scene.add(new Plane(scene.addCheckerMaterial(White(), Black()), Point(0.0f, -1.0f, 0.0f),
+                        Vector(0.0f, 1.0f, 0.0f)));
+
+    /* Sphere */ {
+        Point center(0.0f, 0.0f, -3.0f);
+        MaterialID material = scene.addMaterial([center](const Point& point) {
+            Vector v = (normalize(point - center) + Vector(1.0f, 1.0f, 1.0f)) / 2.0f;
+            return Color(v.x, v.y, v.z);
+        });
+        scene.add(new Sphere(material, center, 1.0f));
+    }
+}
+
+static void scene2(Scene& scene) {
+    /* ---- Lights ---- */
+    {
+        float radius = 6.0f;
+        scene.add(new PointLight(Blue(), Point(-2.0f, 1.0f, -1.0f), radius));
+        scene.add(new PointLight(Red(), Point(2.0f, 1.0f, -1.0f), radius));
+    }
+
+    /* ---- Objects ---- */
+    scene.add(new Plane(scene.addCheckerMaterial(White(), Black()), Point(0.0f, -1.0f, 0.0f),
+                        Vector(0.0f, 1.0f, 0.0f)));
+
+    scene.add(new Sphere(scene.addMaterial(Color(0.82f, 0.2f, 0.2f)), Point(-1.0f, 1.0f, -3.0f), 1.0f));
+    scene.add(new Sphere(scene.addMaterial(Color(0.2f, 0.2f, 0.82f)), Point(1.0f, 1.0f, -3.0f), 1.0f));
+}
+
+static void scene3(Scene& scene) {
+    /* ---- Lights ---- */
+    scene.add(new DirectionalLight(White(), Vector(-4.0f, 6.0f, 1.0f)));
+
+    /* ---- Objects ---- */
+    scene.add(new Plane(scene.addCheckerMaterial(White(), Black()), Point(0.0f, -1.0f, 0.0f),
+                        Vector(0.0f, 1.0f, 0.0f)));
+
+    /* Cubes */ {
+        uint cube = scene.addMesh("data/synthese/cube.obj");
+
+        scene.addInstance(cube, translate(-2.0f, 0.0f, -3.0f), Red());
+        scene.addInstance(cube, translate(2.0f, 0.0f, -3.0f), Blue());
+        scene.addInstance(cube, translate(0.0f, 2.0f, -3.0f), Green());
+    }
+}
+
+static void scene4(Scene& scene) {
+    /* ---- Lights ---- */
+    scene.add(new DirectionalLight(White(), Vector(-4.0f, 6.0f, 4.0f)));
+
+    /* ---- Objects ---- */
+    scene.add(new Plane(scene.addCheckerMaterial(Color(0.922f, 0.216f, 0.216f), White()), Point(0.0f, -1.0f, 0.0f),
+                        Vector(0.0f, 1.0f, 0.0f)));
+
+    /* Sphere 1 */ {
+        Point pos = Point(0.0f, 0.0f, -2.5f);
+        MaterialID material = scene.addMaterial([pos](const Point& point) {
+            Vector v = point - pos;
+            float t = 0.5f + 0.5f * std::cos(15.0f * M_PIf * std::sqrt(std::abs(2.0f * v.y * v.x)));
+            return lerp(Color(0.216f, 0.51f, 0.922f), Blue(), t);
+        });
+        scene.add(new Sphere(material, pos, 1.0f));
+    }
+
+    /* Sphere 2 */ {
+        Point pos = Point(-2.5f, 0.0f, -2.5f);
+        MaterialID material = scene.addMaterial([pos](const Point& point) {
+            Vector v = point - pos;
+            float t = 0.5f + 0.5f * std::cos(15.0f * M_PIf * std::sqrt(std::abs(2.0f * v.y * v.x)));
+            return lerp(Color(0.922f, 0.216f, 0.51f), Red(), t);
+        });
+        scene.add(new Sphere(material, pos, 1.0f));
+    }
+
+    /* Sphere 3 */ {
+        Point pos = Point(2.5f, 0.0f, -2.5f);
+        MaterialID material = scene.addMaterial([pos](const Point& point) {
+            Vector v = point - pos;
+            float t = 0.5f + 0.5f * std::cos(15.0f * M_PIf * std::sqrt(std::abs(2.0f * v.y * v.x)));
+            return lerp(Color(0.216f, 0.922f, 0.51f), Green(), t);
+        });
+        scene.add(new Sphere(material, pos, 1.0f));
+    }
+}
+
+static void scene5(Scene& scene) {
+    /* ---- Lights ---- */
+    scene.add(new DirectionalLight(White(), Vector(-4.0f, 6.0f, 1.0f)));
+    scene.add(new DirectionalLight(White(), Vector(4.0f, 6.0f, 1.0f)));
+
+    /* ---- Objects ---- */
+    scene.add("data/synthese/dodecahedron.obj", translate(-2.0f, 0.0f, -4.0f).scale(2.0f), White());
+    scene.add("data/synthese/cube.obj", translate(2.0f, 0.0f, -4.0f).scale(0.5f), Red());
+}
+
+static void scene6(Scene& scene) {
+    /* ---- Sky ---- */
+    scene.setLowSkyColor(0.3f, 0.3f, 0.3f);
+    scene.setHighSkyColor(0.1f, 0.1f, 0.1f);
+
+    /* ---- Lights ---- */
+    scene.add(new PointLight(White(), Point(-1.0f, 1.0f, 1.0f), 4.0f));
+    scene.add(new PointLight(White(), Point(1.0f, -1.0f, 1.0f), 4.0f));
+
+    /* ---- Objects ---- */
+    scene.add("data/synthese/suzanne.obj", translate(-1.0f, 0.2f, -2.0f).rotateY(-10.0f), Color(0.678f, 0.424f, 0.902f),
+              true);
+    scene.add("data/synthese/suzanne.obj", translate(1.0f, -0.2f, -2.0f).rotateY(10.0f).rotateZ(180.0f),
+              Color(0.322f, 0.576f, 0.098f), false);
+}
+
+static void scene7(Scene& scene) {
+    /* ---- Lights ---- */
+    scene.add(new DirectionalLight(White(), Vector(0.0f, 0.0f, 1.0f)));
+
+    /* ---- Objects ---- */
+    /* Sphere Rings */ {
+        unsigned int rings = 1024;
+        unsigned int spheres = 16;
+
+        float radius = 0.35f;
+        float circleRadius = 2.0f;
+        float angle = 2.0f * M_PIf / spheres;
+        unsigned int hue = 360 / spheres;
+
+        for(unsigned int j = 0 ; j < rings ; ++j) {
+            float z = -2.5f - j * (2.0f * radius);
+
+            for(unsigned int i = 0 ; i < spheres ; ++i) {
+                scene.add(new Sphere(scene.addMaterial(hueToRGBA(((i + j) % spheres) * hue)),
+                                     Point(circleRadius * std::cos(i * angle), circleRadius * std::sin(i * angle), z),
+                                     radius));
+            }
+
+            radius *= 0.9f;
+            circleRadius *= 0.9f;
+        }
+    }
+}
+
+static void scene8(Scene& scene) {
+    /* ---- Lights ---- */
+    scene.add(new DirectionalLight(White(), Vector(0.0f, 2.0f, 1.0f)));
+
+    /* ---- Objects ---- */
+    scene.add(new Plane(scene.addMaterial(Color(0.3f, 0.3f, 0.3f)), Point(0.0f, -1.0f, 0.0f),
+                        Vector(0.0f, 1.0f, 0.0f)));
+
+    uint dragon = scene.addMesh("data/synthese/dragon80k.obj");
+
+    scene.addInstance(dragon, translate(0.0f, 0.75f, -4.0f).scale(6.0f).rotateY(75.0f),
+                      scene.addGradientMaterial(Point(0.0f, 0.0f, 0.0f), Point(0.0f, 2.0f, 0.0f), White(),
+                                                Color(0.922f, 0.216f, 0.216f)));
+    scene.addInstance(dragon, translate(-0.5f, -0.5f, -1.5f).scale(1.5f).rotateY(-75.0f), Color(0.3f, 0.3f, 1.0f));
+    scene.addInstance(dragon, translate(0.5f, -0.75f, -1.2f).scale(0.5f).rotateY(75.0f), Color(0.3f, 1.0f, 0.5f));
+}
+
+static void scene9(Scene& scene) {
+    /* ---- Sky ---- */
+    scene.setLowSkyColor(0.05f, 0.05f, 0.1f);
+    scene.setHighSkyColor(0.0f, 0.0f, 0.02f);
+
+    /* ---- Lights ---- */
+    /* Fireflies */ {
+        unsigned int rows = 24;
+        unsigned int columns = 24;
+
+        for(unsigned int j = 0 ; j < rows ; ++j) {
+            for(unsigned int i = 0 ; i < columns ; ++i) {
+                float x = -6.0f + 12.0f * (i + 0.5f) / columns;
+                float y = -0.5f + 0.25f * std::sin(1.7f * i + 2.3f * j);
+                float z = -2.0f - 12.0f * (j + 0.5f) / rows;
+                scene.add(new PointLight(hueToRGBA((i * 37 + j * 61) % 360), Point(x, y, z), 0.9f));
+            }
+        }
+    }
+
+    /* ---- Objects ---- */
+    scene.add(new Plane(scene.addMaterial(Color(0.8f, 0.8f, 0.8f)), Point(0.0f, -1.0f, 0.0f),
+                        Vector(0.0f, 1.0f, 0.0f)));
+
+    /* Spheres */ {
+        MaterialID material = scene.addMaterial(White());
+
+        for(unsigned int j = 0 ; j < 6 ; ++j) {
+            for(unsigned int i = 0 ; i < 6 ; ++i) {
+                scene.add(new Sphere(material, Point(-5.0f + 2.0f * i, -0.6f, -3.0f - 2.0f * j), 0.4f));
+            }
+        }
+    }
+}
+
+static const SceneDefinition scenes[]{
+    { "01 - Sphere and Plane", scene1, 1024, 512 },
+    { "02 - Point Lights", scene2, 1024, 512 },
+    { "03 - Cubes", scene3, 1024, 512 },
+    { "04 - Weird Spheres", scene4, 1024, 512 },
+    { "05 - Dodecahedron and Cube", scene5, 1024, 512 },
+    { "06 - The Suzanne of Suzanne", scene6, 768, 512 },
+    { "07 - Sphere Rings", scene7, 4096, 4096 },
+    { "08 - Let There Be Dragons", scene8, 1024, 1024 },
+    { "09 - Fireflies", scene9, 1024, 512 },
+};
+
+std::span<const SceneDefinition> getScenes() {
+    return scenes;
+}
+
+const SceneDefinition& getScene(unsigned int number) {
+    if(number == 0 || number > std::size(scenes)) {
+        throw std::out_of_range("There is no scene " + std::to_string(number) + '.');
+    }
+
+    return scenes[number - 1];
+}
@@ -0,0 +1,336 @@
+/***************************************************************************************************
+ * @file  synthese_bench.cpp
+ * @brief Contains the main program for the 'synthese_bench' executable, which measures the renders of a scene
+ **************************************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "synthese/Scene.hpp"
+#include "synthese/scenes.hpp"
+
+/**
+ * @struct BenchOptions
+ * @brief The parameters of a benchmark, given on the command line.
+ */
+struct BenchOptions {
+    unsigned int scene{ 6 };                                        ///< The number of the rendered scene.
+    unsigned int width{ 0 };                                        ///< The image's width, 0 for the scene's.
+    unsigned int height{ 0 };                                       ///< The image's height, 0 for the scene's.
+    unsigned int threads{ 0 };                                      ///< The amount of threads, 0 for one per core.
+    unsigned int samples{ 4 };                                      ///< The amount of samples per antialiased pixel.
+    Scene::Antialiasing antialiasing{ Scene::Antialiasing::Fixed }; ///< The way the pixels are sampled.
+    unsigned int lightSamples{ 0 };                                 ///< The lights picked per sample, 0 for all.
+    Scene::Pipeline pipeline{ Scene::Pipeline::PerSample };         ///< The way the samples go through the stages.
+    BVH::BuildMethod builder{ BVH::BuildMethod::SAH };              ///< The way the BVHs are built.
+    unsigned int repeats{ 5 };                                      ///< The amount of measured renders.
+    bool meshCaching{ false };                                      ///< Whether to load the meshes from their caches.
+    std::string output;                                             ///< The JSON report's path, empty for stdout.
+};
+
+/**
+ * @struct BenchRun
+ * @brief The measurements of one render of the benchmark.
+ */
+struct BenchRun {
+    float loadDuration;           ///< The time spent creating the scene and loading its meshes, in seconds.
+    float buildDuration;          ///< The time spent building the BVHs, in seconds.
+    float renderDuration;         ///< The time spent computing the image, in seconds.
+    unsigned long cameraRayCount; ///< The amount of camera rays traced.
+    Statistics counters;          ///< The counters of the render, zero unless SYNTHESE_STATISTICS is set.
+};
+
+/// The names of the BVH build methods on the command line and in the report, in the order of BVH::BuildMethod.
+static constexpr const char* builderNames[]{ "midpoint", "sah", "lbvh", "trbvh" };
+
+/**
+ * @brief Prints how to use the executable.
+ * @param program The name the executable was called with.
+ */
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "\t--scene <n>            The scene to render (default: 6):\n";
+    for(unsigned int i = 0 ; i < getScenes().size() ; ++i) {
+        std::cerr << "\t                           " << i + 1 << ": " << getScenes()[i].name << '\n';
+    }
+    std::cerr << "\t--width <pixels>       The image's width (default: the scene's)\n"
+              << "\t--height <pixels>      The image's height (default: the scene's)\n"
+              << "\t--threads <n>          The amount of threads (default: the amount of cores)\n"
+              << "\t--samples <n>          The amount of samples per antialiased pixel (default: 4)\n"
+              << "\t--adaptive             Only antialiases the pixels differing from their neighbours\n"
+              << "\t--light-samples <n>    Picks n lights per sample at random instead of computing every light\n"
+              << "\t--wavefront            Renders with the wavefront pipeline, one stage at a time for many samples\n"
+              << "\t--builder <name>       How the BVHs are built: midpoint, sah, lbvh or trbvh (default: sah)\n"
+              << "\t--repeats <n>          The amount of measured renders, after a warm-up one (default: 5)\n"
+              << "\t--cache                Loads the meshes and their BVHs from their caches, written by the warm-up\n"
+              << "\t                       run, instead of parsing them and building their BVHs on every run. The\n"
+              << "\t                       mesh BVHs are then left out of the build times\n"
+              << "\t--output <path>        Writes the JSON report to a file instead of the standard output\n";
+}
+
+/**
+ * @brief Parses a positive integer argument.
+ * @param option The option the argument belongs to.
+ * @param argument The argument, nullptr if it is missing.
+ * @return The integer.
+ */
+unsigned int parseCount(std::string_view option, const char* argument) {
+    if(argument == nullptr) { throw std::invalid_argument("Missing value for " + std::string(option) + '.'); }
+
+    std::size_t end = 0;
+    unsigned long value = 0;
+    try {
+        value = std::stoul(argument, &end);
+    } catch(const std::exception&) {
+        end = 0;
+    }
+
+    if(end == 0 || argument[end] != '\0' || value == 0 || value > -1u) {
+        throw std::invalid_argument("Invalid value for " + std::string(option) + ": " + argument + '.');
+    }
+
+    return value;
+}
+
+/**
+ * @brief Parses the command line.
+ * @param argc The amount of arguments.
+ * @param argv The arguments.
+ * @param options Receives the parameters of the benchmark.
+ * @return Whether the benchmark should run, false if the usage was asked for.
+ */
+bool parseOptions(int argc, char* argv[], BenchOptions& options) {
+    for(int i = 1 ; i < argc ; ++i) {
+        const std::string_view option = argv[i];
+        const char* argument = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if(option == "--help" || option == "-h") { return false; }
+
+        if(option == "--adaptive") {
+            options.antialiasing = Scene::Antialiasing::Adaptive;
+        } else if(option == "--wavefront") {
+            options.pipeline = Scene::Pipeline::Wavefront;
+        } else if(option == "--cache") {
+            options.meshCaching = true;
+        } else if(option == "--builder") {
+            if(argument == nullptr) { throw std::invalid_argument("Missing value for --builder."); }
+
+            const auto name = std::find(std::begin(builderNames), std::end(builderNames), std::string_view(argument));
+            if(name == std::end(builderNames)) {
+                throw std::invalid_argument("Invalid value for --builder: " + std::string(argument) + '.');
+            }
+            options.builder = static_cast<BVH::BuildMethod>(name - std::begin(builderNames));
+            ++i;
+        } else if(option == "--output") {
+            if(argument == nullptr) { throw std::invalid_argument("Missing value for --output."); }
+            options.output = argument;
+            ++i;
+        } else {
+            unsigned int* value = nullptr;
+            if(option == "--scene") { value = &options.scene; }
+            else if(option == "--width") { value = &options.width; }
+            else if(option == "--height") { value = &options.height; }
+            else if(option == "--threads") { value = &options.threads; }
+            else if(option == "--samples") { value = &options.samples; }
+            else if(option == "--light-samples") { value = &options.lightSamples; }
+            else if(option == "--repeats") { value = &options.repeats; }
+            else { throw std::invalid_argument("Unknown option " + std::string(option) + '.'); }
+
+            *value = parseCount(option, argument);
+            ++i;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Creates, loads and renders a scene once, without saving the image.
+ * @param options The parameters of the benchmark.
+ * @param width The image's width.
+ * @param height The image's height.
+ * @return The measurements of the render.
+ */
+BenchRun runOnce(const BenchOptions& options, unsigned int width, unsigned int height) {
+    const SceneDefinition& definition = getScene(options.scene);
+
+    const std::chrono::time_point loadStartTime(std::chrono::high_resolution_clock::now());
+    Scene scene(definition.name, options.threads);
+    scene.setVerbose(false);
+    scene.setMeshCaching(options.meshCaching);
+    scene.setSampleCount(options.samples);
+    scene.setAntialiasing(options.antialiasing);
+    scene.setPipeline(options.pipeline);
+    scene.setBVHBuildMethod(options.builder);
+    if(options.lightSamples > 0) {
+        scene.setLightSampling(Scene::LightSampling::Stochastic);
+        scene.setLightSampleCount(options.lightSamples);
+    }
+    definition.populate(scene);
+    std::chrono::duration<float> loadDuration = std::chrono::high_resolution_clock::now() - loadStartTime;
+
+    scene.renderImage(width, height);
+
+    const Scene::RenderStatistics& statistics = scene.getRenderStatistics();
+    return { loadDuration.count(), statistics.buildDuration, statistics.renderDuration, statistics.cameraRayCount,
+             statistics.counters };
+}
+
+/**
+ * @brief Writes the distribution of a measurement as a JSON object: its minimum, mean, 50th, 90th and 99th
+ * nearest-rank percentiles and maximum.
+ * @param stream The stream to write to.
+ * @param values The measurement of each run.
+ */
+void writeDistribution(std::ostream& stream, std::vector<float> values) {
+    std::sort(values.begin(), values.end());
+
+    float sum = 0.0f;
+    for(float value : values) { sum += value; }
+
+    const auto percentile = [&values](float rank) {
+        std::size_t index = static_cast<std::size_t>(std::ceil(rank / 100.0f * values.size()));
+        return values[std::clamp<std::size_t>(index, 1, values.size()) - 1];
+    };
+
+    stream << "{ \"min\": " << values.front() << ", \"mean\": " << sum / values.size() << ", \"p50\": "
+           << percentile(50.0f) << ", \"p90\": " << percentile(90.0f) << ", \"p99\": " << percentile(99.0f)
+           << ", \"max\": " << values.back() << " }";
+}
+
+/**
+ * @brief Writes the measurements of a run as a JSON object.
+ * @param stream The stream to write to.
+ * @param run The measurements of the run.
+ */
+void writeRun(std::ostream& stream, const BenchRun& run) {
+    stream << "{ \"load_seconds\": " << run.loadDuration << ", \"build_seconds\": " << run.buildDuration
+           << ", \"render_seconds\": " << run.renderDuration << ", \"camera_rays\": " << run.cameraRayCount << " }";
+}
+
+/**
+ * @brief Writes the report of a benchmark as JSON. The warm-up run is reported on its own, outside of the
+ * distributions of the measured runs.
+ * @param stream The stream to write to.
+ * @param options The parameters of the benchmark.
+ * @param width The image's width.
+ * @param height The image's height.
+ * @param warmUp The measurements of the warm-up run.
+ * @param runs The measurements of each measured render.
+ */
+void writeReport(std::ostream& stream, const BenchOptions& options, unsigned int width, unsigned int height,
+                 const BenchRun& warmUp, const std::vector<BenchRun>& runs) {
+    std::vector<float> loadDurations, buildDurations, renderDurations, megaraysPerSecond;
+    for(const BenchRun& run : runs) {
+        loadDurations.push_back(run.loadDuration);
+        buildDurations.push_back(run.buildDuration);
+        renderDurations.push_back(run.renderDuration);
+        megaraysPerSecond.push_back(run.cameraRayCount / run.renderDuration / 1e6f);
+    }
+
+    stream << "{\n"
+           << "  \"scene\": \"" << getScene(options.scene).name << "\",\n"
+           << "  \"width\": " << width << ",\n"
+           << "  \"height\": " << height << ",\n"
+           << "  \"threads\": " << options.threads << ",\n"
+           << "  \"samples\": " << options.samples << ",\n"
+           << "  \"antialiasing\": \""
+           << (options.antialiasing == Scene::Antialiasing::Fixed ? "fixed" : "adaptive") << "\",\n"
+           << "  \"light_samples\": " << options.lightSamples << ",\n"
+           << "  \"pipeline\": \""
+           << (options.pipeline == Scene::Pipeline::PerSample ? "per_sample" : "wavefront") << "\",\n"
+           << "  \"builder\": \"" << builderNames[static_cast<unsigned int>(options.builder)] << "\",\n"
+           << "  \"mesh_caching\": " << (options.meshCaching ? "true" : "false") << ",\n"
+           << "  \"repeats\": " << options.repeats << ",\n"
+           << "  \"load_seconds\": ";
+    writeDistribution(stream, loadDurations);
+    stream << ",\n  \"build_seconds\": ";
+    writeDistribution(stream, buildDurations);
+    stream << ",\n  \"render_seconds\": ";
+    writeDistribution(stream, renderDurations);
+    stream << ",\n  \"camera_mrays_per_second\": ";
+    writeDistribution(stream, megaraysPerSecond);
+    if(Statistics::enabled) {
+        // Every run traces the same rays, the counters of the first one are enough
+        stream << ",\n  \"statistics\": ";
+        runs.front().counters.writeJSON(stream);
+    }
+    stream << ",\n  \"warm_up\": ";
+    writeRun(stream, warmUp);
+    stream << ",\n  \"runs\": [\n";
+
+    for(unsigned int i = 0 ; i < runs.size() ; ++i) {
+        stream << "    ";
+        writeRun(stream, runs[i]);
+        stream << (i + 1 < runs.size() ? "," : "") << '\n';
+    }
+
+    stream << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        BenchOptions options;
+        if(!parseOptions(argc, argv, options)) {
+            printUsage(argv[0]);
+            return 0;
+        }
+
+        if(options.threads == 0) { options.threads = std::max(std::thread::hardware_concurrency(), 1u); }
+
+        const SceneDefinition& definition = getScene(options.scene);
+        const unsigned int width = options.width != 0 ? options.width : definition.width;
+        const unsigned int height = options.height != 0 ? options.height : definition.height;
+
+        // gkit's mesh loaders print to stdout, which only holds the report: their lines go to stderr during the runs
+        std::fflush(stdout);
+        const int reportOutput = dup(STDOUT_FILENO);
+        if(reportOutput == -1 || dup2(STDERR_FILENO, STDOUT_FILENO) == -1) {
+            throw std::runtime_error("Couldn't redirect the standard output.");
+        }
+
+        // The first run also warms up the caches, and writes the mesh caches if they are used
+        const BenchRun warmUp = runOnce(options, width, height);
+        std::cerr << "Warm-up run: loaded in " << warmUp.loadDuration << "s, built in " << warmUp.buildDuration
+                  << "s, rendered in " << warmUp.renderDuration << "s.\n";
+
+        std::vector<BenchRun> runs;
+        for(unsigned int i = 0 ; i < options.repeats ; ++i) {
+            runs.push_back(runOnce(options, width, height));
+            std::cerr << "Run " << i + 1 << '/' << options.repeats << ": built in " << runs.back().buildDuration
+                      << "s, rendered in " << runs.back().renderDuration << "s.\n";
+        }
+
+        std::fflush(stdout);
+        if(dup2(reportOutput, STDOUT_FILENO) == -1) {
+            throw std::runtime_error("Couldn't restore the standard output.");
+        }
+        close(reportOutput);
+
+        if(options.output.empty()) {
+            writeReport(std::cout, options, width, height, warmUp, runs);
+        } else {
+            std::ofstream file(options.output);
+            writeReport(file, options, width, height, warmUp, runs);
+            if(!file) { throw std::runtime_error("Couldn't write " + options.output + '.'); }
+        }
+    } catch(const std::invalid_argument& exception) {
+        std::cerr << "ERROR : " << exception.what() << '\n';
+        printUsage(argv[0]);
+        return -1;
+    } catch(const std::exception& exception) {
+        std::cerr << "ERROR : " << exception.what() << '\n';
+        return -1;
+    }
+
+    return 0;
+}
@@ -6,7 +6,7 @@
 #include "utility.hpp"
 
 #include <random>
-#include <stb_image_write.h>
+#include "ImageWriter.hpp"
 
 float random(float min, float max) {
     static std::random_device seed;
@@ -64,6 +64,7 @@ bool isColorSimilar(const Color& color, const Color& base, const Color& epsilon)
 
 void write_boolean_array_as_grayscale_image(const std::string& path, const Array2D<bool>& data) {
     std::vector<unsigned char> temp;
+    temp.reserve(data.rows * data.columns);
 
     for(unsigned int i = 0 ; i < data.columns ; ++i) {
         for(unsigned int j = 0 ; j < data.rows ; ++j) {
@@ -71,8 +72,9 @@ void write_boolean_array_as_grayscale_image(const std::string& path, const Array
         }
     }
 
-    stbi_flip_vertically_on_write(false);
-    stbi_write_png(path.c_str(), data.rows, data.columns, 1, temp.data(), 0);
+    ImageWriter writer(path, data.rows, data.columns, 1);
+    writer.writeRows(temp.data(), data.columns);
+    writer.close();
 }
 
 bool operator!=(const Vector& vec, const Vector& other) {